@@ -32,7 +32,9 @@
  ************************************/
 // Should be continous 1's, e.g. 0xFF, 0x1FF, 0x3FF, etc.
 // Size is dependent of how fast the os task is executed, and the expected data rate.
-#define RX_BUFFER_MASK      (0x3F)
+// The host sends each command in one write, so a complete setup_frame command
+// (1 + MAX_NR_OF_FRAMES*(8 + 8*MAX_FRAME_SIZE) + 1 bytes) must fit.
+#define RX_BUFFER_MASK      (0x7FF)
 #define MAX_FRAME_SIZE      (0x1F)
 #define MAX_NR_OF_FRAMES    (0x04)
 
@@ -42,6 +44,14 @@
 #define TX_STX          (0x02)
 #define TX_ETX          (0x03)
 
+// Log frame: | sync0 | sync1 | version | id | length | time[4] | variables | crc16[2] |
+// Must match source/app/serial_monitor/inc/serial_protocol.h
+#define FRAME_SYNC_0        (0xA5)
+#define FRAME_SYNC_1        (0x5A)
+#define FRAME_VERSION       (0x01)
+#define FRAME_HEADER_SIZE   (5)
+#define FRAME_TIME_SIZE     (4)
+
 #define SERIAL_DGB      (false)
 #define LOG_PREFIX      "SerialLog: "
 #define DEBUG_LOG(fmt, ...) \
@@ -66,6 +76,7 @@ typedef struct {
  * PRIVATE FUNCTION PROTOTYPES
  ************************************/
 void insert_byte(uint8_t byte);
+static uint16_t Crc16(const uint8_t *data, uint16_t len);
 void RunCommandHandler(uint8_t byte);
 
 bool CH_Invalid(uint8_t byte, uint8_t tx_data[], uint16_t * tx_size);
@@ -165,7 +176,8 @@ void SerialLog_TransmitPendingFrame() {
  * Transmitts one frame.
  */
 void SerialLog_TransmittFrame(uint16_t frame_id) {
-    uint8_t  tx_buffer[0xFF+1];
+    // Static since DMA reads it after this function returns.
+    static uint8_t tx_buffer[FRAME_HEADER_SIZE + 0xFF + 2];
     uint16_t tx_buf_idx = 0;
     uint32_t log_time_loc = log_time;
     uint16_t frame_loc = frame_id;
@@ -186,22 +198,38 @@ void SerialLog_TransmittFrame(uint16_t frame_id) {
 
     frame_pending[frame_loc] = false; // Clear pending frame, since we are transmitting now.
 
-    if (frames[frame_loc].variables_in_frame > 0) {
-        tx_buffer[tx_buf_idx++] = frame_loc;
-        tx_buffer[tx_buf_idx++] = (log_time_loc >> 24) & 0xFF;
-        tx_buffer[tx_buf_idx++] = (log_time_loc >> 16) & 0xFF;
-        tx_buffer[tx_buf_idx++] = (log_time_loc >> 8)  & 0xFF;
-        tx_buffer[tx_buf_idx++] =  log_time_loc        & 0xFF;
+    if (frames[frame_loc].variables_in_frame == 0) {
+        return;
     }
 
+    tx_buffer[tx_buf_idx++] = FRAME_SYNC_0;
+    tx_buffer[tx_buf_idx++] = FRAME_SYNC_1;
+    tx_buffer[tx_buf_idx++] = FRAME_VERSION;
+    tx_buffer[tx_buf_idx++] = frame_loc;
+    tx_buffer[tx_buf_idx++] = 0; // Length, filled in below
+    tx_buffer[tx_buf_idx++] = (log_time_loc >> 24) & 0xFF;
+    tx_buffer[tx_buf_idx++] = (log_time_loc >> 16) & 0xFF;
+    tx_buffer[tx_buf_idx++] = (log_time_loc >> 8)  & 0xFF;
+    tx_buffer[tx_buf_idx++] =  log_time_loc        & 0xFF;
+
     for (size_t i=0; i<frames[frame_loc].variables_in_frame; i++) {
         uint8_t *src = (uint8_t *)frames[frame_loc].variables[i].address;
         uint32_t variable_size = frames[frame_loc].variables[i].size;
+        if (tx_buf_idx + variable_size > FRAME_HEADER_SIZE + 0xFF) {
+            break; // Does not fit in the length field
+        }
         for (size_t j = 0; j < variable_size; j++) {
             tx_buffer[tx_buf_idx++] = src[variable_size - 1 - j];
         }
     }
 
+    tx_buffer[4] = (uint8_t)(tx_buf_idx - FRAME_HEADER_SIZE);
+
+    // CRC over version up to the last variable
+    uint16_t crc = Crc16(&tx_buffer[2], tx_buf_idx - 2);
+    tx_buffer[tx_buf_idx++] = (crc >> 8) & 0xFF;
+    tx_buffer[tx_buf_idx++] =  crc       & 0xFF;
+
     HAL_UART_Transmit_DMA(&huart3, tx_buffer, tx_buf_idx);
 }
 
@@ -215,6 +243,20 @@ void insert_byte(uint8_t byte) {
     rx_head &= RX_BUFFER_MASK; // Wrap around if needed
 }
 
+/*
+ * CRC-16/CCITT-FALSE, bitwise to keep it out of flash.
+ */
+static uint16_t Crc16(const uint8_t *data, uint16_t len) {
+    uint16_t crc = 0xFFFF;
+    for (uint16_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
 void RunCommandHandler(uint8_t byte) {
     uint8_t  tx_data[0xF+1] = {TX_NACK};
     uint16_t tx_size        = 0;
@@ -222,6 +264,9 @@ void RunCommandHandler(uint8_t byte) {
 
     if (handler == -1) {
         handler = byte;
+        if (handler >= nr_of_ch) {
+            handler = 0; // Unknown command, answered by CH_Invalid
+        }
     }
 
     if (command_handlers[handler](byte, tx_data, &tx_size)) {
@@ -255,8 +300,7 @@ bool CH_Start_Log(uint8_t byte, uint8_t tx_data[], uint16_t * tx_size) {
         UNUSED(byte);
         log_started = true;
         tx_data[0] = TX_ACK;
-        tx_data[1] = 0xFF;
-        *tx_size = 2;
+        *tx_size = 1;
         return true;
 }
 
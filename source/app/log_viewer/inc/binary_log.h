@@ -0,0 +1,93 @@
+#ifndef BINARY_LOG_H_
+#define BINARY_LOG_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "log_reader.h"
+#include "mapped_file.h"
+#include "serial_back.h"
+
+/*
+ * Binary log file (.jvbl), little endian:
+ *
+ * | magic[8] | version u32 | rows_per_chunk u32 | column_count u32 | (type u8 | name_len u16 | name)* |
+ * | chunk | chunk | ... | notes | index | trailer |
+ *
+ * chunk:   | rows u32 | data_size u32 | column data, time first | footer |
+ * footer:  | time_min f64 | time_max f64 | (encoding u8 | size u32 | min f64 | max f64) per column, time first |
+ * index:   | (offset u64 | first_row u64 | rows u32 | time_min f64 | time_max f64) per chunk |
+ * trailer: | notes_offset u64 | notes_len u32 | index_offset u64 | chunk_count u32 | end_magic[8] |
+ *
+ * Time is stored as integer microseconds. A file without trailer, e.g. after a crash,
+ * is recovered by walking the chunks from the start.
+ */
+typedef enum {
+    ENCODING_RAW,       // Values in their own type
+    ENCODING_CONST,     // One value for all rows
+    ENCODING_DELTA,     // Zigzag varint deltas, integer types and time
+} ColumnEncoding;
+
+typedef struct {
+    std::string  name;
+    VariableType type;
+} BinaryLogColumn;
+
+typedef struct {
+    uint64_t offset;
+    uint64_t first_row;
+    uint32_t rows;
+    double   time_min;
+    double   time_max;
+} BinaryLogChunk;
+
+typedef struct {
+    std::FILE*                       file;
+    std::vector<BinaryLogColumn>     columns;
+    std::vector<int64_t>             time_us;   // Rows of the chunk being filled
+    std::vector<std::vector<double>> values;
+    std::vector<BinaryLogChunk>      chunks;
+    uint64_t                         rows;
+    uint64_t                         offset;
+    bool                             failed;    // A write failed, e.g. disk full. Sticky, later rows are dropped
+} BinaryLogWriter;
+
+typedef struct {
+    MappedFile                   file;
+    std::vector<BinaryLogColumn> columns;
+    std::vector<BinaryLogChunk>  chunks;
+    uint64_t                     rows;
+    uint32_t                     rows_per_chunk;
+    std::string                  notes;
+} BinaryLogReader;
+
+namespace binary_log {
+    const char     kMagic[8]    = {'J', 'V', 'B', 'L', 'O', 'G', '\r', '\n'};
+    const char     kEndMagic[8] = {'J', 'V', 'B', 'L', 'I', 'D', 'X', '\0'};
+    const uint32_t kVersion     = 1;
+    const uint32_t kRowsPerChunk = 4096;
+
+    bool OpenWriter(BinaryLogWriter& writer, const std::string& path, const std::vector<BinaryLogColumn>& columns);
+    // values holds one value per column, in column order. False once a write has failed
+    bool AppendRow(BinaryLogWriter& writer, double time, const double* values);
+    // False if any write of the file failed, the file is incomplete then
+    bool CloseWriter(BinaryLogWriter& writer, const std::string& notes);
+
+    bool OpenReader(BinaryLogReader& reader, const std::string& path);
+    void CloseReader(BinaryLogReader& reader);
+    // Rows with time in [t0, t1], only the chunks overlapping the range are decoded.
+    // A stride above 1 keeps every stride:th row of the file.
+    void ReadRange(const BinaryLogReader& reader, double t0, double t1, Data& out, size_t stride = 1);
+    // Rows with time in [t0, t1] handed to on_rows one chunk at a time, so the range never has
+    // to fit in memory. Only the named columns are decoded. Stops, returning false, when on_rows does.
+    bool ForEachChunk(const BinaryLogReader& reader, double t0, double t1, const std::vector<std::string>& columns,
+                      const std::function<bool(const Data&)>& on_rows);
+    // Upper bound of the rows in [t0, t1], from the index only
+    uint64_t RowsInRange(const BinaryLogReader& reader, double t0, double t1);
+    bool ReadLog(const std::string& path, Data& out);
+} // namespace binary_log
+
+#endif // BINARY_LOG_H_
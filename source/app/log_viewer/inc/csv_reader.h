@@ -0,0 +1,20 @@
+#ifndef CSV_READER_H_
+#define CSV_READER_H_
+
+#include <string>
+
+#include "log_reader.h"
+
+/*
+ * CSV log loading without any UI state. Comment lines starting with '#' and
+ * trailing separators are skipped. Values may use ',' as decimal, values that
+ * do not parse become NaN.
+ */
+namespace csv_reader {
+    float ParseCommaDecimal(const std::string& str);
+    // Replaces time and signals of data with the columns of the file
+    void ReadCsv(const std::string& path, char separator, int header_line_idx, const std::string& time_name,
+                 Data& data);
+} // namespace csv_reader
+
+#endif // CSV_READER_H_
@@ -0,0 +1,32 @@
+#ifndef CSV_WRITER_H_
+#define CSV_WRITER_H_
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "log_reader.h"
+
+typedef struct {
+    char separator;
+    char decimal;       // '.' or ','
+} CsvFormat;
+
+/*
+ * CSV output with locale independent std::to_chars formatting. Row blocks are
+ * formatted in parallel into per thread buffers and written in order, so the
+ * file is the same as if it was written by one thread.
+ */
+namespace csv_writer {
+    const CsvFormat kDefaultFormat = {',', '.'};
+
+    std::string FormatHeader(const std::vector<std::string>& columns, const CsvFormat& format);
+    // Writes rows [0, rows) of time and columns, columns in the given order.
+    // threads = 0 uses all hardware threads.
+    bool WriteRows(std::FILE* file, const double* time, const std::vector<const double*>& columns,
+                   size_t rows, const CsvFormat& format, unsigned threads = 0);
+    bool WriteCsv(const std::string& path, const Data& data, const std::vector<std::string>& columns,
+                  const CsvFormat& format, unsigned threads = 0);
+} // namespace csv_writer
+
+#endif // CSV_WRITER_H_
@@ -0,0 +1,29 @@
+#ifndef DECIMATION_H_
+#define DECIMATION_H_
+
+#include <vector>
+
+typedef struct {
+    double decimation_factor;
+    int visible_min_idx;
+    int visible_max_idx;
+} DecimationData;
+
+/*
+ * Thins out the visible part of a signal so a plot never draws more than
+ * about kMaxSamplesInView points, however far it is zoomed out.
+ */
+namespace decimation {
+    const double kMaxSamplesInView = 1e4;
+
+    // Values between indices [time_min_idx, time_max_idx] with step m, and the last value.
+    // keep_first also keeps the first value, so auto-fit sees the start of the log.
+    // result is overwritten, its memory is reused so a redraw does not allocate.
+    void Decimate(const std::vector<double>& input, int time_min_idx, int time_max_idx, int m, bool keep_first,
+                  std::vector<double>& result);
+    // Decimation factor and visible indices of time for the range [x_min, x_max]
+    void CalculateDecimationData(const std::vector<double>& time, double x_min, double x_max,
+                                 DecimationData& decimation_data);
+} // namespace decimation
+
+#endif // DECIMATION_H_
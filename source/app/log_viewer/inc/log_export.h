@@ -0,0 +1,38 @@
+#ifndef LOG_EXPORT_H_
+#define LOG_EXPORT_H_
+
+#include <string>
+#include <vector>
+
+#include "log_reader.h"
+#include "resample.h"
+
+typedef enum {
+    EXPORT_FORMAT_CSV,
+    EXPORT_FORMAT_BINARY,
+} ExportFormat;
+
+typedef struct {
+    std::string              path;
+    ExportFormat             format;
+    double                   t0;
+    double                   t1;
+    std::vector<std::string> signals;
+    double                   resample_hz;   // 0 keeps the original samples
+    ResampleMode             resample_mode;
+} ExportRequest;
+
+namespace log_export {
+// Copies the requested slice of data and writes it from a background thread.
+// Returns false if an export is already running or the range is empty.
+bool Start(const Data& data, const ExportRequest& request);
+// Same for a log too large for memory, read from its binary log file in batches
+bool StartPaged(const std::string& log_path, const ExportRequest& request);
+bool IsRunning();
+void DeInit();
+
+void ExportMenuButton();
+void GuiUpdate();
+}  // namespace log_export
+
+#endif  // LOG_EXPORT_H_
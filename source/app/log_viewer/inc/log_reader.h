@@ -1,6 +1,7 @@
 #ifndef LOG_READER_H_
 #define LOG_READER_H_
 
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -19,6 +20,15 @@ typedef enum {
 Data* GetData(void);
 LogSource GetLogSource();
 void ClearData(void);
+// A binary log with more rows than fit in memory stays open and GetData() holds an overview of
+// every n:th row. The rows in view are read from the file through its chunk index.
+bool IsLogPaged();
+uint64_t GetLogVersion();   // Changes whenever another log is loaded
+// Rows of the paged log in [t0, t1], about max_rows at most, 0 for all of them. Returns false
+// if no log is paged or the rows read would be no finer than the overview.
+bool ReadLogRange(double t0, double t1, size_t max_rows, Data& out);
+// File of the paged log, empty if none. Other threads open their own reader on it.
+std::string GetPagedLogPath();
 void LogReadButton(void);
 void InitSerialStream(std::unordered_map<std::string, VarStruct> log_variables);
 #endif  // LOG_READER_H_
\ No newline at end of file
@@ -1,7 +1,12 @@
 #ifndef MAIN_WINDOW_H_
 #define MAIN_WINDOW_H_
+#include <cstddef>
+
 #include "imgui.h"
 
 void MainWindow(ImGuiIO& io);
+// Heap bytes of the decimated plot buffers and of the serial log history paged in from disk
+size_t GetDecimationBufferBytes();
+size_t GetHistoryBytes();
 
 #endif  // MAIN_WINDOW_H_
\ No newline at end of file
@@ -0,0 +1,24 @@
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ * Read only memory mapping of a whole file. Pages are loaded by the OS on first
+ * access, so readers only pay for the parts of the file they touch.
+ */
+typedef struct {
+    const uint8_t* data;
+    size_t         size;
+    void*          file_handle;      // Only used on Windows
+    void*          mapping_handle;   // Only used on Windows
+} MappedFile;
+
+namespace mapped_file {
+    bool Open(MappedFile& file, const std::string& path);
+    void Close(MappedFile& file);
+} // namespace mapped_file
+
+#endif // MAPPED_FILE_H_
@@ -0,0 +1,46 @@
+#ifndef RESAMPLE_H_
+#define RESAMPLE_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "log_reader.h"
+
+typedef enum {
+    RESAMPLE_ZERO_ORDER_HOLD,   // Last sample at or before the grid time
+    RESAMPLE_LINEAR,            // Interpolated between the samples around the grid time
+    RESAMPLE_NEAREST,           // Closest sample in time
+} ResampleMode;
+
+/*
+ * Source position of each grid point, shared by all signals on the same time vector.
+ * out = values[index] * (1 - weight) + values[index + 1] * weight
+ * Grid points outside the source hold the first or last sample.
+ */
+typedef struct {
+    std::vector<size_t> index;
+    std::vector<double> weight;     // Empty unless mode is linear
+} ResamplePlan;
+
+namespace resample {
+// Larger grids are refused, each signal of the export needs one double per point
+const size_t kMaxGridPoints = 20000000;
+
+// Points of the grid from t0 to t1 at a fixed rate, 0 if the rate or range is invalid
+double GridPoints(double t0, double t1, double rate_hz);
+// Time grid from t0 to t1 at a fixed rate. False, and grid empty, above kMaxGridPoints
+bool FixedGrid(double t0, double t1, double rate_hz, std::vector<double>& grid);
+// Sorted union of several time vectors, e.g. to align two logs
+std::vector<double> CommonGrid(const std::vector<const std::vector<double>*>& times);
+
+// threads = 0 uses all hardware threads
+ResamplePlan MakePlan(const double* time, size_t count, const std::vector<double>& grid, ResampleMode mode,
+                      unsigned threads = 0);
+void Apply(const ResamplePlan& plan, const double* values, double* out);
+
+// Signals with NaN samples, e.g. sparse CSV columns, are resampled from their valid samples only
+Data ResampleData(const Data& data, const std::vector<std::string>& signals, const std::vector<double>& grid,
+                  ResampleMode mode, unsigned threads = 0);
+}  // namespace resample
+
+#endif  // RESAMPLE_H_
@@ -3,6 +3,8 @@
 #include <cstdint>
 #include <string>
 
+#include "csv_writer.h"
+
 namespace settings {
 const size_t kSettingsCharBufLen = 0x1F;
 }
@@ -12,6 +14,7 @@ struct Settings {
     uint8_t header_line_idx;
     char time_name[settings::kSettingsCharBufLen];
     char separator[settings::kSettingsCharBufLen];
+    bool comma_decimal;     // Decimal comma in written CSV files, reading accepts both
     bool auto_size_y;
     int cursor_value_table_size;
 };
@@ -21,6 +24,7 @@ Settings const* GetSettings();
 void init();
 void ShowSettingsButton();
 void SetLogFilePath(std::string path);
+CsvFormat GetCsvFormat();
 }  // namespace settings
 
 #endif  // SETTINGS_H_
\ No newline at end of file
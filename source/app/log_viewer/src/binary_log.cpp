@@ -0,0 +1,646 @@
+#include "binary_log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+
+namespace {
+    const size_t chunk_header_size  = 2 * sizeof(uint32_t);
+    const size_t footer_column_size = sizeof(uint8_t) + sizeof(uint32_t) + 2 * sizeof(double);
+    const size_t footer_base_size   = 2 * sizeof(double);
+    const size_t index_entry_size   = 2 * sizeof(uint64_t) + sizeof(uint32_t) + 2 * sizeof(double);
+    const size_t trailer_size       = 2 * sizeof(uint64_t) + 2 * sizeof(uint32_t) + sizeof(binary_log::kEndMagic);
+    // Files claiming larger chunks are rejected, a chunk is decoded into memory at once
+    const uint32_t max_rows_per_chunk = 1 << 20;
+
+    // Time is stored like an integer column of its own
+    const VariableType time_type = TYPE_NUM_OF_TYPES;
+
+    template <typename T>
+    void Put(std::vector<uint8_t>& out, T value) {
+        uint8_t bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+
+    template <typename T>
+    T Get(const uint8_t* data) {
+        T value;
+        std::memcpy(&value, data, sizeof(T));
+        return value;
+    }
+
+    size_t FooterSize(size_t columns) {
+        return footer_base_size + (columns + 1) * footer_column_size;
+    }
+
+    size_t ValueSize(VariableType type) {
+        switch (type) {
+            case TYPE_UINT8:
+            case TYPE_INT8:
+            case TYPE_CHAR:
+            case TYPE_BOOL:
+                return 1;
+            case TYPE_UINT16:
+            case TYPE_INT16:
+                return 2;
+            case TYPE_UINT32:
+            case TYPE_INT32:
+            case TYPE_FLOAT:
+                return 4;
+            default:
+                return 8;
+        }
+    }
+
+    bool IsInteger(VariableType type) {
+        return type != TYPE_FLOAT && type != TYPE_DOUBLE && type != TYPE_UNKNOWN;
+    }
+
+    /*
+     * Raw bits of a value in the column type. Integer types are sign or zero
+     * extended so consecutive values can be delta coded.
+     */
+    int64_t ToBits(double value, VariableType type) {
+        switch (type) {
+            case TYPE_UINT8:
+            case TYPE_CHAR:
+            case TYPE_BOOL:
+                return static_cast<uint8_t>(value);
+            case TYPE_INT8:
+                return static_cast<int8_t>(value);
+            case TYPE_UINT16:
+                return static_cast<uint16_t>(value);
+            case TYPE_INT16:
+                return static_cast<int16_t>(value);
+            case TYPE_UINT32:
+                return static_cast<uint32_t>(value);
+            case TYPE_INT32:
+                return static_cast<int32_t>(value);
+            case TYPE_FLOAT: {
+                float const f = static_cast<float>(value);
+                uint32_t bits;
+                std::memcpy(&bits, &f, sizeof(bits));
+                return bits;
+            }
+            case time_type:
+                return static_cast<int64_t>(value);
+            default: {
+                int64_t bits;
+                std::memcpy(&bits, &value, sizeof(bits));
+                return bits;
+            }
+        }
+    }
+
+    double FromBits(int64_t bits, VariableType type) {
+        switch (type) {
+            case TYPE_UINT8:
+            case TYPE_CHAR:
+            case TYPE_BOOL:
+                return static_cast<uint8_t>(bits);
+            case TYPE_INT8:
+                return static_cast<int8_t>(bits);
+            case TYPE_UINT16:
+                return static_cast<uint16_t>(bits);
+            case TYPE_INT16:
+                return static_cast<int16_t>(bits);
+            case TYPE_UINT32:
+                return static_cast<uint32_t>(bits);
+            case TYPE_INT32:
+                return static_cast<int32_t>(bits);
+            case TYPE_FLOAT: {
+                uint32_t const u = static_cast<uint32_t>(bits);
+                float f;
+                std::memcpy(&f, &u, sizeof(f));
+                return f;
+            }
+            case time_type:
+                return static_cast<double>(bits) * 1e-6;
+            default: {
+                double d;
+                std::memcpy(&d, &bits, sizeof(d));
+                return d;
+            }
+        }
+    }
+
+    void PutVarint(std::vector<uint8_t>& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    size_t VarintSize(uint64_t value) {
+        size_t size = 1;
+        while (value >= 0x80) {
+            value >>= 7;
+            size++;
+        }
+        return size;
+    }
+
+    uint64_t ZigZag(int64_t value) {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    int64_t UnZigZag(uint64_t value) {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    void PutValue(std::vector<uint8_t>& out, int64_t bits, size_t size) {
+        uint8_t bytes[sizeof(bits)];
+        std::memcpy(bytes, &bits, sizeof(bits));
+        out.insert(out.end(), bytes, bytes + size);
+    }
+
+    /*
+     * Appends one column of a chunk to out with the smallest of the encodings.
+     */
+    ColumnEncoding EncodeColumn(std::vector<uint8_t>& out, const std::vector<int64_t>& bits, VariableType type) {
+        size_t const value_size = ValueSize(type);
+
+        if (std::all_of(bits.begin(), bits.end(), [&](int64_t b) { return b == bits.front(); })) {
+            PutValue(out, bits.front(), value_size);
+            return ENCODING_CONST;
+        }
+
+        if (IsInteger(type)) {
+            size_t delta_size = 0;
+            int64_t previous = 0;
+            for (int64_t const b : bits) {
+                delta_size += VarintSize(ZigZag(b - previous));
+                previous = b;
+            }
+            if (delta_size < bits.size() * value_size) {
+                previous = 0;
+                for (int64_t const b : bits) {
+                    PutVarint(out, ZigZag(b - previous));
+                    previous = b;
+                }
+                return ENCODING_DELTA;
+            }
+        }
+
+        for (int64_t const b : bits) {
+            PutValue(out, b, value_size);
+        }
+        return ENCODING_RAW;
+    }
+
+    bool DecodeColumn(const uint8_t* data, size_t size, ColumnEncoding encoding, VariableType type,
+                      uint32_t rows, std::vector<double>& out) {
+        size_t const value_size = ValueSize(type);
+        out.resize(rows);
+        switch (encoding) {
+            case ENCODING_CONST: {
+                if (size < value_size) {
+                    return false;
+                }
+                int64_t bits = 0;
+                std::memcpy(&bits, data, value_size);
+                std::fill(out.begin(), out.end(), FromBits(bits, type));
+                return true;
+            }
+            case ENCODING_RAW: {
+                if (size < rows * value_size) {
+                    return false;
+                }
+                for (uint32_t i = 0; i < rows; i++) {
+                    int64_t bits = 0;
+                    std::memcpy(&bits, data + i * value_size, value_size);
+                    out[i] = FromBits(bits, type);
+                }
+                return true;
+            }
+            case ENCODING_DELTA: {
+                size_t pos = 0;
+                int64_t value = 0;
+                for (uint32_t i = 0; i < rows; i++) {
+                    uint64_t delta = 0;
+                    int shift = 0;
+                    while (true) {
+                        if (pos >= size || shift > 63) {
+                            return false;
+                        }
+                        uint8_t const byte = data[pos++];
+                        delta |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                        if ((byte & 0x80) == 0) {
+                            break;
+                        }
+                        shift += 7;
+                    }
+                    value += UnZigZag(delta);
+                    out[i] = FromBits(value, type);
+                }
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+
+    void FlushChunk(BinaryLogWriter& writer) {
+        uint32_t const rows = static_cast<uint32_t>(writer.time_us.size());
+        if (rows == 0) {
+            return;
+        }
+
+        std::vector<uint8_t> data;
+        std::vector<uint8_t> footer;
+        double const time_min = static_cast<double>(writer.time_us.front()) * 1e-6;
+        double const time_max = static_cast<double>(writer.time_us.back()) * 1e-6;
+        Put<double>(footer, time_min);
+        Put<double>(footer, time_max);
+
+        auto add_column = [&](const std::vector<int64_t>& bits, VariableType type, double min, double max) {
+            size_t const start = data.size();
+            ColumnEncoding const encoding = EncodeColumn(data, bits, type);
+            Put<uint8_t>(footer, static_cast<uint8_t>(encoding));
+            Put<uint32_t>(footer, static_cast<uint32_t>(data.size() - start));
+            Put<double>(footer, min);
+            Put<double>(footer, max);
+        };
+
+        add_column(writer.time_us, time_type, time_min, time_max);
+        std::vector<int64_t> bits(rows);
+        for (size_t col = 0; col < writer.columns.size(); col++) {
+            const std::vector<double>& values = writer.values[col];
+            VariableType const type = writer.columns[col].type;
+            double min = std::numeric_limits<double>::infinity();
+            double max = -std::numeric_limits<double>::infinity();
+            for (uint32_t i = 0; i < rows; i++) {
+                bits[i] = ToBits(values[i], type);
+                // Min/max of what is stored, not of what was passed in
+                double const stored = FromBits(bits[i], type);
+                min = std::min(min, stored);
+                max = std::max(max, stored);
+            }
+            add_column(bits, type, min, max);
+            writer.values[col].clear();
+        }
+
+        std::vector<uint8_t> header;
+        Put<uint32_t>(header, rows);
+        Put<uint32_t>(header, static_cast<uint32_t>(data.size()));
+        writer.time_us.clear();
+        if (std::fwrite(header.data(), 1, header.size(), writer.file) != header.size() ||
+            std::fwrite(data.data(), 1, data.size(), writer.file) != data.size() ||
+            std::fwrite(footer.data(), 1, footer.size(), writer.file) != footer.size()) {
+            // Not indexed, the index would point past what was written
+            writer.failed = true;
+            return;
+        }
+
+        writer.chunks.push_back({
+            .offset    = writer.offset,
+            .first_row = writer.rows,
+            .rows      = rows,
+            .time_min  = time_min,
+            .time_max  = time_max,
+        });
+        writer.offset += header.size() + data.size() + footer.size();
+        writer.rows   += rows;
+    }
+
+    /*
+     * Chunk list from a file that was never closed, stops at the first incomplete chunk.
+     */
+    void RecoverChunks(BinaryLogReader& reader, size_t pos) {
+        size_t const footer_size = FooterSize(reader.columns.size());
+        while (pos + chunk_header_size <= reader.file.size) {
+            uint32_t const rows      = Get<uint32_t>(reader.file.data + pos);
+            uint32_t const data_size = Get<uint32_t>(reader.file.data + pos + sizeof(uint32_t));
+            size_t const footer_pos  = pos + chunk_header_size + data_size;
+            if (rows == 0 || rows > reader.rows_per_chunk || footer_pos + footer_size > reader.file.size) {
+                break;
+            }
+            reader.chunks.push_back({
+                .offset    = pos,
+                .first_row = reader.rows,
+                .rows      = rows,
+                .time_min  = Get<double>(reader.file.data + footer_pos),
+                .time_max  = Get<double>(reader.file.data + footer_pos + sizeof(double)),
+            });
+            reader.rows += rows;
+            pos = footer_pos + footer_size;
+        }
+    }
+
+    bool ReadIndex(BinaryLogReader& reader) {
+        const uint8_t* data = reader.file.data;
+        size_t const size   = reader.file.size;
+        if (size < trailer_size ||
+            std::memcmp(data + size - sizeof(binary_log::kEndMagic), binary_log::kEndMagic,
+                        sizeof(binary_log::kEndMagic)) != 0) {
+            return false;
+        }
+
+        const uint8_t* trailer       = data + size - trailer_size;
+        uint64_t const notes_offset  = Get<uint64_t>(trailer);
+        uint32_t const notes_len     = Get<uint32_t>(trailer + 8);
+        uint64_t const index_offset  = Get<uint64_t>(trailer + 12);
+        uint32_t const chunk_count   = Get<uint32_t>(trailer + 20);
+        if (notes_offset > size || notes_len > size - notes_offset || index_offset > size - trailer_size ||
+            chunk_count > (size - trailer_size - index_offset) / index_entry_size) {
+            return false;
+        }
+
+        reader.notes.assign(reinterpret_cast<const char*>(data + notes_offset), notes_len);
+        for (uint32_t i = 0; i < chunk_count; i++) {
+            const uint8_t* entry = data + index_offset + i * index_entry_size;
+            reader.chunks.push_back({
+                .offset    = Get<uint64_t>(entry),
+                .first_row = Get<uint64_t>(entry + 8),
+                .rows      = Get<uint32_t>(entry + 16),
+                .time_min  = Get<double>(entry + 20),
+                .time_max  = Get<double>(entry + 28),
+            });
+            if (reader.chunks.back().rows > reader.rows_per_chunk) {
+                return false;
+            }
+            reader.rows += reader.chunks.back().rows;
+        }
+        return true;
+    }
+
+    /*
+     * Decodes one column of a chunk, column 0 is time. The chunk comes from the
+     * index, so its header, data and footer are checked against the file first.
+     */
+    bool ReadChunkColumn(const BinaryLogReader& reader, const BinaryLogChunk& chunk, size_t column,
+                         std::vector<double>& out) {
+        const uint8_t* data    = reader.file.data;
+        size_t const file_size = reader.file.size;
+        if (chunk.offset > file_size || file_size - chunk.offset < chunk_header_size) {
+            return false;
+        }
+        uint32_t const rows      = Get<uint32_t>(data + chunk.offset);
+        uint32_t const data_size = Get<uint32_t>(data + chunk.offset + sizeof(uint32_t));
+        size_t const data_pos    = chunk.offset + chunk_header_size;
+        if (rows != chunk.rows || rows > reader.rows_per_chunk ||
+            file_size - data_pos < data_size + FooterSize(reader.columns.size())) {
+            return false;
+        }
+        const uint8_t* footer = data + data_pos + data_size + footer_base_size;
+
+        size_t blob_pos = data_pos;
+        for (size_t col = 0; col < column; col++) {
+            blob_pos += Get<uint32_t>(footer + col * footer_column_size + 1);
+        }
+        const uint8_t* entry = footer + column * footer_column_size;
+        auto const encoding  = static_cast<ColumnEncoding>(entry[0]);
+        uint32_t const size  = Get<uint32_t>(entry + 1);
+        if (blob_pos + size > data_pos + data_size) {
+            return false;
+        }
+        VariableType const type = column == 0 ? time_type : reader.columns[column - 1].type;
+        return DecodeColumn(data + blob_pos, size, encoding, type, chunk.rows, out);
+    }
+
+    // Scratch buffers of a range read, reused for every chunk
+    typedef struct {
+        std::vector<double> time;
+        std::vector<double> values;
+        std::vector<size_t> rows;
+    } ChunkBuffers;
+
+    // Appends the rows of a chunk in [t0, t1] to out, for the given columns only (index into reader.columns).
+    // False if the time of the chunk could not be read.
+    bool AppendChunkRows(const BinaryLogReader& reader, const BinaryLogChunk& chunk, double t0, double t1,
+                         size_t stride, const std::vector<size_t>& columns, ChunkBuffers& buffers, Data& out) {
+        if (!ReadChunkColumn(reader, chunk, 0, buffers.time)) {
+            return false;
+        }
+        const std::vector<double>& time = buffers.time;
+        size_t const first = std::lower_bound(time.begin(), time.end(), t0) - time.begin();
+        size_t const last  = std::upper_bound(time.begin(), time.end(), t1) - time.begin();
+        buffers.rows.clear();
+        for (size_t row = first; row < last; row++) {
+            if ((chunk.first_row + row) % stride == 0) {
+                buffers.rows.push_back(row);
+            }
+        }
+        if (buffers.rows.empty()) {
+            return true;
+        }
+        for (size_t const row : buffers.rows) {
+            out.time.push_back(time[row]);
+        }
+        for (size_t const col : columns) {
+            std::vector<double>& signal = out.signals[reader.columns[col].name];
+            if (ReadChunkColumn(reader, chunk, col + 1, buffers.values)) {
+                for (size_t const row : buffers.rows) {
+                    signal.push_back(buffers.values[row]);
+                }
+            } else {
+                signal.resize(out.time.size(), std::numeric_limits<double>::quiet_NaN());
+            }
+        }
+        return true;
+    }
+
+    std::vector<BinaryLogChunk>::const_iterator FirstChunk(const BinaryLogReader& reader, double t0) {
+        // Chunks are in time order, skip straight to the first one that can overlap
+        return std::partition_point(reader.chunks.begin(), reader.chunks.end(),
+                                    [&](const BinaryLogChunk& c) { return c.time_max < t0; });
+    }
+} // namespace anonymous
+
+namespace binary_log {
+    bool OpenWriter(BinaryLogWriter& writer, const std::string& path, const std::vector<BinaryLogColumn>& columns) {
+        writer = {};
+        writer.file = std::fopen(path.c_str(), "wb");
+        if (writer.file == nullptr) {
+            return false;
+        }
+        writer.columns = columns;
+        writer.values.resize(columns.size());
+        writer.time_us.reserve(kRowsPerChunk);
+        for (auto& values : writer.values) {
+            values.reserve(kRowsPerChunk);
+        }
+
+        std::vector<uint8_t> header(kMagic, kMagic + sizeof(kMagic));
+        Put<uint32_t>(header, kVersion);
+        Put<uint32_t>(header, kRowsPerChunk);
+        Put<uint32_t>(header, static_cast<uint32_t>(columns.size()));
+        for (const auto& column : columns) {
+            Put<uint8_t>(header, static_cast<uint8_t>(column.type));
+            Put<uint16_t>(header, static_cast<uint16_t>(column.name.size()));
+            header.insert(header.end(), column.name.begin(), column.name.end());
+        }
+        if (std::fwrite(header.data(), 1, header.size(), writer.file) != header.size()) {
+            std::fclose(writer.file);
+            writer = {};
+            return false;
+        }
+        writer.offset = header.size();
+        return true;
+    }
+
+    bool AppendRow(BinaryLogWriter& writer, double time, const double* values) {
+        if (writer.file == nullptr || writer.failed) {
+            return false;
+        }
+        writer.time_us.push_back(std::llround(time * 1e6));
+        for (size_t col = 0; col < writer.columns.size(); col++) {
+            writer.values[col].push_back(values[col]);
+        }
+        if (writer.time_us.size() >= kRowsPerChunk) {
+            FlushChunk(writer);
+            if (std::fflush(writer.file) != 0) {
+                writer.failed = true;
+            }
+        }
+        return !writer.failed;
+    }
+
+    bool CloseWriter(BinaryLogWriter& writer, const std::string& notes) {
+        if (writer.file == nullptr) {
+            return true;
+        }
+        if (!writer.failed) {
+            FlushChunk(writer);
+        }
+
+        std::vector<uint8_t> tail(notes.begin(), notes.end());
+        uint64_t const index_offset = writer.offset + notes.size();
+        for (const auto& chunk : writer.chunks) {
+            Put<uint64_t>(tail, chunk.offset);
+            Put<uint64_t>(tail, chunk.first_row);
+            Put<uint32_t>(tail, chunk.rows);
+            Put<double>(tail, chunk.time_min);
+            Put<double>(tail, chunk.time_max);
+        }
+        Put<uint64_t>(tail, writer.offset);
+        Put<uint32_t>(tail, static_cast<uint32_t>(notes.size()));
+        Put<uint64_t>(tail, index_offset);
+        Put<uint32_t>(tail, static_cast<uint32_t>(writer.chunks.size()));
+        tail.insert(tail.end(), kEndMagic, kEndMagic + sizeof(kEndMagic));
+        // After a failed write the chunks are left for recovery, the index would not match the file
+        bool ok = !writer.failed && std::fwrite(tail.data(), 1, tail.size(), writer.file) == tail.size();
+        ok = std::fclose(writer.file) == 0 && ok;
+        writer = {};
+        return ok;
+    }
+
+    bool OpenReader(BinaryLogReader& reader, const std::string& path) {
+        reader = {};
+        if (!mapped_file::Open(reader.file, path)) {
+            return false;
+        }
+
+        const uint8_t* data = reader.file.data;
+        size_t const size   = reader.file.size;
+        size_t const fixed  = sizeof(kMagic) + 3 * sizeof(uint32_t);
+        if (size < fixed || std::memcmp(data, kMagic, sizeof(kMagic)) != 0 ||
+            Get<uint32_t>(data + sizeof(kMagic)) != kVersion) {
+            CloseReader(reader);
+            return false;
+        }
+
+        reader.rows_per_chunk = Get<uint32_t>(data + sizeof(kMagic) + sizeof(uint32_t));
+        if (reader.rows_per_chunk == 0 || reader.rows_per_chunk > max_rows_per_chunk) {
+            CloseReader(reader);
+            return false;
+        }
+        uint32_t const column_count = Get<uint32_t>(data + sizeof(kMagic) + 2 * sizeof(uint32_t));
+        size_t pos = fixed;
+        for (uint32_t i = 0; i < column_count; i++) {
+            if (pos + 3 > size) {
+                CloseReader(reader);
+                return false;
+            }
+            auto const type = static_cast<VariableType>(data[pos]);
+            uint16_t const name_len = Get<uint16_t>(data + pos + 1);
+            pos += 3;
+            if (pos + name_len > size) {
+                CloseReader(reader);
+                return false;
+            }
+            reader.columns.push_back({std::string(reinterpret_cast<const char*>(data + pos), name_len), type});
+            pos += name_len;
+        }
+
+        if (!ReadIndex(reader)) {
+            reader.chunks.clear();
+            reader.rows = 0;
+            RecoverChunks(reader, pos);
+        }
+        return true;
+    }
+
+    void CloseReader(BinaryLogReader& reader) {
+        mapped_file::Close(reader.file);
+        reader = {};
+    }
+
+    void ReadRange(const BinaryLogReader& reader, double t0, double t1, Data& out, size_t stride) {
+        out.time.clear();
+        out.signals.clear();
+        for (const auto& column : reader.columns) {
+            out.signals[column.name];
+        }
+        stride = std::max<size_t>(stride, 1);
+
+        std::vector<size_t> columns(reader.columns.size());
+        for (size_t col = 0; col < columns.size(); col++) {
+            columns[col] = col;
+        }
+        ChunkBuffers buffers;
+        for (auto chunk = FirstChunk(reader, t0); chunk != reader.chunks.end() && chunk->time_min <= t1; chunk++) {
+            if (!AppendChunkRows(reader, *chunk, t0, t1, stride, columns, buffers, out)) {
+                break;
+            }
+        }
+    }
+
+    bool ForEachChunk(const BinaryLogReader& reader, double t0, double t1, const std::vector<std::string>& columns,
+                      const std::function<bool(const Data&)>& on_rows) {
+        std::vector<size_t> wanted;
+        for (size_t col = 0; col < reader.columns.size(); col++) {
+            if (std::find(columns.begin(), columns.end(), reader.columns[col].name) != columns.end()) {
+                wanted.push_back(col);
+            }
+        }
+        ChunkBuffers buffers;
+        Data rows;
+        for (auto chunk = FirstChunk(reader, t0); chunk != reader.chunks.end() && chunk->time_min <= t1; chunk++) {
+            rows.time.clear();
+            for (size_t const col : wanted) {
+                rows.signals[reader.columns[col].name].clear();
+            }
+            if (!AppendChunkRows(reader, *chunk, t0, t1, 1, wanted, buffers, rows)) {
+                break;
+            }
+            if (!rows.time.empty() && !on_rows(rows)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint64_t RowsInRange(const BinaryLogReader& reader, double t0, double t1) {
+        uint64_t rows = 0;
+        auto chunk = FirstChunk(reader, t0);
+        for (; chunk != reader.chunks.end() && chunk->time_min <= t1; chunk++) {
+            rows += chunk->rows;
+        }
+        return rows;
+    }
+
+    bool ReadLog(const std::string& path, Data& out) {
+        BinaryLogReader reader;
+        if (!OpenReader(reader, path)) {
+            return false;
+        }
+        ReadRange(reader, -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity(), out);
+        CloseReader(reader);
+        return true;
+    }
+} // namespace binary_log
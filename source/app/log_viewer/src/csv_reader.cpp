@@ -0,0 +1,79 @@
+#include "csv_reader.h"
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+#include "rapidcsv.h"
+
+namespace {
+    std::string ReadAndCleanCSV(const std::string& file_path, char separator) {
+        std::ifstream file(file_path);
+        std::ostringstream cleaned;
+        std::string line;
+
+        while (std::getline(file, line)) {
+            // Comment lines, e.g. link statistics written by the serial logger
+            if (!line.empty() && line[0] == '#') {
+                continue;
+            }
+            // Remove trailing separator
+            while (!line.empty() && line.back() == separator) {
+                line.pop_back();
+            }
+            cleaned << line << "\n";
+        }
+
+        return cleaned.str();
+    }
+} // namespace anonymous
+
+namespace csv_reader {
+    // Custom converter for float with comma as decimal
+    float ParseCommaDecimal(const std::string& str) {
+        float float_val;
+        std::string modified;
+
+        modified = str;
+        std::replace(modified.begin(), modified.end(), ',', '.');  // NOLINT(modernize-use-ranges)
+
+        try {
+            float_val = std::stof(modified);
+        } catch (const std::exception& e) {
+            float_val = std::numeric_limits<float>::quiet_NaN();
+        }
+
+        return float_val;
+    }
+
+    void ReadCsv(const std::string& path, char separator, int header_line_idx, const std::string& time_name,
+                 Data& data) {
+        std::string const raw_csv = ReadAndCleanCSV(path, separator);
+        std::stringstream csv_stream(raw_csv);
+
+        rapidcsv::Document const doc(
+            csv_stream, rapidcsv::LabelParams(header_line_idx, -1),
+            rapidcsv::SeparatorParams(separator));
+
+        data.signals.clear();
+        data.time.clear();
+
+        for (std::string const& str : doc.GetColumnNames()) {
+            std::vector<std::string> const read_str = doc.GetColumn<std::string>(str);
+
+            if (str == time_name) {
+                for (const auto& val : read_str) {
+                    data.time.push_back(ParseCommaDecimal(val));
+                }
+            } else {
+                std::vector<double>& values = data.signals[str];
+                for (const auto& val : read_str) {
+                    values.push_back(ParseCommaDecimal(val));
+                }
+            }
+        }
+    }
+} // namespace csv_reader
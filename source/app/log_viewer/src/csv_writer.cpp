@@ -0,0 +1,104 @@
+#include "csv_writer.h"
+
+#include <algorithm>
+#include <charconv>
+#include <functional>
+#include <thread>
+
+namespace {
+    // Rows per block, large enough that each thread makes one big write worth of text
+    const size_t block_rows = 16384;
+
+    // Longest shortest-round-trip double is 24 characters
+    const size_t max_value_chars = 32;
+
+    inline char* FormatValue(char* out, double value, char decimal) {
+        char* const end = std::to_chars(out, out + max_value_chars, value).ptr;
+        if (decimal != '.') {
+            std::replace(out, end, '.', decimal);
+        }
+        return end;
+    }
+
+    void FormatBlock(std::string& buffer, const double* time, const std::vector<const double*>& columns,
+                     size_t first, size_t last, const CsvFormat& format) {
+        buffer.resize((last - first) * (columns.size() + 1) * (max_value_chars + 1));
+        char* out = buffer.data();
+        for (size_t row = first; row < last; row++) {
+            out = FormatValue(out, time[row], format.decimal);
+            for (const double* column : columns) {
+                *out++ = format.separator;
+                out = FormatValue(out, column[row], format.decimal);
+            }
+            *out++ = '\n';
+        }
+        buffer.resize(static_cast<size_t>(out - buffer.data()));
+    }
+} // namespace anonymous
+
+namespace csv_writer {
+    std::string FormatHeader(const std::vector<std::string>& columns, const CsvFormat& format) {
+        std::string header = "Time";
+        for (const auto& column : columns) {
+            header += format.separator;
+            header += column;
+        }
+        header += '\n';
+        return header;
+    }
+
+    bool WriteRows(std::FILE* file, const double* time, const std::vector<const double*>& columns,
+                   size_t rows, const CsvFormat& format, unsigned threads) {
+        if (threads == 0) {
+            threads = std::max(std::thread::hardware_concurrency(), 1U);
+        }
+        size_t const blocks = (rows + block_rows - 1) / block_rows;
+        threads = static_cast<unsigned>(std::min<size_t>(threads, std::max<size_t>(blocks, 1)));
+
+        // One round formats one block per thread, then the blocks are written in order
+        std::vector<std::string> buffers(threads);
+        for (size_t round = 0; round < blocks; round += threads) {
+            size_t const round_blocks = std::min<size_t>(threads, blocks - round);
+            std::vector<std::thread> workers;
+            for (size_t t = 1; t < round_blocks; t++) {
+                size_t const first = (round + t) * block_rows;
+                workers.emplace_back(FormatBlock, std::ref(buffers[t]), time, std::cref(columns), first,
+                                     std::min(first + block_rows, rows), std::cref(format));
+            }
+            size_t const first = round * block_rows;
+            FormatBlock(buffers[0], time, columns, first, std::min(first + block_rows, rows), format);
+            for (auto& worker : workers) {
+                worker.join();
+            }
+
+            for (size_t t = 0; t < round_blocks; t++) {
+                if (std::fwrite(buffers[t].data(), 1, buffers[t].size(), file) != buffers[t].size()) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool WriteCsv(const std::string& path, const Data& data, const std::vector<std::string>& columns,
+                  const CsvFormat& format, unsigned threads) {
+        std::vector<const double*> column_data;
+        for (const auto& name : columns) {
+            auto it = data.signals.find(name);
+            if (it == data.signals.end() || it->second.size() < data.time.size()) {
+                return false;
+            }
+            column_data.push_back(it->second.data());
+        }
+
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr) {
+            return false;
+        }
+        std::string const header = FormatHeader(columns, format);
+        bool ok = std::fwrite(header.data(), 1, header.size(), file) == header.size();
+        ok = ok && WriteRows(file, data.time.data(), column_data, data.time.size(), format, threads);
+        ok = (std::fclose(file) == 0) && ok;
+        return ok;
+    }
+} // namespace csv_writer
@@ -0,0 +1,40 @@
+#include "decimation.h"
+
+#include <algorithm>
+#include <cstddef>
+
+namespace decimation {
+    void Decimate(const std::vector<double>& input, int time_min_idx, int time_max_idx, int m, bool keep_first,
+                  std::vector<double>& result) {
+        result.clear();
+        if (input.empty()) return;
+
+        if (keep_first) {
+            result.push_back(input[0]);
+        }
+
+        size_t i;
+        for (i = std::max(time_min_idx, 1); i < std::min(input.size() - 1, static_cast<size_t>(time_max_idx)); i += m) {
+            result.push_back(input[i]);
+        }
+        if (i <= input.size() - 1) {
+            result.push_back(input[input.size() - 1]);
+        }
+    }
+
+    void CalculateDecimationData(const std::vector<double>& time, double x_min, double x_max,
+                                 DecimationData& decimation_data) {
+        if (time.size() < 2) {
+            decimation_data.decimation_factor = 1.0;
+            decimation_data.visible_min_idx = 0;
+            decimation_data.visible_max_idx = 0;
+            return;
+        }
+        double samples_in_range = (x_max - x_min) / (time[1] - time[0]);
+        decimation_data.decimation_factor = std::max(samples_in_range / kMaxSamplesInView, 1.0);
+        auto visible_min_it = std::lower_bound(time.begin(), time.end(), x_min);
+        decimation_data.visible_min_idx = std::max(static_cast<int>(std::distance(time.begin(), visible_min_it)) - 1, 0);
+        auto visible_max_it = std::upper_bound(time.begin(), time.end(), x_max);
+        decimation_data.visible_max_idx = static_cast<int>(std::distance(time.begin(), visible_max_it));
+    }
+} // namespace decimation
@@ -0,0 +1,429 @@
+#include "log_export.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "ImGuiFileDialog.h"
+#include "binary_log.h"
+#include "csv_writer.h"
+#include "data_cursors.h"
+#include "data_logger.h"
+#include "imgui.h"
+#include "layout.h"
+#include "resample.h"
+#include "settings.h"
+
+namespace log_export {
+namespace {
+std::thread export_thread;
+std::atomic<bool> running = false;
+std::mutex status_mutex;
+std::string status;
+
+// Rows of a paged log read and written at a time
+const size_t batch_rows = 1 << 16;
+
+bool show_export_window = false;
+int selected_format = EXPORT_FORMAT_CSV;
+bool resample_enabled = false;
+double resample_hz = 1000.0;
+int resample_mode = RESAMPLE_ZERO_ORDER_HOLD;
+
+void SetStatus(const std::string& text) {
+    const std::lock_guard<std::mutex> lock(status_mutex);
+    status = text;
+}
+
+std::string GetStatus() {
+    const std::lock_guard<std::mutex> lock(status_mutex);
+    return status;
+}
+
+std::string TooManyRowsText() {
+    char text[128];
+    std::snprintf(text, sizeof(text), "ERROR: Resampling gives more than %zu rows, lower the rate",
+                  resample::kMaxGridPoints);
+    return text;
+}
+
+// Signals enabled in any subplot, in subplot order
+std::vector<std::string> EnabledSignals() {
+    std::vector<std::string> signals;
+    for (const auto& subplot : layout::subplots_map) {
+        std::vector<std::string> enabled;
+        for (const auto& [signal_name, is_enabled] : subplot) {
+            if (is_enabled && std::find(signals.begin(), signals.end(), signal_name) == signals.end()) {
+                enabled.push_back(signal_name);
+            }
+        }
+        std::sort(enabled.begin(), enabled.end());
+        signals.insert(signals.end(), enabled.begin(), enabled.end());
+    }
+    return signals;
+}
+
+// Output file of an export, written one block of rows at a time
+typedef struct {
+    ExportFormat             format;
+    CsvFormat                csv_format;
+    std::vector<std::string> signals;
+    std::FILE*               csv_file;
+    BinaryLogWriter          binary_writer;
+    size_t                   rows;
+} ExportSink;
+
+bool OpenSink(ExportSink& sink, const ExportRequest& request, CsvFormat csv_format) {
+    sink = {};
+    sink.format = request.format;
+    sink.csv_format = csv_format;
+    sink.signals = request.signals;
+    if (sink.format == EXPORT_FORMAT_CSV) {
+        sink.csv_file = std::fopen(request.path.c_str(), "wb");
+        if (sink.csv_file == nullptr) {
+            return false;
+        }
+        std::string const header = csv_writer::FormatHeader(sink.signals, csv_format);
+        return std::fwrite(header.data(), 1, header.size(), sink.csv_file) == header.size();
+    }
+
+    std::vector<BinaryLogColumn> columns;
+    for (const auto& name : sink.signals) {
+        columns.push_back({name, TYPE_DOUBLE});
+    }
+    return binary_log::OpenWriter(sink.binary_writer, request.path, columns);
+}
+
+// rows holds all signals of the sink
+bool WriteSink(ExportSink& sink, const Data& rows) {
+    std::vector<const double*> columns;
+    for (const auto& name : sink.signals) {
+        columns.push_back(rows.signals.at(name).data());
+    }
+    sink.rows += rows.time.size();
+    if (sink.format == EXPORT_FORMAT_CSV) {
+        return csv_writer::WriteRows(sink.csv_file, rows.time.data(), columns, rows.time.size(), sink.csv_format);
+    }
+
+    std::vector<double> row_values(columns.size());
+    for (size_t row = 0; row < rows.time.size(); row++) {
+        for (size_t col = 0; col < columns.size(); col++) {
+            row_values[col] = columns[col][row];
+        }
+        if (!binary_log::AppendRow(sink.binary_writer, rows.time[row], row_values.data())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CloseSink(ExportSink& sink) {
+    if (sink.format == EXPORT_FORMAT_CSV) {
+        bool const ok = sink.csv_file == nullptr || std::fclose(sink.csv_file) == 0;
+        sink.csv_file = nullptr;
+        return ok;
+    }
+    return binary_log::CloseWriter(sink.binary_writer, "");
+}
+
+void Finish(bool ok, const ExportSink& sink, const ExportRequest& request,
+            std::chrono::steady_clock::time_point start) {
+    double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    char text[512];
+    if (!ok) {
+        std::snprintf(text, sizeof(text), "ERROR: Could not write %s", request.path.c_str());
+    } else if (sink.rows == 0) {
+        std::snprintf(text, sizeof(text), "Nothing to export in the cursor range");
+    } else {
+        std::snprintf(text, sizeof(text), "Exported %zu rows x %zu signals in %.3f s to %s", sink.rows,
+                      request.signals.size(), seconds, request.path.c_str());
+    }
+    SetStatus(text);
+    running = false;
+}
+
+void ExportTask(Data slice, ExportRequest request, CsvFormat csv_format) {
+    auto const start = std::chrono::steady_clock::now();
+
+    Data resampled;
+    const Data* out = &slice;
+    if (request.resample_hz > 0.0) {
+        std::vector<double> grid;
+        if (!resample::FixedGrid(request.t0, request.t1, request.resample_hz, grid)) {
+            SetStatus(TooManyRowsText());
+            running = false;
+            return;
+        }
+        resampled = resample::ResampleData(slice, request.signals, grid, request.resample_mode);
+        out = &resampled;
+    }
+
+    ExportSink sink;
+    bool ok = OpenSink(sink, request, csv_format) && WriteSink(sink, *out);
+    ok = CloseSink(sink) && ok;
+    Finish(ok, sink, request, start);
+}
+
+/*
+ * Streams the range from the file of a paged log, so at most a batch of rows is in memory.
+ * When resampling, each batch gives the grid points up to its last row and that row is kept
+ * for the points after it.
+ */
+void ExportPagedTask(std::string log_path, ExportRequest request, CsvFormat csv_format) {
+    auto const start = std::chrono::steady_clock::now();
+
+    BinaryLogReader reader;
+    if (!binary_log::OpenReader(reader, log_path)) {
+        SetStatus("ERROR: Could not read " + log_path);
+        running = false;
+        return;
+    }
+    std::vector<std::string> signals;
+    for (const auto& name : request.signals) {
+        if (std::any_of(reader.columns.begin(), reader.columns.end(),
+                        [&](const BinaryLogColumn& column) { return column.name == name; })) {
+            signals.push_back(name);
+        }
+    }
+    request.signals = signals;
+
+    bool const resampling = request.resample_hz > 0.0;
+    double read_t0 = request.t0;
+    double read_t1 = request.t1;
+    if (resampling) {
+        // One chunk more at each end holds the samples just outside the range
+        auto const first = std::partition_point(reader.chunks.begin(), reader.chunks.end(),
+                                                [&](const BinaryLogChunk& c) { return c.time_max < request.t0; });
+        auto const last = std::partition_point(reader.chunks.begin(), reader.chunks.end(),
+                                               [&](const BinaryLogChunk& c) { return c.time_min <= request.t1; });
+        read_t0 = first == reader.chunks.begin() ? -std::numeric_limits<double>::infinity() : (first - 1)->time_min;
+        read_t1 = last == reader.chunks.end() ? std::numeric_limits<double>::infinity() : last->time_max;
+    }
+    size_t const grid_points =
+        resampling ? static_cast<size_t>(resample::GridPoints(request.t0, request.t1, request.resample_hz)) : 0;
+    size_t next_point = 0;
+
+    Data batch;
+    for (const auto& name : signals) {
+        batch.signals[name];
+    }
+    ExportSink sink;
+    bool ok = OpenSink(sink, request, csv_format);
+
+    // The last batch also gives the grid points after the last row
+    auto write_batch = [&](bool last_batch) {
+        if (!resampling) {
+            ok = ok && WriteSink(sink, batch);
+        }
+        std::vector<double> grid;
+        while (ok && resampling && !batch.time.empty() && next_point < grid_points) {
+            grid.clear();
+            for (; next_point < grid_points && grid.size() < batch_rows; next_point++) {
+                // Same points as resample::FixedGrid
+                double const t = request.t0 + static_cast<double>(next_point) / request.resample_hz;
+                if (!last_batch && t > batch.time.back()) {
+                    break;
+                }
+                grid.push_back(t);
+            }
+            if (grid.empty()) {
+                break;
+            }
+            ok = WriteSink(sink, resample::ResampleData(batch, signals, grid, request.resample_mode));
+        }
+        size_t const keep = resampling && !batch.time.empty() ? 1 : 0;
+        batch.time.erase(batch.time.begin(), batch.time.end() - keep);
+        for (auto& [name, values] : batch.signals) {
+            values.erase(values.begin(), values.end() - keep);
+        }
+    };
+
+    if (ok) {
+        ok = binary_log::ForEachChunk(reader, read_t0, read_t1, signals, [&](const Data& rows) {
+            batch.time.insert(batch.time.end(), rows.time.begin(), rows.time.end());
+            for (auto& [name, values] : batch.signals) {
+                const std::vector<double>& chunk_values = rows.signals.at(name);
+                values.insert(values.end(), chunk_values.begin(), chunk_values.end());
+            }
+            if (batch.time.size() >= batch_rows) {
+                write_batch(false);
+            }
+            return ok;
+        });
+    }
+    if (ok) {
+        write_batch(true);
+    }
+    binary_log::CloseReader(reader);
+    ok = CloseSink(sink) && ok;
+    Finish(ok, sink, request, start);
+}
+}  // namespace
+
+bool Start(const Data& data, const ExportRequest& request) {
+    if (running) {
+        return false;
+    }
+    if (export_thread.joinable()) {
+        export_thread.join();
+    }
+
+    // Only the slice is copied, the rest of the log is never touched
+    auto first = std::lower_bound(data.time.begin(), data.time.end(), request.t0);
+    auto const last = std::upper_bound(data.time.begin(), data.time.end(), request.t1);
+    if (request.resample_hz > 0.0 && first != data.time.begin()) {
+        // Sample before the range, held or interpolated from at the first grid points
+        first--;
+    }
+    auto last_copied = last;
+    if (request.resample_hz > 0.0 && last_copied != data.time.end()) {
+        // And the one after, for interpolation at the last grid points
+        last_copied++;
+    }
+    if (first >= last || request.signals.empty()) {
+        SetStatus("Nothing to export in the cursor range");
+        return false;
+    }
+    if (request.resample_hz > 0.0 &&
+        resample::GridPoints(request.t0, request.t1, request.resample_hz) > resample::kMaxGridPoints) {
+        SetStatus(TooManyRowsText());
+        return false;
+    }
+    size_t const first_idx = static_cast<size_t>(first - data.time.begin());
+    size_t const last_idx = static_cast<size_t>(last_copied - data.time.begin());
+
+    Data slice;
+    slice.time.assign(first, last_copied);
+    ExportRequest request_copy = request;
+    request_copy.signals.clear();
+    for (const auto& name : request.signals) {
+        auto it = data.signals.find(name);
+        if (it == data.signals.end() || it->second.size() < last_idx) {
+            continue;
+        }
+        slice.signals[name].assign(it->second.begin() + first_idx, it->second.begin() + last_idx);
+        request_copy.signals.push_back(name);
+    }
+
+    running = true;
+    SetStatus("Exporting...");
+    export_thread = std::thread(ExportTask, std::move(slice), std::move(request_copy), settings::GetCsvFormat());
+    return true;
+}
+
+bool StartPaged(const std::string& log_path, const ExportRequest& request) {
+    if (running) {
+        return false;
+    }
+    if (export_thread.joinable()) {
+        export_thread.join();
+    }
+    if (!(request.t0 <= request.t1) || request.signals.empty()) {
+        SetStatus("Nothing to export in the cursor range");
+        return false;
+    }
+    if (request.resample_hz > 0.0 &&
+        resample::GridPoints(request.t0, request.t1, request.resample_hz) > resample::kMaxGridPoints) {
+        SetStatus(TooManyRowsText());
+        return false;
+    }
+
+    running = true;
+    SetStatus("Exporting...");
+    export_thread = std::thread(ExportPagedTask, log_path, request, settings::GetCsvFormat());
+    return true;
+}
+
+bool IsRunning() {
+    return running;
+}
+
+void DeInit() {
+    if (export_thread.joinable()) {
+        export_thread.join();
+    }
+}
+
+void ExportMenuButton() {
+    if (ImGui::MenuItem("Export Range")) {
+        show_export_window = true;
+    }
+}
+
+void GuiUpdate() {
+    if (!show_export_window) {
+        return;
+    }
+
+    double const t0 = std::min(v_line_1_pos, v_line_2_pos);
+    double const t1 = std::max(v_line_1_pos, v_line_2_pos);
+    std::vector<std::string> const signals = EnabledSignals();
+
+    ImGui::Begin("Export Range", &show_export_window);
+    ImGui::Text("Cursor range: %.6f - %.6f s", t0, t1);
+    ImGui::Text("Signals: %zu enabled in the layout", signals.size());
+    ImGui::RadioButton("CSV", &selected_format, EXPORT_FORMAT_CSV);
+    ImGui::SameLine();
+    ImGui::RadioButton("Binary (.jvbl)", &selected_format, EXPORT_FORMAT_BINARY);
+    ImGui::Checkbox("Resample to fixed rate", &resample_enabled);
+    if (resample_enabled) {
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(120.0F);
+        ImGui::InputDouble("Hz", &resample_hz, 0.0, 0.0, "%.1f");
+        resample_hz = std::max(resample_hz, 0.001);
+        ImGui::RadioButton("Zero-order hold", &resample_mode, RESAMPLE_ZERO_ORDER_HOLD);
+        ImGui::SameLine();
+        ImGui::RadioButton("Linear", &resample_mode, RESAMPLE_LINEAR);
+        ImGui::SameLine();
+        ImGui::RadioButton("Nearest", &resample_mode, RESAMPLE_NEAREST);
+    }
+    bool const too_many_rows =
+        resample_enabled && resample::GridPoints(t0, t1, resample_hz) > resample::kMaxGridPoints;
+    if (too_many_rows) {
+        ImGui::TextUnformatted(TooManyRowsText().c_str());
+    }
+
+    ImGui::BeginDisabled(running || signals.empty() || too_many_rows);
+    if (ImGui::Button("Export...")) {
+        IGFD::FileDialogConfig config;
+        config.path = settings::GetSettings()->file_path;
+        config.flags = ImGuiFileDialogFlags_Modal | ImGuiFileDialogFlags_ConfirmOverwrite;
+        const char* filters = selected_format == EXPORT_FORMAT_CSV ? ".csv" : ".jvbl";
+        ImGuiFileDialog::Instance()->OpenDialog("ChooseFileExport", "Export To", filters, config);
+    }
+    ImGui::EndDisabled();
+    ImGui::TextUnformatted(GetStatus().c_str());
+    ImGui::End();
+
+    if (ImGuiFileDialog::Instance()->Display("ChooseFileExport")) {
+        if (ImGuiFileDialog::Instance()->IsOk()) {
+            ExportRequest const request = {
+                .path = ImGuiFileDialog::Instance()->GetFilePathName(),
+                .format = static_cast<ExportFormat>(selected_format),
+                .t0 = t0,
+                .t1 = t1,
+                .signals = signals,
+                .resample_hz = resample_enabled ? resample_hz : 0.0,
+                .resample_mode = static_cast<ResampleMode>(resample_mode),
+            };
+            if (IsLogPaged()) {
+                // Only an overview is loaded, the full rows are read from the file by the export
+                StartPaged(GetPagedLogPath(), request);
+            } else {
+                // The serial log is appended to from the serial thread
+                std::unique_lock<std::mutex> log_lock;
+                if (GetLogSource() == LOG_SOURCE_SERIAL) {
+                    log_lock = data_logger::LockLogData();
+                }
+                Start(*GetData(), request);
+            }
+        }
+        ImGuiFileDialog::Instance()->Close();
+    }
+}
+}  // namespace log_export
@@ -1,8 +1,10 @@
 #include "log_reader.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <exception>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <limits>
@@ -12,9 +14,10 @@
 #include <vector>
 
 #include "ImGuiFileDialog.h"
+#include "binary_log.h"
+#include "csv_reader.h"
 #include "data_cursors.h"
 #include "imgui.h"
-#include "rapidcsv.h"
 #include "settings.h"
 #include "layout.h"
 #include "data_logger.h"
@@ -28,68 +31,60 @@ Data data = {
 };
 
 LogSource log_source = LOG_SOURCE_CSV;
-
-std::string ReadAndCleanCSV(const std::string& file_path) {
-    std::ifstream file(file_path);
-    std::ostringstream cleaned;
-    std::string line;
-
-    while (std::getline(file, line)) {
-        // Remove trailing separator
-        while (!line.empty() && line.back() == settings::GetSettings()->separator[0]) {
-            line.pop_back();
-        }
-        cleaned << line << "\n";
-    }
-
-    return cleaned.str();
+std::atomic<uint64_t> log_version = 0;   // Bumped by the serial thread too
+
+// Binary logs above this are loaded as an overview and paged
+const uint64_t max_loaded_rows = 1000000;
+BinaryLogReader binary_reader = {};
+std::string binary_path;
+size_t overview_stride = 1;
+
+void CloseBinaryLog() {
+    binary_log::CloseReader(binary_reader);
+    binary_path.clear();
+    overview_stride = 1;
 }
 
-// Custom converter for float with comma as decimal
-float ParseCommaDecimal(const std::string& str) {
-    float float_val;
-    std::string modified;
-
-    modified = str;
-    std::replace(modified.begin(), modified.end(), ',', '.');  // NOLINT(modernize-use-ranges)
+void ReadCSV(std::string const& file) {
+    log_source = LOG_SOURCE_CSV;
+    log_version++;
+    CloseBinaryLog();
+    csv_reader::ReadCsv(file, settings::GetSettings()->separator[0], settings::GetSettings()->header_line_idx,
+                        settings::GetSettings()->time_name, data);
+    layout::subplots_map.clear();
 
-    try {
-        float_val = std::stof(modified);
-    } catch (const std::exception& e) {
-        float_val = std::numeric_limits<float>::quiet_NaN();
-    }
+   layout::SetMapToLayout();
 
-    return float_val;
+    v_line_1_pos = data.time[data.time.size() >> 2];
+    v_line_2_pos = data.time[data.time.size() - (data.time.size() >> 2)];
 }
 
-void ReadCSV(std::string const& file) {
+void ReadBinaryLog(std::string const& file) {
     log_source = LOG_SOURCE_CSV;
-    std::string const raw_csv = ReadAndCleanCSV(file);
-    std::stringstream csv_stream(raw_csv);
-
-    rapidcsv::Document const doc(
-        csv_stream, rapidcsv::LabelParams(settings::GetSettings()->header_line_idx, -1),
-        rapidcsv::SeparatorParams(settings::GetSettings()->separator[0]));
-
-    data.signals.clear();
+    log_version++;
     layout::subplots_map.clear();
-    data.time.clear();
-
-    for (std::string const& str : doc.GetColumnNames()) {
-        std::vector<std::string> const read_str = doc.GetColumn<std::string>(str);
-
-        if (str == std::string(settings::GetSettings()->time_name)) {
-            for (const auto& val : read_str) {
-                data.time.push_back(ParseCommaDecimal(val));
-            }
-        } else {
-            for (const auto& val : read_str) {
-                data.signals[str].push_back(ParseCommaDecimal(val));
-            }
-        }
+    CloseBinaryLog();
+    if (!binary_log::OpenReader(binary_reader, file)) {
+        data.signals.clear();
+        data.time = {0};
+        return;
+    }
+    binary_path = file;
+    overview_stride = static_cast<size_t>(std::max<uint64_t>(1, (binary_reader.rows + max_loaded_rows - 1) /
+                                                                   max_loaded_rows));
+    binary_log::ReadRange(binary_reader, -std::numeric_limits<double>::infinity(),
+                          std::numeric_limits<double>::infinity(), data, overview_stride);
+    if (overview_stride == 1) {
+        CloseBinaryLog();   // All rows are loaded
+    }
+    if (data.time.empty()) {
+        CloseBinaryLog();
+        data.signals.clear();
+        data.time = {0};
+        return;
     }
 
-   layout::SetMapToLayout();
+    layout::SetMapToLayout();
 
     v_line_1_pos = data.time[data.time.size() >> 2];
     v_line_2_pos = data.time[data.time.size() - (data.time.size() >> 2)];
@@ -120,8 +115,35 @@ void ClearData() {
     data.time.clear();
 }
 
+// The file is only closed from the GUI thread, by opening another log
+bool IsLogPaged() {
+    return log_source != LOG_SOURCE_SERIAL && overview_stride > 1;
+}
+
+uint64_t GetLogVersion() {
+    return log_version;
+}
+
+bool ReadLogRange(double t0, double t1, size_t max_rows, Data& out) {
+    if (!IsLogPaged()) {
+        return false;
+    }
+    uint64_t const rows = binary_log::RowsInRange(binary_reader, t0, t1);
+    size_t const stride = max_rows > 0 ? static_cast<size_t>(std::max<uint64_t>(1, (rows + max_rows - 1) / max_rows)) : 1;
+    if (stride >= overview_stride) {
+        return false;
+    }
+    binary_log::ReadRange(binary_reader, t0, t1, out, stride);
+    return true;
+}
+
+std::string GetPagedLogPath() {
+    return IsLogPaged() ? binary_path : std::string();
+}
+
 void InitSerialStream(std::unordered_map<std::string, VarStruct> log_variables) {
     log_source = LOG_SOURCE_SERIAL;
+    log_version++;
     ClearData();
     layout::subplots_map.clear();
 
@@ -147,7 +169,11 @@ void LogReadButton() {
         if (ImGuiFileDialog::Instance()->IsOk()) {
             std::string const file_path_name = ImGuiFileDialog::Instance()->GetFilePathName();
             settings::SetLogFilePath(ImGuiFileDialog::Instance()->GetCurrentPath());
-            ReadCSV(file_path_name);
+            if (std::filesystem::path(file_path_name).extension() == ".jvbl") {
+                ReadBinaryLog(file_path_name);
+            } else {
+                ReadCSV(file_path_name);
+            }
         }
 
         // close
@@ -16,28 +16,23 @@
 
 #include "ImGuiFileDialog.h"
 #include "data_cursors.h"
+#include "decimation.h"
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 #include "implot.h"
 #include "layout.h"
 #include "licenses.h"
+#include "log_export.h"
 #include "log_reader.h"
 #include "math.h"
+#include "memory_stats.h"
 #include "rapidcsv.h"
 #include "settings.h"
 #include "serial_back.h"
+#include "data_logger.h"
 #include "performance_analysis.h"
 
-typedef struct {
-    double decimation_factor;
-    int visible_min_idx;
-    int visible_max_idx;
-
-} DecimationData;
-
-std::vector<double> Decimate(const std::vector<double>& input, int time_min_idx, int time_max_idx,
-                             int m);
 void ManageSubplot(int subplot_index,
                    std::unordered_map<std::string, std::vector<double>>* const signals,
                    std::vector<std::unordered_map<std::string, bool>>* subplots_map);
@@ -53,25 +48,18 @@ int subplot_idx = 0;
 double cursor_delta = 0;
 bool show_performance_window = false;
 
+// Serial log rows spilled out of RAM, paged in when the view is scrolled before log_data,
+// or the rows in view of a paged binary log. Loaded with margin on both sides and
+// decimated on read, so memory stays bounded.
+Data history;
+double history_t0 = 0.0;
+double history_t1 = 0.0;
+uint64_t history_log_version = 0;
+const size_t max_history_rows = 30000;
 
-// Decimates the input vector between indices [time_min_idx, time_max_idx] with step m.
-std::vector<double> Decimate(const std::vector<double>& input, int time_min_idx, int time_max_idx, int m) {
-  std::vector<double> result;
-  if (input.empty()) return result;
-
-  if (!serial_log_running) {
-    result.push_back(input[0]);
-  }
-
-  size_t i;
-  for (i = std::max(time_min_idx, 1); i < std::min(input.size() - 1, static_cast<size_t>(time_max_idx)); i += m) {
-    result.push_back(input[i]);
-  }
-  if (i <= input.size() - 1) {
-    result.push_back(input[input.size() - 1]);
-  }
-  return result;
-}
+// Decimated visible rows, kept between frames so a redraw reuses their memory
+std::vector<double> time_decimated;
+std::unordered_map<std::string, std::vector<double>> signals_decimated;
 
 
 // Handles the management UI for a subplot (signals, insert/remove).
@@ -119,6 +107,8 @@ void ManageSubplot(int subplot_index,
 static void MenuBar() {
   ImGui::BeginMenuBar();
   LogReadButton();
+  log_export::ExportMenuButton();
+  log_export::GuiUpdate();
   ImGui::Text("|");
   settings::ShowSettingsButton();
   ImGui::Text("|");
@@ -162,22 +152,56 @@ static void MenuBar() {
 }
 
 
-// Calculates decimation factor and visible indices for the current x range.
-static void CalculateDecimationData(const ImPlotRange& x_range_loc, DecimationData& decimation_data) {
-  const auto& time = GetData()->time;
-  if (time.size() < 2) {
-    decimation_data.decimation_factor = 1.0;
-    decimation_data.visible_min_idx = 0;
-    decimation_data.visible_max_idx = 0;
+// Pages the rows in view of a binary log loaded as an overview.
+static void UpdatePagedRows(const ImPlotRange& x_range_loc) {
+  if (!history.time.empty() && x_range_loc.Min >= history_t0 && x_range_loc.Max <= history_t1) {
     return;
   }
-  double samples_in_range = (x_range_loc.Max - x_range_loc.Min) / (time[1] - time[0]);
-  double max_samples_in_view = 1e4;
-  decimation_data.decimation_factor = std::max(samples_in_range / max_samples_in_view, 1.0);
-  auto visible_min_it = std::lower_bound(time.begin(), time.end(), x_range_loc.Min);
-  decimation_data.visible_min_idx = std::max(static_cast<int>(std::distance(time.begin(), visible_min_it)) - 1, 0);
-  auto visible_max_it = std::upper_bound(time.begin(), time.end(), x_range_loc.Max);
-  decimation_data.visible_max_idx = static_cast<int>(std::distance(time.begin(), visible_max_it));
+  double const span = x_range_loc.Max - x_range_loc.Min;
+  history_t0 = x_range_loc.Min - span;
+  history_t1 = x_range_loc.Max + span;
+  if (!ReadLogRange(history_t0, history_t1, max_history_rows, history)) {
+    // Zoomed out, the overview is as fine as what the file would give
+    history.time.clear();
+    history.signals.clear();
+  }
+}
+
+// Pages spilled serial log history in or out for the x range. Takes the log_data
+// lock only to find the oldest row in RAM, the spill file is read without it.
+static void UpdateHistory(const ImPlotRange& x_range_loc) {
+  if (history_log_version != GetLogVersion()) {
+    history_log_version = GetLogVersion();
+    history.time.clear();
+    history.signals.clear();
+  }
+  if (IsLogPaged()) {
+    UpdatePagedRows(x_range_loc);
+    return;
+  }
+  double ram_start = 0.0;
+  bool has_rows = false;
+  if (GetLogSource() == LogSource::LOG_SOURCE_SERIAL && data_logger::GetSpilledRows() > 0) {
+    auto const log_lock = data_logger::LockLogData();
+    has_rows = !GetData()->time.empty();
+    ram_start = has_rows ? GetData()->time.front() : 0.0;
+  }
+  if (!has_rows) {
+    history.time.clear();
+    history.signals.clear();
+    return;
+  }
+  if (x_range_loc.Min >= ram_start) {
+    return;
+  }
+  double const visible_end = std::min(x_range_loc.Max, ram_start);
+  if (!history.time.empty() && x_range_loc.Min >= history_t0 && visible_end <= history_t1) {
+    return;
+  }
+  double const span = x_range_loc.Max - x_range_loc.Min;
+  history_t0 = x_range_loc.Min - span;
+  history_t1 = std::min(x_range_loc.Max + span, ram_start);
+  data_logger::ReadHistory(history_t0, history_t1, max_history_rows, history);
 }
 
 
@@ -210,7 +234,14 @@ std::string GetFormattedValue(double value) {
 
 // Draws the cursor data table for each subplot.
 static void CursorDataTable(const std::vector<float>& plot_y_pos, float value_column_size) {
-  const auto& time = GetData()->time;
+  // Rows paged in from a binary log are finer than the overview
+  Data* cursor_data = GetData();
+  if (IsLogPaged() && !history.time.empty() &&
+      std::min(v_line_1_pos, v_line_2_pos) >= history.time.front() &&
+      std::max(v_line_1_pos, v_line_2_pos) <= history.time.back()) {
+    cursor_data = &history;
+  }
+  const auto& time = cursor_data->time;
   auto vline_1_it = std::upper_bound(time.begin(), time.end(), v_line_1_pos);
   if (vline_1_it != time.begin()) --vline_1_it;
   int vline_1_idx = static_cast<int>(std::distance(time.begin(), vline_1_it));
@@ -220,9 +251,9 @@ static void CursorDataTable(const std::vector<float>& plot_y_pos, float value_co
 
   double cursor_1_time = 0;
   double cursor_2_time = 0;
-  if (GetData()->time.size() > 0) {
-    cursor_1_time = GetData()->time[vline_1_idx];
-    cursor_2_time = GetData()->time[vline_2_idx];
+  if (time.size() > 0) {
+    cursor_1_time = time[vline_1_idx];
+    cursor_2_time = time[vline_2_idx];
   }
   cursor_delta = std::abs(cursor_2_time-cursor_1_time);
 
@@ -276,14 +307,14 @@ static void CursorDataTable(const std::vector<float>& plot_y_pos, float value_co
         ImGui::Text("%s", signal_name.c_str());
         ImGui::TableSetColumnIndex(1);
         if (!serial_log_running) {
-          ImGui::Text("%s", GetFormattedValue(GetData()->signals[signal_name][vline_1_idx]).c_str());
+          ImGui::Text("%s", GetFormattedValue(cursor_data->signals[signal_name][vline_1_idx]).c_str());
         } else {
           // Not applicable for serial log, show "-"
           ImGui::Text("%s", "-");
         }
         ImGui::TableSetColumnIndex(2);
         if (!serial_log_running) {
-          ImGui::Text("%s", GetFormattedValue(GetData()->signals[signal_name][vline_2_idx]).c_str());
+          ImGui::Text("%s", GetFormattedValue(cursor_data->signals[signal_name][vline_2_idx]).c_str());
         } else {
           // For serial log, show the latest value
           std::string cursor_value = "-";
@@ -320,11 +351,28 @@ void MainWindow(ImGuiIO& io) {
     (GetLogSource() == LogSource::LOG_SOURCE_SERIAL);
 
   MenuBar();
+
+  UpdateHistory(x_range);
+  // The writer thread drops old rows from log_data, hold it while plotting
+  std::unique_lock<std::mutex> log_lock;
+  if (GetLogSource() == LogSource::LOG_SOURCE_SERIAL) {
+    log_lock = data_logger::LockLogData();
+  }
+
   if (serial_log_running) {
     double Min = x_range.Max - static_cast<double>(visible_x_when_serial_log);
     x_range.Min = (Min>x_range.Min) ? Min : x_range.Min;
   }
-  CalculateDecimationData(x_range, decimation_data);
+  decimation::CalculateDecimationData(GetData()->time, x_range.Min, x_range.Max, decimation_data);
+  int const decimation_step = static_cast<int>(decimation_data.decimation_factor + 0.5f);
+  decimation::Decimate(GetData()->time, decimation_data.visible_min_idx, decimation_data.visible_max_idx,
+                       decimation_step, !serial_log_running, time_decimated);
+  // Drop buffers of signals from an earlier log
+  if (signals_decimated.size() > GetData()->signals.size()) {
+    signals_decimated.clear();
+  }
+  // Paged rows cover the whole view, the overview under them is not drawn
+  bool const paged_in_view = IsLogPaged() && !history.time.empty();
 
   ImPlot::BeginSubplots("", static_cast<int>(subplot_count), 1,
                         ImVec2(io.DisplaySize.x - cursor_table_size-30, io.DisplaySize.y - 85),
@@ -370,16 +418,24 @@ void MainWindow(ImGuiIO& io) {
     // Plot signals
     for (const auto& [signal_name, is_enabled] : layout::subplots_map[i]) {
       if (is_enabled) {
-        std::vector<double> time_dec = Decimate(GetData()->time, decimation_data.visible_min_idx, decimation_data.visible_max_idx,
-                                                static_cast<int>(decimation_data.decimation_factor + 0.5f));
-        std::vector<double> val = Decimate(GetData()->signals[signal_name], decimation_data.visible_min_idx, decimation_data.visible_max_idx,
-                                           static_cast<int>(decimation_data.decimation_factor + 0.5f));
+        auto history_it = history.signals.find(signal_name);
+        if (history_it != history.signals.end() && !history_it->second.empty()) {
+          // Same label, ImPlot draws it as the same item
+          ImPlot::PlotStairs(signal_name.c_str(), history.time.data(), history_it->second.data(),
+                             static_cast<int>(history_it->second.size()));
+        }
+        if (paged_in_view) {
+          continue;
+        }
+        std::vector<double>& val = signals_decimated[signal_name];
+        decimation::Decimate(GetData()->signals[signal_name], decimation_data.visible_min_idx, decimation_data.visible_max_idx,
+                             decimation_step, !serial_log_running, val);
         // replace the first value with the first visible value, and same for last value, so that auto-range works
         if (val.size() > 4) {
             val[0] = val[1];
             val[val.size()-1] = val[val.size()-2];
         }
-        ImPlot::PlotStairs(signal_name.c_str(), time_dec.data(), val.data(), val.size());
+        ImPlot::PlotStairs(signal_name.c_str(), time_decimated.data(), val.data(), val.size());
       }
     }
     x_range = ImPlot::GetPlotLimits().X;
@@ -391,4 +447,20 @@ void MainWindow(ImGuiIO& io) {
 
   ImPlot::EndSubplots();
   CursorDataTable(plot_y_pos, cursor_table_size);
-}
\ No newline at end of file
+}
+
+size_t GetDecimationBufferBytes() {
+  size_t bytes = memory_stats::VectorBytes(time_decimated);
+  for (const auto& [name, values] : signals_decimated) {
+    bytes += memory_stats::VectorBytes(values);
+  }
+  return bytes;
+}
+
+size_t GetHistoryBytes() {
+  size_t bytes = memory_stats::VectorBytes(history.time);
+  for (const auto& [name, values] : history.signals) {
+    bytes += memory_stats::VectorBytes(values);
+  }
+  return bytes;
+}
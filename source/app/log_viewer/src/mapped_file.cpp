@@ -0,0 +1,82 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace mapped_file {
+#ifdef _WIN32
+    bool Open(MappedFile& file, const std::string& path) {
+        file = {};
+        HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                                    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (handle == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(handle, &size) || size.QuadPart == 0) {
+            CloseHandle(handle);
+            return false;
+        }
+        HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr) {
+            CloseHandle(handle);
+            return false;
+        }
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (view == nullptr) {
+            CloseHandle(mapping);
+            CloseHandle(handle);
+            return false;
+        }
+        file.data           = static_cast<const uint8_t*>(view);
+        file.size           = static_cast<size_t>(size.QuadPart);
+        file.file_handle    = handle;
+        file.mapping_handle = mapping;
+        return true;
+    }
+
+    void Close(MappedFile& file) {
+        if (file.data != nullptr) {
+            UnmapViewOfFile(file.data);
+            CloseHandle(static_cast<HANDLE>(file.mapping_handle));
+            CloseHandle(static_cast<HANDLE>(file.file_handle));
+        }
+        file = {};
+    }
+#else
+    bool Open(MappedFile& file, const std::string& path) {
+        file = {};
+        int const fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            close(fd);
+            return false;
+        }
+        void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        // The mapping keeps the file referenced
+        close(fd);
+        if (view == MAP_FAILED) {
+            return false;
+        }
+        file.data = static_cast<const uint8_t*>(view);
+        file.size = static_cast<size_t>(st.st_size);
+        return true;
+    }
+
+    void Close(MappedFile& file) {
+        if (file.data != nullptr) {
+            munmap(const_cast<uint8_t*>(file.data), file.size);
+        }
+        file = {};
+    }
+#endif
+} // namespace mapped_file
@@ -0,0 +1,230 @@
+#include "resample.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RESAMPLE_SSE2 1
+#endif
+
+namespace resample {
+namespace {
+// Below this many grid points per thread a single thread is faster
+const size_t min_points_per_thread = 1 << 16;
+
+unsigned ThreadCount(unsigned threads, size_t work) {
+    if (threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1U);
+    }
+    size_t const useful = std::max<size_t>(work / min_points_per_thread, 1);
+    return static_cast<unsigned>(std::min<size_t>(threads, useful));
+}
+
+/*
+ * Plans grid points [first, last). Starts with a binary search, then walks time
+ * and grid together since both are sorted.
+ */
+void PlanRange(const double* time, size_t count, const std::vector<double>& grid, ResampleMode mode,
+               bool linear, size_t first, size_t last, ResamplePlan& plan) {
+    size_t src = static_cast<size_t>(std::upper_bound(time, time + count, grid[first]) - time);
+    src = src > 0 ? src - 1 : 0;
+
+    for (size_t i = first; i < last; i++) {
+        double const g = grid[i];
+        while (src + 1 < count && time[src + 1] <= g) {
+            src++;
+        }
+        bool const before = g < time[0];
+        bool const after = src + 1 >= count;
+
+        if (linear) {
+            if (before) {
+                plan.index[i] = 0;
+                plan.weight[i] = 0.0;
+            } else if (after) {
+                // Weight 1 on the last sample keeps index + 1 inside the source
+                plan.index[i] = count - 2;
+                plan.weight[i] = 1.0;
+            } else {
+                plan.index[i] = src;
+                plan.weight[i] = (g - time[src]) / (time[src + 1] - time[src]);
+            }
+        } else if (mode == RESAMPLE_NEAREST && !before && !after && time[src + 1] - g < g - time[src]) {
+            plan.index[i] = src + 1;
+        } else {
+            plan.index[i] = src;
+        }
+    }
+}
+
+void Gather(const size_t* index, const double* values, double* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = values[index[i]];
+    }
+}
+
+void Lerp(const size_t* index, const double* weight, const double* values, double* out, size_t count) {
+    size_t i = 0;
+#ifdef RESAMPLE_SSE2
+    __m128d const one = _mm_set1_pd(1.0);
+    for (; i + 2 <= count; i += 2) {
+        __m128d const a = _mm_set_pd(values[index[i + 1]], values[index[i]]);
+        __m128d const b = _mm_set_pd(values[index[i + 1] + 1], values[index[i] + 1]);
+        __m128d const w = _mm_loadu_pd(weight + i);
+        // a * (1 - w) + b * w is exact at both ends, unlike a + (b - a) * w
+        __m128d const result = _mm_add_pd(_mm_mul_pd(a, _mm_sub_pd(one, w)), _mm_mul_pd(b, w));
+        _mm_storeu_pd(out + i, result);
+    }
+#endif
+    for (; i < count; i++) {
+        double const w = weight[i];
+        out[i] = values[index[i]] * (1.0 - w) + values[index[i] + 1] * w;
+    }
+}
+
+bool HasNaN(const std::vector<double>& values) {
+    return std::any_of(values.begin(), values.end(), [](double v) { return std::isnan(v); });
+}
+}  // namespace
+
+double GridPoints(double t0, double t1, double rate_hz) {
+    if (!(rate_hz > 0.0) || !(t1 >= t0)) {
+        return 0.0;
+    }
+    return std::floor((t1 - t0) * rate_hz) + 1.0;
+}
+
+bool FixedGrid(double t0, double t1, double rate_hz, std::vector<double>& grid) {
+    grid.clear();
+    double const points = GridPoints(t0, t1, rate_hz);
+    // Also false for an infinite count
+    if (!(points <= static_cast<double>(kMaxGridPoints))) {
+        return false;
+    }
+    auto const count = static_cast<size_t>(points);
+    grid.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        // Multiply instead of accumulating, so long grids do not drift
+        grid[i] = t0 + static_cast<double>(i) / rate_hz;
+    }
+    return true;
+}
+
+std::vector<double> CommonGrid(const std::vector<const std::vector<double>*>& times) {
+    std::vector<double> grid;
+    std::vector<double> merged;
+    for (const std::vector<double>* time : times) {
+        merged.clear();
+        merged.reserve(grid.size() + time->size());
+        std::merge(grid.begin(), grid.end(), time->begin(), time->end(), std::back_inserter(merged));
+        merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+        grid.swap(merged);
+    }
+    return grid;
+}
+
+ResamplePlan MakePlan(const double* time, size_t count, const std::vector<double>& grid, ResampleMode mode,
+                      unsigned threads) {
+    ResamplePlan plan;
+    if (count == 0 || grid.empty()) {
+        return plan;
+    }
+    bool const linear = mode == RESAMPLE_LINEAR && count >= 2;
+    plan.index.resize(grid.size());
+    if (linear) {
+        plan.weight.resize(grid.size());
+    }
+
+    unsigned const workers = ThreadCount(threads, grid.size());
+    size_t const part = (grid.size() + workers - 1) / workers;
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < workers; t++) {
+        size_t const first = std::min(grid.size(), t * part);
+        size_t const last = std::min(grid.size(), first + part);
+        if (first < last) {
+            pool.emplace_back(PlanRange, time, count, std::cref(grid), mode, linear, first, last, std::ref(plan));
+        }
+    }
+    PlanRange(time, count, grid, mode, linear, 0, std::min(part, grid.size()), plan);
+    for (auto& worker : pool) {
+        worker.join();
+    }
+    return plan;
+}
+
+void Apply(const ResamplePlan& plan, const double* values, double* out) {
+    if (plan.weight.empty()) {
+        Gather(plan.index.data(), values, out, plan.index.size());
+    } else {
+        Lerp(plan.index.data(), plan.weight.data(), values, out, plan.index.size());
+    }
+}
+
+Data ResampleData(const Data& data, const std::vector<std::string>& signals, const std::vector<double>& grid,
+                  ResampleMode mode, unsigned threads) {
+    Data out;
+    out.time = grid;
+    std::vector<const std::vector<double>*> sources;
+    std::vector<std::vector<double>*> targets;
+    for (const auto& name : signals) {
+        auto it = data.signals.find(name);
+        if (it == data.signals.end()) {
+            continue;
+        }
+        sources.push_back(&it->second);
+        // Allocated here, workers never touch the map
+        std::vector<double>& target = out.signals[name];
+        target.assign(grid.size(), NAN);
+        targets.push_back(&target);
+    }
+
+    ResamplePlan const shared = MakePlan(data.time.data(), data.time.size(), grid, mode, threads);
+
+    std::atomic<size_t> next = 0;
+    auto worker = [&]() {
+        std::vector<double> valid_time;
+        std::vector<double> valid_values;
+        for (size_t s = next++; s < sources.size(); s = next++) {
+            const std::vector<double>& values = *sources[s];
+            if (values.size() < data.time.size()) {
+                continue;
+            }
+            if (!HasNaN(values)) {
+                if (!shared.index.empty()) {
+                    Apply(shared, values.data(), targets[s]->data());
+                }
+                continue;
+            }
+            valid_time.clear();
+            valid_values.clear();
+            for (size_t i = 0; i < data.time.size(); i++) {
+                if (!std::isnan(values[i])) {
+                    valid_time.push_back(data.time[i]);
+                    valid_values.push_back(values[i]);
+                }
+            }
+            ResamplePlan const plan = MakePlan(valid_time.data(), valid_time.size(), grid, mode, 1);
+            if (!plan.index.empty()) {
+                Apply(plan, valid_values.data(), targets[s]->data());
+            }
+        }
+    };
+
+    unsigned const workers = std::min<unsigned>(ThreadCount(threads, grid.size() * sources.size()),
+                                                static_cast<unsigned>(std::max<size_t>(sources.size(), 1)));
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < workers; t++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    return out;
+}
+}  // namespace resample
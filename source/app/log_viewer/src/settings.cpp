@@ -21,6 +21,7 @@ Settings settings = {
     .header_line_idx = 0,           // header_line_idx
     .time_name = "time",            // time_name
     .separator = ",",               // separator
+    .comma_decimal = false,         // comma_decimal
     .auto_size_y = false,           // auto_size_y
     .cursor_value_table_size = 400  // obvi
 };
@@ -32,6 +33,7 @@ void SaveSettings() {
 
     settings_out["time_name"] = std::string(settings.time_name);
     settings_out["separator"] = std::string(settings.separator);
+    settings_out["comma_decimal"] = settings.comma_decimal;
     settings_out["file_path"] = std::string(settings.file_path);
 
     settings_out["header_line_idx"] = settings.header_line_idx;
@@ -65,6 +67,7 @@ void init() {
         std::strncpy(settings.time_name, temp.c_str(), kSettingsCharBufLen);
         temp = settings_json["separator"].get<std::string>();
         std::strncpy(settings.separator, temp.c_str(), kSettingsCharBufLen);
+        settings.comma_decimal = settings_json.value("comma_decimal", false);
 
         settings.file_path = settings_json["file_path"].get<std::string>();
     }
@@ -75,6 +78,18 @@ void SetLogFilePath(std::string path) {
     settings::SaveSettings();
 }
 
+CsvFormat GetCsvFormat() {
+    CsvFormat format = csv_writer::kDefaultFormat;
+    if (settings.separator[0] != '\0') {
+        format.separator = settings.separator[0];
+    }
+    // A comma separator leaves no room for a decimal comma
+    if (settings.comma_decimal && format.separator != ',') {
+        format.decimal = ',';
+    }
+    return format;
+}
+
 void ShowSettingsButton() {
     static bool show_settings_window = false;
     static bool save_settings = false;
@@ -106,6 +121,8 @@ void ShowSettingsButton() {
             ImGui::SetNextItemWidth(width);
             ImGui::InputText("##hidden_label2", settings.separator,
                              IM_ARRAYSIZE(settings.separator));
+
+            ImGui::Checkbox("Decimal comma in written CSV", &(settings.comma_decimal));
         }
 
         if (ImGui::CollapsingHeader("Plot Settings")) {
@@ -18,6 +18,7 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 #include "implot.h"
+#include "log_export.h"
 #include "log_reader.h"
 #include "main_window.h"
 #include "math.h"
@@ -27,6 +28,7 @@
 #include "serial_front.h"
 #include "serial_back.h"
 #include "performance_analysis.h"
+#include "tracing.h"
 
 static void GlfwErrorCallback(int error, const char* description) {
     fprintf(stderr, "GLFW Error %d: %s\n", error, description);
@@ -41,8 +43,28 @@ using namespace std::chrono;
 
 milliseconds delay = std::chrono::milliseconds(20);
 
+static std::string trace_out_path;
+static std::string memory_out_path;
+
+static bool ParseArgs(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        std::string const arg = argv[i];
+        bool const has_value = i + 1 < argc;
+        if (arg == "--trace-out" && has_value) {
+            trace_out_path = argv[++i];
+        } else if (arg == "--memory-out" && has_value) {
+            memory_out_path = argv[++i];
+        } else {
+            fprintf(stderr, "Usage: %s [--trace-out trace.json] [--memory-out memory.json]\n", argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
 // Main code
-int main(int, char**) {
+int main(int argc, char** argv) {
+    if (!ParseArgs(argc, argv)) return 1;
     glfwSetErrorCallback(GlfwErrorCallback);
     if (!glfwInit()) return 1;
 
@@ -113,6 +135,7 @@ int main(int, char**) {
     ImVec4 clear_color = ImVec4(0.10f, 0.10f, 0.10f, 1.00f);
 
     RunInitFunctions();
+    TRACE_THREAD_NAME("gui");
 
     steady_clock::time_point lastWakeTime = steady_clock::now();
     // Main loop
@@ -147,7 +170,7 @@ int main(int, char**) {
         std::this_thread::sleep_until(nextWakeTime);
         lastWakeTime = nextWakeTime;
         
-        performance_analysis::Start(performance_analysis::AnalysisIndex::TASK_MAIN_GUI);
+        TRACE_ZONE("MainGui");
 
         // Start the Dear ImGui frame
         ImGui_ImplOpenGL3_NewFrame();
@@ -189,11 +212,21 @@ int main(int, char**) {
 
         glfwSwapBuffers(window);
 
-        performance_analysis::End(performance_analysis::AnalysisIndex::TASK_MAIN_GUI);
+        performance_analysis::Collect();
+    }
+
+    // Memory held at exit and the allocation counts of the session, before anything is freed
+    if (!memory_out_path.empty() && !performance_analysis::WriteMemoryReport(memory_out_path)) {
+        fprintf(stderr, "Could not write memory report %s\n", memory_out_path.c_str());
     }
 
     // Cleanup
     serial_back::DeInit();
+    log_export::DeInit();
+    // Zone timings of the whole session, for chrome://tracing or ui.perfetto.dev
+    if (!trace_out_path.empty() && !tracing::WriteChromeTrace(trace_out_path)) {
+        fprintf(stderr, "Could not write trace %s\n", trace_out_path.c_str());
+    }
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImPlot::DestroyContext();
@@ -0,0 +1,32 @@
+#ifndef CONSOLE_LOG_H_
+#define CONSOLE_LOG_H_
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Fixed size ring of console lines, written from any thread without locks.
+ * Lines are numbered from 0, only the last kConsoleLines stay readable.
+ * Received bytes are stored raw and only formatted as hex when read, so a
+ * line that is never shown costs a copy.
+ */
+const size_t kConsoleLines    = 2048;
+const size_t kConsoleLineSize = 512;    // Longest line read back, terminator included
+
+namespace console_log {
+    void AddText(const char* text);         // Newlines are dropped, one message is one line
+    void AddRx(const uint8_t* data, size_t size);
+
+    // Number of lines written so far, one past the newest line
+    uint64_t End();
+
+    /*
+     * Formats a line into out. False when the line has been overwritten or is
+     * still being written.
+     */
+    bool ReadLine(uint64_t line, char* out, size_t out_size);
+
+    size_t GetMemoryBytes();                // The whole ring, it is allocated up front
+} // namespace console_log
+
+#endif // CONSOLE_LOG_H_
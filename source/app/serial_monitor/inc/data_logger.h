@@ -1,6 +1,8 @@
 #ifndef DATA_LOGGER_H_
 #define DATA_LOGGER_H_
 
+#include <cstdint>
+#include <mutex>
 #include "serial_back.h"
 #include "log_reader.h"
 
@@ -8,7 +10,13 @@ namespace data_logger {
 void init(const std::unordered_map<std::string, VarStruct>& variables);
 void LogFrame(const FrameStruct& frame);
 void SaveLog();
+void DeInit();
 Data* GetLogData();
+// Held while reading log_data from another thread, LogFrame and spilling take it too
+std::unique_lock<std::mutex> LockLogData();
+std::string GetLogFilePath();
+uint64_t GetSpilledRows();
+bool ReadHistory(double t0, double t1, size_t max_rows, Data& out);
 
 } // namespace data_logger
 
@@ -0,0 +1,40 @@
+#ifndef ELF_READER_H_
+#define ELF_READER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "serial_back.h"
+
+typedef struct {
+    std::string  name;          // Symbol name, with .member and [index] for expanded leaves
+    uint64_t     address;
+    uint64_t     size;
+    uint8_t      bit_offset;    // Bitfields only, shift of the field in the value read
+    uint8_t      bit_size;      // 0 unless the leaf is a bitfield
+    std::string  file;          // Declaring source file, empty when no debug info covers the symbol
+    VariableType type;          // TYPE_UNKNOWN when the debug info has no loggable type
+} ElfSymbol;
+
+/*
+ * Native reader of ELF32/ELF64 files of either byte order.
+ * Data symbols come from .symtab (what nm lists as B/b/D/d), their declaring
+ * file and type from the DWARF of the same file. Everything is resolved in one
+ * pass over the mapped file, no toolchain is needed.
+ *
+ * Structs, unions and arrays are expanded into one leaf per scalar member or
+ * element, so each can be logged on its own. Bitfield offsets assume a little
+ * endian target.
+ */
+namespace elf_reader {
+    bool ReadDataSymbols(const std::string& path, std::vector<ElfSymbol>& symbols);
+
+    /*
+     * Identifies a build: "gnu-" and the GNU build-id when the linker wrote
+     * one, else "fnv-" and a hash of the file content. Empty if unreadable.
+     */
+    std::string GetBuildKey(const std::string& path);
+} // namespace elf_reader
+
+#endif // ELF_READER_H_
@@ -0,0 +1,46 @@
+#ifndef FILE_WATCH_H_
+#define FILE_WATCH_H_
+
+#include <filesystem>
+#include <string>
+
+/*
+ * Waits for a single file to be rewritten, e.g. an ELF file by the linker.
+ * The directory of the file is watched (inotify on Linux, change
+ * notifications on Windows), so a file replaced by delete and create or by
+ * rename is followed too. Where no notification is available the file time
+ * is polled. A waiting thread sleeps until the file changes or Wake is called.
+ */
+typedef struct {
+    std::string                     path;
+    std::string                     name;               // File name within the watched directory
+    std::filesystem::file_time_type last_write_time;    // Of the last change reported
+    std::filesystem::file_time_type polled_write_time;  // Polling only, time seen on the previous poll
+    bool                            polling;
+    int                             notify_fd;          // Linux only
+    int                             wake_fds[2];        // Not used on Windows
+    void*                           change_handle;      // Only used on Windows
+    void*                           wake_handle;        // Only used on Windows
+} FileWatch;
+
+namespace file_watch {
+    bool Open(FileWatch& watch);
+    void Close(FileWatch& watch);
+
+    /*
+     * Watches path from now on, an empty path watches nothing. Only call from
+     * the thread that waits.
+     */
+    void SetPath(FileWatch& watch, const std::string& path);
+
+    /*
+     * Blocks until the file is completely written with a new time (true) or
+     * until Wake is called (false).
+     */
+    bool Wait(FileWatch& watch);
+
+    // Makes Wait return, safe to call from any thread
+    void Wake(FileWatch& watch);
+} // namespace file_watch
+
+#endif // FILE_WATCH_H_
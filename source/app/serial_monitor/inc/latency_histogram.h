@@ -0,0 +1,35 @@
+#ifndef LATENCY_HISTOGRAM_H_
+#define LATENCY_HISTOGRAM_H_
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Log bucketed histogram of ns values, in the style of HDR histograms: each
+ * power of two is split into kHistogramSubBuckets buckets, so a percentile
+ * is off by at most 1/16 of its value. Values below 16 ns are exact, values
+ * above 2^40 ns (~18 min) land in the last bucket. Adding is O(1).
+ */
+const size_t kHistogramSubBits    = 4;
+const size_t kHistogramSubBuckets = 1 << kHistogramSubBits;
+const size_t kHistogramMaxBits    = 40;
+const size_t kHistogramBuckets    = kHistogramSubBuckets * (kHistogramMaxBits - kHistogramSubBits + 2);
+
+typedef struct {
+    uint64_t counts[kHistogramBuckets];
+    uint64_t total;
+    uint64_t max;
+} LatencyHistogram;
+
+namespace latency_histogram {
+    void Add(LatencyHistogram& histogram, uint64_t value);
+    void Reset(LatencyHistogram& histogram);
+
+    /*
+     * Values at the given fractions (0.5 for p50), fractions ascending. The
+     * upper end of the bucket is reported, never above the largest value.
+     */
+    void Percentiles(const LatencyHistogram& histogram, const double* fractions, uint64_t* values, size_t count);
+} // namespace latency_histogram
+
+#endif // LATENCY_HISTOGRAM_H_
@@ -0,0 +1,52 @@
+#ifndef LINK_HEALTH_H_
+#define LINK_HEALTH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+typedef struct {
+    int      id;
+    uint64_t frames;
+    double   expected_hz;   // From the smallest timestamp delta, the configured rate
+    double   observed_hz;   // Frames over the time they span
+    uint64_t gaps;
+    uint64_t missed_frames;
+} FrameHealth;
+
+typedef struct {
+    double   seconds;
+    uint64_t rx_bytes;
+    uint64_t reads;
+    uint64_t frames;
+    uint64_t crc_errors;
+    uint64_t length_errors;
+    uint64_t unknown_ids;
+    uint64_t skipped_bytes;
+    uint64_t buffer_overflows;
+    uint64_t timestamp_gaps;
+    uint64_t missed_frames;
+    std::vector<FrameHealth> frame_ids;
+} LinkHealthStats;
+
+/*
+ * Counters of the serial link for the current log session.
+ * Updated only by the thread feeding the decoder, so updates are plain
+ * relaxed stores. Any thread may read a snapshot.
+ */
+namespace link_health {
+    void Reset();
+    void ReceivedBytes(size_t bytes);
+    void BufferOverflow();
+    void FrameDecoded(int id, uint64_t timestamp_us);
+    void CrcError();
+    void LengthError();
+    void UnknownId();
+    void SkippedBytes(size_t bytes);
+
+    LinkHealthStats GetStats();
+    std::string FormatHeader(const char* prefix);
+} // namespace link_health
+
+#endif // LINK_HEALTH_H_
@@ -0,0 +1,19 @@
+#ifndef LOG_DECODER_H_
+#define LOG_DECODER_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include "serial_back.h"
+
+namespace log_decoder {
+    void Configure(std::unordered_map<std::string, FrameStruct>& frames);
+    void Reset();
+
+    // Called with bytes that are not part of a valid frame, such as command replies.
+    typedef std::function<void(const uint8_t* data, size_t len)> SkippedCallback;
+    void Feed(const uint8_t* data, size_t len, const SkippedCallback& on_skipped = nullptr);
+} // namespace log_decoder
+
+#endif // LOG_DECODER_H_
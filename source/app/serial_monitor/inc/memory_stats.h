@@ -0,0 +1,40 @@
+#ifndef MEMORY_STATS_H_
+#define MEMORY_STATS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "serial_back.h"
+
+typedef struct {
+    uint64_t allocations;
+    uint64_t frees;
+    uint64_t allocated_bytes;   // Requested from operator new, frees do not subtract
+} AllocationCounts;
+
+/*
+ * Counting replacements of the global operator new and delete, forwarding to
+ * malloc and free. Counts are kept for all threads together and for each
+ * thread, so the GUI thread can tell what a single frame allocates.
+ */
+namespace memory_stats {
+    AllocationCounts GetAllocations();          // All threads
+    AllocationCounts GetThreadAllocations();    // Calling thread
+    int64_t GetLiveBytes();                     // Held through operator new, as malloc rounds it
+
+    // Heap bytes of a symbol map, estimated from the node and bucket layout of the containers
+    size_t SymbolMapBytes(const FileSymbolMap& map);
+
+    inline size_t StringBytes(const std::string& str) {
+        return str.capacity() > std::string().capacity() ? str.capacity() + 1 : 0;
+    }
+
+    template <typename T>
+    size_t VectorBytes(const std::vector<T>& vec) {
+        return vec.capacity() * sizeof(T);
+    }
+} // namespace memory_stats
+
+#endif // MEMORY_STATS_H_
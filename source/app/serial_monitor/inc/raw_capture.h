@@ -0,0 +1,32 @@
+#ifndef RAW_CAPTURE_H_
+#define RAW_CAPTURE_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+/*
+ * Raw capture file (.jvraw), little endian:
+ *
+ * | magic[8] | version u32 | config_len u32 | config (JSON text) |
+ * | host_time_us u64 | len u32 | bytes[len] | ...one record per serial read...
+ *
+ * The config describes the frames sent with the setup_frame command, so the
+ * stream can be decoded again without the ELF file.
+ */
+namespace raw_capture {
+    const char     kMagic[8] = {'J', 'V', 'R', 'A', 'W', '\r', '\n', '\0'};
+    const uint32_t kVersion  = 1;
+
+    bool Start(const std::string& path, const std::string& config);
+    void Write(const uint8_t* data, size_t len);
+    void Stop();
+    bool IsRecording();
+
+    // Calls on_record for every record in the file, stops early if it returns false.
+    // Returns false if the file is not a capture or a record is corrupt.
+    typedef std::function<bool(uint64_t host_time_us, const uint8_t* data, size_t len)> RecordCallback;
+    bool ReadCapture(const std::string& path, std::string& config, const RecordCallback& on_record);
+} // namespace raw_capture
+
+#endif // RAW_CAPTURE_H_
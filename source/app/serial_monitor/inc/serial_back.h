@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include <memory>
 #include <unordered_map>
 //#include "elf_parser.h"
 
@@ -26,13 +27,17 @@ typedef struct {
         size_t size;
         int frame;
         VariableType type;
+        uint8_t bit_offset;     // Bitfields are logged as the bytes holding them,
+        uint8_t bit_size;       // then shifted and masked. bit_size 0 for plain variables
 } VarStruct;
 
 typedef struct {
     std::string name;
     size_t size;
-    uint32_t latest_rx;
+    uint64_t latest_rx;     // Raw bytes of the variable, msb first, doubles need all 8
     VariableType type;
+    uint8_t bit_offset;
+    uint8_t bit_size;
 } FrameVarStruct;
 typedef struct {
     int id;
@@ -40,16 +45,24 @@ typedef struct {
     std::vector<FrameVarStruct> variables;
 } FrameStruct;
 typedef struct {
-    std::string nm;
-    std::string addr2line;
     std::string elf_file_path;
+    bool record_raw;
+    bool binary_log;
+    int ram_window_s;   // Older log rows spill to disk, 0 keeps everything in RAM
 } SerialBack_Settings;
+typedef struct {
+    uint64_t bytes;
+    uint64_t frames;
+    double seconds;
+} ReplayStats;
 
 // {file : {variable_name : .address, .size, .frame, .type}}
 typedef std::unordered_map<std::string, std::unordered_map<std::string, VarStruct>> FileSymbolMap;
 namespace serial_back {
     void SetElfFilePath(const std::string& path);
     bool Send(const std::vector<uint8_t>& data);
+    bool SendCommand(const std::vector<uint8_t>& command);
+    float GetCommandLatency();
     void GetPorts(std::vector<std::string>& ports);
     bool SetPortName(const std::string& port);
     void GetPortName(std::string& port);
@@ -63,9 +76,14 @@ namespace serial_back {
     void StartLog(std::unordered_map<std::string, VarStruct> log_variables);
     void StopLog();
     bool IsLogRunning();
+    bool StartReplay(const std::string& path, bool real_time);
+    bool IsReplayRunning();
+    ReplayStats GetReplayStats();
     bool IsParsingElfFile();
-    FileSymbolMap GetParsedMap();
+    std::shared_ptr<const FileSymbolMap> GetParsedMap();    // Immutable snapshot
+    uint64_t GetParsedMapVersion();                         // Changes whenever a new map is published
     SerialBack_Settings* GetSettings();
+    void MarkSettingsDirty();   // Call after changing settings, they are saved by the slow task
 
 } // namespace serial_back
 
@@ -1,8 +1,6 @@
 #ifndef SERIAL_FRONT_H_
 #define SERIAL_FRONT_H_
 
-#include <mutex>
-
 #define COMMAND_CHAR "$"
 #define ERROR_CHAR "!"
 #define INFO_CHAR "%"
@@ -10,7 +8,6 @@
 #define RX_CHAR ">"
 
 namespace serial_front {
-    extern std::mutex mtx;
     void SerialWindow();
     void AddLog(const char* fmt, ...);
 } // namespace serial_front
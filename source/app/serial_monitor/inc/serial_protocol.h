@@ -0,0 +1,44 @@
+#ifndef SERIAL_PROTOCOL_H_
+#define SERIAL_PROTOCOL_H_
+
+#include <cstddef>
+#include <cstdint>
+
+typedef enum {
+    CMD_INVALID         = 0x00,
+    CMD_TOGGLE_LED      = 0x01,
+    CMD_SETUP_FRAME     = 0x02,
+    CMD_SET_FRAME_SIZE  = 0x03,
+    CMD_START_LOG       = 0x04,
+    CMD_STOP_LOG        = 0x05,
+    CMD_NR_OF_CMDS      = 0x06,
+} CommandIndex;
+
+// Single byte replies from the device, see TX_ACK/TX_NACK in serial_log.c
+typedef enum {
+    REPLY_NONE          = 0x00,
+    REPLY_ACK           = 0x06,
+    REPLY_NACK          = 0x15,
+} CommandReply;
+
+/*
+ * Wire format of one log frame, protocol version 1. Must match embedded_logger/serial_log.c.
+ *
+ * | sync0 | sync1 | version | frame id | length | time[4] | variables ... | crc16[2] |
+ *
+ * length counts time and variables. Time and variables are sent MSB first.
+ * The CRC (CRC-16/CCITT-FALSE, MSB first) covers version up to and including the last variable.
+ */
+namespace serial_protocol {
+    const uint8_t kSync0        = 0xA5;
+    const uint8_t kSync1        = 0x5A;
+    const uint8_t kVersion      = 0x01;
+    const size_t  kHeaderSize   = 5;
+    const size_t  kTimeSize     = 4;
+    const size_t  kCrcSize      = 2;
+    const size_t  kMaxLength    = 0xFF;
+
+    uint16_t Crc16(const uint8_t* data, size_t len);
+} // namespace serial_protocol
+
+#endif // SERIAL_PROTOCOL_H_
@@ -0,0 +1,23 @@
+#ifndef SYMBOL_CACHE_H_
+#define SYMBOL_CACHE_H_
+
+#include <string>
+
+#include "serial_back.h"
+
+/*
+ * Parsed symbol maps stored in a compact binary form (.jvsym), one file per
+ * build key (see elf_reader::GetBuildKey) under resources/symbol_cache.
+ * Several firmware variants stay cached side by side, the least recently used
+ * are pruned. A .jvsym can also be used on its own in place of an ELF file.
+ */
+namespace symbol_cache {
+    bool Exists(const std::string& key);
+    bool Load(const std::string& key, FileSymbolMap& map);
+    bool Save(const std::string& key, const FileSymbolMap& map);
+
+    bool LoadFile(const std::string& path, FileSymbolMap& map);
+    bool SaveFile(const std::string& path, const FileSymbolMap& map);
+} // namespace symbol_cache
+
+#endif // SYMBOL_CACHE_H_
@@ -0,0 +1,42 @@
+#ifndef SYMBOL_SEARCH_H_
+#define SYMBOL_SEARCH_H_
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "serial_back.h"
+
+typedef struct {
+    const std::string* file;
+    const std::string* name;
+    const VarStruct*   var;
+} SymbolEntry;
+
+/*
+ * Search index over the symbols of a FileSymbolMap. Entries point into the
+ * map, so the index must be rebuilt whenever the map is replaced.
+ */
+typedef struct {
+    std::vector<SymbolEntry>  entries;        // Sorted by file, then name
+    std::vector<std::string>  lower_names;    // Lower case, per entry
+    std::vector<uint32_t>     entry_file;     // Index into lower_files, per entry
+    std::vector<std::string>  lower_files;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> trigrams;   // Trigram to sorted entry indices
+
+    std::string               query;          // Lower case query of results
+    std::vector<uint32_t>     results;        // Entry indices matching query, in entry order
+} SymbolIndex;
+
+/*
+ * Case insensitive substring search over file and symbol names. Queries of
+ * three or more characters start from trigram posting lists, a query that
+ * extends the previous one only re-checks the previous results.
+ */
+namespace symbol_search {
+    void Build(SymbolIndex& index, const FileSymbolMap& map);
+    const std::vector<uint32_t>& Search(SymbolIndex& index, const char* query);
+} // namespace symbol_search
+
+#endif // SYMBOL_SEARCH_H_
@@ -0,0 +1,94 @@
+#ifndef TRACING_H_
+#define TRACING_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * Scoped timing zones, declared anywhere by name:
+ *
+ *     void Feed(...) {
+ *         TRACE_ZONE("DecodeLog");
+ *         ...
+ *     }
+ *
+ * Every thread records into its own ring of the last kTraceRecords records,
+ * without locks. A new thread takes over the ring of one that has exited.
+ * Readers copy records out of the rings while they are written. The macros
+ * compile to nothing unless TRACING_ENABLED is defined (scons --no-tracing
+ * leaves it out).
+ */
+const size_t kTraceRecords = 1 << 16;   // Per thread
+
+typedef enum : uint8_t {
+    TRACE_ZONE_RECORD,      // value is the duration in ns
+    TRACE_COUNTER_RECORD,   // value is the counter sample
+} TraceRecordKind;
+
+typedef struct {
+    uint64_t        start_ns;   // Since the first use of tracing
+    uint32_t        value;
+    uint16_t        zone;       // See tracing::GetZoneName
+    uint8_t         depth;      // Zones open on the thread when this one started
+    TraceRecordKind kind;
+} TraceRecord;
+
+namespace tracing {
+    uint16_t RegisterZone(const char* name);    // Same id for the same name
+    std::string GetZoneName(uint16_t zone);
+    size_t GetZoneCount();
+
+    void SetThreadName(const char* name);
+    size_t GetThreadCount();
+    std::string GetThreadName(size_t thread);
+    size_t GetMemoryBytes();                    // Rings of all threads, exited ones are reused
+
+    uint64_t BeginZone();                       // Returns the start time
+    void EndZone(uint16_t zone, uint64_t start_ns);
+    void Counter(uint16_t zone, uint32_t value);
+
+    /*
+     * Appends the records of a thread written since cursor and moves cursor
+     * past them. Records already overwritten are skipped. Reading does not
+     * consume, every reader keeps its own cursors.
+     */
+    void Read(size_t thread, uint64_t& cursor, std::vector<TraceRecord>& out);
+
+    /*
+     * Writes every record still in the rings, with thread names, as Chrome
+     * trace event JSON (chrome://tracing, ui.perfetto.dev).
+     */
+    bool WriteChromeTrace(const std::string& path);
+} // namespace tracing
+
+struct TraceZone {
+    explicit TraceZone(uint16_t zone_id) : zone(zone_id), start_ns(tracing::BeginZone()) {}
+    ~TraceZone() { tracing::EndZone(zone, start_ns); }
+    TraceZone(const TraceZone&) = delete;
+    TraceZone& operator=(const TraceZone&) = delete;
+
+    uint16_t zone;
+    uint64_t start_ns;
+};
+
+#ifdef TRACING_ENABLED
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b)  TRACE_CONCAT_(a, b)
+#define TRACE_ZONE(name)                                                                        \
+    static const uint16_t TRACE_CONCAT(trace_zone_id_, __LINE__) = tracing::RegisterZone(name); \
+    TraceZone const TRACE_CONCAT(trace_zone_, __LINE__)(TRACE_CONCAT(trace_zone_id_, __LINE__))
+#define TRACE_COUNTER(name, value)                                                              \
+    do {                                                                                        \
+        static const uint16_t trace_counter_id = tracing::RegisterZone(name);                   \
+        tracing::Counter(trace_counter_id, static_cast<uint32_t>(value));                       \
+    } while (0)
+#define TRACE_THREAD_NAME(name) tracing::SetThreadName(name)
+#else
+#define TRACE_ZONE(name)            static_cast<void>(0)
+#define TRACE_COUNTER(name, value)  static_cast<void>(0)
+#define TRACE_THREAD_NAME(name)     static_cast<void>(0)
+#endif
+
+#endif // TRACING_H_
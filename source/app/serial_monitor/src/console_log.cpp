@@ -0,0 +1,114 @@
+#include "console_log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include "serial_front.h"
+
+namespace {
+    // Bytes of one received line, "> " and three characters per byte when shown
+    const size_t kRxBytesPerLine = 32;
+
+    typedef enum {
+        LINE_TEXT,
+        LINE_RX,
+    } LineKind;
+
+    /*
+     * Each slot is a small seqlock: the writer marks it odd, copies the line
+     * and marks it done with its line number. A reader copies the line out and
+     * keeps it only if the mark is the same before and after.
+     */
+    typedef struct {
+        std::atomic<uint64_t> sequence;     // 2 * line + 1 while written, 2 * line + 2 when done
+        LineKind              kind;
+        uint16_t              size;
+        char                  data[kConsoleLineSize];
+    } Slot;
+
+    Slot                  slots[kConsoleLines];
+    std::atomic<uint64_t> next_line = 0;
+
+    void Write(LineKind kind, const char* data, size_t size) {
+        uint64_t const line = next_line.fetch_add(1, std::memory_order_relaxed);
+        Slot& slot = slots[line % kConsoleLines];
+        slot.sequence.store(2 * line + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        size = std::min(size, kConsoleLineSize - 1);
+        slot.kind = kind;
+        slot.size = static_cast<uint16_t>(size);
+        std::memcpy(slot.data, data, size);
+
+        slot.sequence.store(2 * line + 2, std::memory_order_release);
+    }
+} // namespace anonymous
+
+namespace console_log {
+    void AddText(const char* text) {
+        char line[kConsoleLineSize];
+        size_t size = 0;
+        for (const char* c = text; *c != '\0' && size < sizeof(line) - 1; c++) {
+            line[size++] = *c == '\n' ? ' ' : *c;
+        }
+        while (size > 0 && line[size - 1] == ' ') {
+            size--;
+        }
+        Write(LINE_TEXT, line, size);
+    }
+
+    void AddRx(const uint8_t* data, size_t size) {
+        for (size_t offset = 0; offset < size; offset += kRxBytesPerLine) {
+            Write(LINE_RX, reinterpret_cast<const char*>(data + offset), std::min(kRxBytesPerLine, size - offset));
+        }
+    }
+
+    uint64_t End() {
+        return next_line.load(std::memory_order_acquire);
+    }
+
+    bool ReadLine(uint64_t line, char* out, size_t out_size) {
+        const Slot& slot = slots[line % kConsoleLines];
+        uint64_t const done = 2 * line + 2;
+        if (out_size == 0 || slot.sequence.load(std::memory_order_acquire) != done) {
+            return false;
+        }
+        LineKind const kind = slot.kind;
+        size_t const size = std::min<size_t>(slot.size, kConsoleLineSize - 1);
+        char data[kConsoleLineSize];
+        std::memcpy(data, slot.data, size);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != done) {
+            return false;   // Overwritten while copied
+        }
+
+        if (kind == LINE_TEXT) {
+            size_t const length = std::min(size, out_size - 1);
+            std::memcpy(out, data, length);
+            out[length] = '\0';
+            return true;
+        }
+
+        static const char kHex[] = "0123456789abcdef";
+        size_t length = 0;
+        auto put = [&](char c) {
+            if (length < out_size - 1) {
+                out[length++] = c;
+            }
+        };
+        put(RX_CHAR[0]);
+        for (size_t i = 0; i < size; i++) {
+            uint8_t const byte = static_cast<uint8_t>(data[i]);
+            put(' ');
+            put(kHex[byte >> 4]);
+            put(kHex[byte & 0x0F]);
+        }
+        out[length] = '\0';
+        return true;
+    }
+
+    size_t GetMemoryBytes() {
+        return sizeof(slots);
+    }
+} // namespace console_log
@@ -1,59 +1,265 @@
 #include "data_logger.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <ctime>
-#include <fstream>
 #include <iomanip>
 #include <mutex>
 #include <regex>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 #include <iostream>
 #include <filesystem>
 
+#include "binary_log.h"
+#include "csv_writer.h"
 #include "log_reader.h"
 #include "serial_back.h"
 #include "serial_front.h"
-#include "performance_analysis.h"
+#include "link_health.h"
+#include "tracing.h"
+#include "settings.h"
 
 namespace {
 Data log_data;
 std::string log_file_path;
 std::mutex log_mutex;
-float base_time = 0.0F;
-
-Data DeepCopyLogVariables() {
-    Data copy;
-    const std::lock_guard<std::mutex> lock(log_mutex);
-    copy.time = log_data.time;
-    copy.signals = log_data.signals;
-    return copy;
+double base_time = 0.0;
+
+// Background writer, appends finished rows to the log file while logging runs
+std::thread writer_thread;
+std::mutex writer_mutex;
+std::condition_variable writer_cv;
+bool writer_exit = false;
+std::FILE* csv_file = nullptr;
+CsvFormat csv_format = csv_writer::kDefaultFormat;
+BinaryLogWriter binary_writer = {};
+bool binary_format = false;
+std::vector<std::string> columns;  // Fixed column order for the whole log
+std::vector<BinaryLogColumn> column_types;
+size_t written_rows = 0;
+const size_t max_batch_rows = 4096;
+const std::chrono::milliseconds write_interval(200);
+
+// Rows older than the RAM window move to the spill store, in whole chunks
+// so that everything spilled can be read back from disk.
+BinaryLogWriter spill_writer = {};
+std::string spill_path;
+std::atomic<uint64_t> spilled_rows = 0;
+// Rows at the front of log_data that are already in the spill store. They are
+// erased only once they outnumber the rows after them, so a spill costs the
+// rows it spills and the memmove of a compaction is spread over a window.
+size_t spilled_in_ram = 0;
+
+/*
+ * Copies at most max_batch_rows unwritten rows under the lock and writes them
+ * to the file outside of it. The last row is still updated by LogFrame until the
+ * next time stamp arrives, so it is only written at stop.
+ * Returns the number of rows written.
+ */
+size_t WriteRows(bool include_last) {
+    std::vector<double> time;
+    std::vector<std::vector<double>> values(columns.size());
+    {
+        const std::lock_guard<std::mutex> lock(log_mutex);
+        size_t end = log_data.time.size();
+        if (!include_last && end > 0) {
+            end--;
+        }
+        end = std::min(end, written_rows + max_batch_rows);
+        if (end <= written_rows) {
+            return 0;
+        }
+        time.assign(log_data.time.begin() + written_rows, log_data.time.begin() + end);
+        for (size_t col = 0; col < columns.size(); col++) {
+            const std::vector<double>& vec = log_data.signals.at(columns[col]);
+            values[col].assign(vec.begin() + written_rows, vec.begin() + end);
+        }
+    }
+
+    if (binary_format) {
+        std::vector<double> row_values(columns.size());
+        for (size_t row = 0; row < time.size(); row++) {
+            for (size_t col = 0; col < columns.size(); col++) {
+                row_values[col] = values[col][row];
+            }
+            binary_log::AppendRow(binary_writer, time[row], row_values.data());
+        }
+        written_rows += time.size();
+        return time.size();
+    }
+
+    std::vector<const double*> column_data;
+    for (const auto& column : values) {
+        column_data.push_back(column.data());
+    }
+    // A live batch is a single block, no point in more threads
+    csv_writer::WriteRows(csv_file, time.data(), column_data, time.size(), csv_format, 1);
+
+    written_rows += time.size();
+    return time.size();
+}
+
+/*
+ * Moves written rows older than the RAM window to the spill store.
+ * Rows are copied and spilled before they are erased, so a reader never
+ * finds a hole between the spill store and log_data.
+ */
+void SpillRows() {
+    int const ram_window_s = serial_back::GetSettings()->ram_window_s;
+    if (ram_window_s <= 0) {
+        return;
+    }
+
+    std::vector<double> time;
+    std::vector<std::vector<double>> values(columns.size());
+    {
+        const std::lock_guard<std::mutex> lock(log_mutex);
+        if (log_data.time.size() <= spilled_in_ram) {
+            return;
+        }
+        double const oldest_kept = log_data.time.back() - static_cast<double>(ram_window_s);
+        size_t count = std::lower_bound(log_data.time.begin() + spilled_in_ram, log_data.time.end(), oldest_kept) -
+                       log_data.time.begin();
+        count = std::min(count, written_rows) - std::min(spilled_in_ram, written_rows);
+        count -= count % binary_log::kRowsPerChunk;
+        if (count == 0) {
+            return;
+        }
+        auto const first = static_cast<std::ptrdiff_t>(spilled_in_ram);
+        auto const last = first + static_cast<std::ptrdiff_t>(count);
+        time.assign(log_data.time.begin() + first, log_data.time.begin() + last);
+        for (size_t col = 0; col < columns.size(); col++) {
+            const std::vector<double>& vec = log_data.signals.at(columns[col]);
+            values[col].assign(vec.begin() + first, vec.begin() + last);
+        }
+    }
+
+    if (spill_writer.file == nullptr && !binary_log::OpenWriter(spill_writer, spill_path, column_types)) {
+        serial_front::AddLog("%s ERROR: Could not open spill file %s\n", ERROR_CHAR, spill_path.c_str());
+        serial_back::GetSettings()->ram_window_s = 0;
+        serial_back::MarkSettingsDirty();
+        return;
+    }
+    // Whole chunks are spilled, so the last row flushes the last of them
+    bool written = true;
+    std::vector<double> row_values(columns.size());
+    for (size_t row = 0; row < time.size() && written; row++) {
+        for (size_t col = 0; col < columns.size(); col++) {
+            row_values[col] = values[col][row];
+        }
+        written = binary_log::AppendRow(spill_writer, time[row], row_values.data());
+    }
+    if (!written) {
+        // The rows stay in RAM, nothing is lost but RAM is no longer bounded
+        serial_front::AddLog("%s ERROR: Could not write spill file %s, spilling stopped\n", ERROR_CHAR,
+                             spill_path.c_str());
+        serial_back::GetSettings()->ram_window_s = 0;
+        serial_back::MarkSettingsDirty();
+        return;
+    }
+
+    {
+        const std::lock_guard<std::mutex> lock(log_mutex);
+        spilled_in_ram += time.size();
+        if (spilled_in_ram >= log_data.time.size() - spilled_in_ram) {
+            auto const count = static_cast<std::ptrdiff_t>(spilled_in_ram);
+            log_data.time.erase(log_data.time.begin(), log_data.time.begin() + count);
+            for (auto& [name, vec] : log_data.signals) {
+                vec.erase(vec.begin(), vec.begin() + count);
+            }
+            written_rows -= spilled_in_ram;
+            spilled_in_ram = 0;
+        }
+    }
+    spilled_rows += time.size();
+}
+
+void WriterTask() {
+    TRACE_THREAD_NAME("log writer");
+    std::unique_lock<std::mutex> lock(writer_mutex);
+    while (!writer_exit) {
+        writer_cv.wait_for(lock, write_interval, [] { return writer_exit; });
+        lock.unlock();
+        TRACE_ZONE("WriteLog");
+        while (WriteRows(false) == max_batch_rows) {
+        }
+        // Rows reach the disk even if the app never gets to stop the log.
+        // The binary writer flushes each completed chunk.
+        if (!binary_format) {
+            std::fflush(csv_file);
+        }
+        SpillRows();
+        lock.lock();
+    }
+    lock.unlock();
+
+    while (WriteRows(true) > 0) {
+    }
+    bool written = true;
+    if (binary_format) {
+        written = binary_log::CloseWriter(binary_writer, link_health::FormatHeader("#"));
+    } else {
+        std::fputs(link_health::FormatHeader("#").c_str(), csv_file);
+        written = std::ferror(csv_file) == 0;
+        written = std::fclose(csv_file) == 0 && written;
+        csv_file = nullptr;
+    }
+    if (!written) {
+        serial_front::AddLog("%s ERROR: Could not write log file %s, the log is incomplete.\n", ERROR_CHAR,
+                             log_file_path.c_str());
+    }
+    // Closed with an index, history stays readable after the log stops
+    binary_log::CloseWriter(spill_writer, "");
 }
 
-double TypeCast(uint32_t rx_val, VariableType type) {
+void StopWriter() {
+    {
+        const std::lock_guard<std::mutex> lock(writer_mutex);
+        writer_exit = true;
+    }
+    writer_cv.notify_one();
+    if (writer_thread.joinable()) {
+        writer_thread.join();
+    }
+}
+
+double TypeCast(uint64_t rx_val, VariableType type) {
     switch (type) {
         case VariableType::TYPE_UINT8:
             return static_cast<double>(static_cast<uint8_t>(rx_val));
         case VariableType::TYPE_UINT16:
             return static_cast<double>(static_cast<uint16_t>(rx_val));
         case VariableType::TYPE_UINT32:
-            return static_cast<double>(rx_val);
+            return static_cast<double>(static_cast<uint32_t>(rx_val));
         case VariableType::TYPE_INT8:
             return static_cast<double>(static_cast<int8_t>(rx_val));
         case VariableType::TYPE_INT16:
             return static_cast<double>(static_cast<int16_t>(rx_val));
         case VariableType::TYPE_INT32:
             return static_cast<double>(static_cast<int32_t>(rx_val));
-        case VariableType::TYPE_FLOAT:
-            return static_cast<double>(*reinterpret_cast<float*>(&rx_val));
-        case VariableType::TYPE_DOUBLE:
-            return static_cast<double>(*reinterpret_cast<double*>(&rx_val));
+        case VariableType::TYPE_FLOAT: {
+            uint32_t const bits = static_cast<uint32_t>(rx_val);
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return static_cast<double>(value);
+        }
+        case VariableType::TYPE_DOUBLE: {
+            double value;
+            std::memcpy(&value, &rx_val, sizeof(value));
+            return value;
+        }
         default:
-            return static_cast<double>(rx_val); // Default for unknown types
+            return static_cast<double>(static_cast<uint32_t>(rx_val)); // Default for unknown types
     }
 }
 
@@ -61,6 +267,8 @@ double TypeCast(uint32_t rx_val, VariableType type) {
 
 namespace data_logger {
 void init(const std::unordered_map<std::string, VarStruct>& variables) {
+    DeInit();
+
     log_data.time.clear();
     log_data.signals.clear();
     // Set up log variables based on the provided variables.
@@ -73,28 +281,115 @@ void init(const std::unordered_map<std::string, VarStruct>& variables) {
     auto time_local = *std::localtime(&time);
     std::ostringstream oss;
     oss << std::put_time(&time_local, "%Y-%m-%d_%H'%M''%S");
-    log_file_path = "logs/" + oss.str() + ".csv";
+    binary_format = serial_back::GetSettings()->binary_log;
+    log_file_path = "logs/" + oss.str() + (binary_format ? ".jvbl" : ".csv");
 
     InitSerialStream(variables);
+
+    // Check if path exists, if not create it
+    if (!std::filesystem::exists("logs")) {
+        std::filesystem::create_directory("logs");
+    }
+
+    // Sorted by name, the same selection always gives the same columns
+    columns.clear();
+    column_types.clear();
+    for (const auto& var : log_data.signals) {
+        columns.push_back(var.first);
+    }
+    std::sort(columns.begin(), columns.end());
+    for (const auto& name : columns) {
+        column_types.push_back({name, variables.at(name).type});
+    }
+    spill_path = "logs/" + oss.str() + ".spill.jvbl";
+
+    bool opened = false;
+    if (binary_format) {
+        opened = binary_log::OpenWriter(binary_writer, log_file_path, column_types);
+    } else {
+        csv_format = settings::GetCsvFormat();
+        csv_file = std::fopen(log_file_path.c_str(), "wb");
+        opened = csv_file != nullptr;
+        if (opened) {
+            std::fputs(csv_writer::FormatHeader(columns, csv_format).c_str(), csv_file);
+        }
+    }
+    if (!opened) {
+        serial_front::AddLog("%s ERROR: Could not open log file %s\n", ERROR_CHAR,
+                             log_file_path.c_str());
+        return;
+    }
+
+    written_rows = 0;
+    spilled_in_ram = 0;
+    writer_exit = false;
+    writer_thread = std::thread(WriterTask);
+}
+
+/*
+ * Removes the spill store of the last log, the saved log file is kept.
+ */
+void DeInit() {
+    StopWriter();
+    spilled_rows = 0;
+    if (!spill_path.empty()) {
+        std::error_code error;
+        std::filesystem::remove(spill_path, error);
+    }
 }
 
 Data* GetLogData() {
     return &log_data;
 }
 
+std::unique_lock<std::mutex> LockLogData() {
+    return std::unique_lock<std::mutex>(log_mutex);
+}
+
+uint64_t GetSpilledRows() {
+    return spilled_rows;
+}
+
+/*
+ * Reads rows that were spilled out of RAM, decimated on read so that at most
+ * about max_rows rows are returned.
+ */
+bool ReadHistory(double t0, double t1, size_t max_rows, Data& out) {
+    out.time.clear();
+    out.signals.clear();
+    if (spilled_rows == 0) {
+        return false;
+    }
+
+    BinaryLogReader reader;
+    if (!binary_log::OpenReader(reader, spill_path)) {
+        return false;
+    }
+    uint64_t const rows = binary_log::RowsInRange(reader, t0, t1);
+    size_t const stride = max_rows > 0 ? static_cast<size_t>((rows + max_rows - 1) / max_rows) : 1;
+    binary_log::ReadRange(reader, t0, t1, out, stride);
+    binary_log::CloseReader(reader);
+    return true;
+}
+
+std::string GetLogFilePath() {
+    return log_file_path;
+}
+
 void LogFrame(const FrameStruct& frame) {
-    performance_analysis::Start(performance_analysis::AnalysisIndex::FUNC_LOG_FRAME);
+    TRACE_ZONE("LogFrame");
     std::lock_guard<std::mutex> const lock(log_mutex);
-    const float us_to_sec = 1e6F;
+    const double us_to_sec = 1e6;
 
     if (log_data.time.empty()) {
         // The time stamp from CU is probably a free running timer, sp the first frame will most
         // likely not start at 0.
         // TODO(chejd): time scaling from some config with CU
-        base_time = static_cast<float>(frame.latest_timestamp) / us_to_sec;  // Convert to seconds
+        base_time = static_cast<double>(frame.latest_timestamp) / us_to_sec;  // Convert to seconds
     }
 
-    float log_time = (static_cast<float>(frame.latest_timestamp) / us_to_sec) - base_time;
+    // Double, a float only resolves ~15 ms after a couple of days
+    double log_time = (static_cast<double>(frame.latest_timestamp) / us_to_sec) - base_time;
     // If the log is empty, set first value for all variables to 0.0
     // Else if the time is new, append new time and copy the last value for all variables
     if (log_data.time.empty()) {
@@ -117,51 +412,13 @@ void LogFrame(const FrameStruct& frame) {
             it->second.back() = value;
         }
     }
-
-    performance_analysis::End(performance_analysis::AnalysisIndex::FUNC_LOG_FRAME);
 }
 
 /*
- * Saves log data to a CSV file.
+ * Writes the remaining rows and the link statistics, then closes the log file.
+ * Rows are written continuously while logging, so only the last write interval is left.
  */
 void SaveLog() {
-    // TODO(chejd): currently writes all data in a batch. Make it so it can write data
-    // incrementally so it can be done continuously while logging. Do a deepcopy of
-    // log_variables to avoid issues with concurrent access
-    Data log_variables_copy = DeepCopyLogVariables();
-
-    // Check if path exists, if not create it
-    if (!std::filesystem::exists("logs")) {
-        std::filesystem::create_directory("logs");
-    }
-
-    std::ofstream log_file(log_file_path);
-    if (!log_file.is_open()) {
-        serial_front::AddLog("%s ERROR: Could not open log file %s\n", ERROR_CHAR,
-                             log_file_path.c_str());
-        return;
-    }
-
-    log_file << "Time,";
-    for (const auto& var : log_variables_copy.signals) {
-        log_file << var.first << ",";
-    }
-    log_file << "\n";
-
-    // Write data
-    size_t const num_rows = log_variables_copy.signals.begin()->second.size();
-    for (size_t i = 0; i < num_rows; ++i) {
-        log_file << log_variables_copy.time[i] << ",";
-        for (const auto& var : log_variables_copy.signals) {
-            log_file << var.second[i];
-            // No comma for last variable column
-            //if (i < num_rows - 1) {
-                log_file << ",";
-            //}
-        }
-        log_file << "\n";
-    }
-
-    log_file.close();
+    StopWriter();
 }
-}  // namespace data_logger
\ No newline at end of file
+}  // namespace data_logger
@@ -1,24 +1,14 @@
 #include "elf_parser.h"
 
+#include "elf_reader.h"
 #include "serial_front.h"
 #include "serial_back.h"
-#include "json.hpp"
+#include "symbol_cache.h"
 
+#include <chrono>
 #include <filesystem>
-#include <array>
-#include <thread>
-#include <regex>
-#include <fstream>
-#include <iostream>
-
-using Json = nlohmann::json;
 
 namespace {
-    typedef struct {
-        std::string     file;
-        VariableType    type;
-        std::string     raw_line;
-    } SourceFileInfo;
     std::vector<std::string> variable_types = {
         "uint8_t", 
         "uint16_t", 
@@ -43,254 +33,80 @@ namespace {
             serial_front::AddLog("%s ERROR: ELF file %s does not exist.\n", ERROR_CHAR, settings.elf_file_path.c_str());
             return false;
         }
-        // Check if nm is set
-        if (settings.nm.empty()) {
-            serial_front::AddLog("%s ERROR: nm command is not set.\n", ERROR_CHAR);
-            return false;
-        }
-        // check if nm exists
-        if (!std::filesystem::exists(settings.nm)) {
-            serial_front::AddLog("%s ERROR: nm command %s does not exist.\n", ERROR_CHAR, settings.nm.c_str());
-            return false;
-        }
-        // Check if addr2line is set
-        if (settings.addr2line.empty()) {
-            serial_front::AddLog("%s ERROR: addr2line command is not set.\n", ERROR_CHAR);
-            return false;
-        }
-        // check if addr2line exists
-        if (!std::filesystem::exists(settings.addr2line)) {
-            serial_front::AddLog("%s ERROR: addr2line command %s does not exist.\n", ERROR_CHAR, settings.addr2line.c_str());
-            return false;
-        }
-        return true;
-    }
-
-    VariableType GetTypeFromFile(const std::string& file_path) {
-        // string looks like: C:/path/to/file.c:72
-        // open the file and read the line number
-        // have to clean the path to remove the line number
-        std::regex path_regex(R"((.*):\d+)");
-        std::smatch match;
-        std::string cleaned_path;
-        if (std::regex_search(file_path, match, path_regex)) {
-            cleaned_path = match[1].str();
-        } else {
-            return VariableType::TYPE_UINT32; // Default type if no match found
-        }
-
-        std::ifstream file(cleaned_path);
-        if (!file.is_open()) {
-            serial_front::AddLog("%s ERROR: Could not open file %s\n", ERROR_CHAR, cleaned_path.c_str());
-            return VariableType::TYPE_UINT32;
-        }
-
-        // Get the line to read from the path
-        std::regex line_regex(R"(:(\d+)$)");
-        uint32_t line_number = 0;
-        if (std::regex_search(file_path, match, line_regex)) {
-            line_number = std::stoul(match[1].str());
-        } else {
-            serial_front::AddLog("%s ERROR: Could not extract line number from file path %s\n", ERROR_CHAR, file_path.c_str());
-            return VariableType::TYPE_UINT32; // Default type if no line number found
-        }
-
-        // Read the specified line
-        std::string line;
-        for (uint32_t i = 0; i < line_number && std::getline(file, line); ++i) {
-            // Skip lines until we reach the desired line number
-        }
-        file.close();
-
-        // Go though each word in the line and check if it matches a type
-        std::istringstream iss(line);
-        std::string word;
-        while (iss >> word) {
-            for (size_t i = 0; i < VariableType::TYPE_NUM_OF_TYPES; ++i) {
-                if (word == variable_types[i]) {
-                    std::cout << "Found type: " << variable_types[i] << " in file: " << cleaned_path << ", line: " << line_number << "\n";
-                    std::cout << "      " << line << "\n";
-                    return static_cast<VariableType>(i); // Return the first matching type
-                }
-            }
-        }
-
-        return VariableType::TYPE_UINT32;
-    }
-
-    bool GetSourceFileInfo(const std::string& address_str, SourceFileInfo& info) {
-        SerialBack_Settings * settings = serial_back::GetSettings();
-        
-        std::string addr2line_cmd = 
-            settings->addr2line + " -e " + settings->elf_file_path + " " + address_str;
-
-        // Run addr2line
-        std::array<char, 128> addr2line_buffer;
-        std::shared_ptr<FILE> addr2line_pipe(popen(addr2line_cmd.c_str(), "r"), pclose);
-        if (!addr2line_pipe) {
-            serial_front::AddLog("%s ERROR: Failed to run command: %s\n", ERROR_CHAR, addr2line_cmd.c_str());
-            return false;
-        }
-
-        // Process addr2line output
-        if (fgets(addr2line_buffer.data(), addr2line_buffer.size(), addr2line_pipe.get()) != nullptr) {
-            info.raw_line = std::string(addr2line_buffer.data());
-            // Remove trailing newline
-            info.raw_line.erase(std::remove(info.raw_line.begin(), info.raw_line.end(), '\n'), info.raw_line.end());
-        } else {
-            serial_front::AddLog("%s ERROR: Failed to get file path for address: %s\n", ERROR_CHAR, address_str.c_str());
-            return false;
-        }
-
-        // file_path looks like: /path/to/file.c:72
-        // use regex to extract the file name
-        std::regex file_regex(R"(([^/\\]+):\d+)");
-        std::smatch file_match;
-        if (std::regex_search(info.raw_line, file_match, file_regex)) {
-            info.type = GetTypeFromFile(info.raw_line);
-            info.file = file_match[1]; // Get the file name without the line number
-        } else {
-            info.file = "-- (declared static?)";
-            info.type = VariableType::TYPE_UINT32;
-        }
-
         return true;
     }
 
-    void FileSymbolMapToJson(FileSymbolMap& grouped_variables) {
-        // Save grouped_variables to JSON file
-        Json json;
-        for (const auto& [file, symbols] : grouped_variables) {
-            Json symbol_array = Json::array();
-            for (const auto& [name, info] : symbols) {
-                Json symbol_info = {
-                    {"name", name},
-                    {"address", info.address},
-                    {"size", info.size},
-                    {"frame", info.frame},
-                    {"type", (int)info.type}
-                };
-                symbol_array.push_back(symbol_info);
-            }
-            json[file] = symbol_array;
-        }
-
-        // Write JSON to file
-        std::ofstream file("resources/symbol_map.json");
-        if (file.is_open()) {
-            file << json.dump(4); // Pretty print with 4 spaces
-            file.close();
-        }
+    bool IsSymbolMapFile(const std::string& path) {
+        return std::filesystem::path(path).extension() == ".jvsym";
     }
-
 } // anonymous namespace
 
 namespace elf_parser {
-    /*
-     * Checks if the timestamp of the current map file is newer than the 
-     * timestamp from when the file was parsed.
-     */
-    bool ElfFileChanged(std::string elf_file_path) {
-        static std::filesystem::file_time_type last_write_time;
-        static bool error_thrown = false; // to not get error msg many times
-        std::filesystem::path file_path(elf_file_path);
-        if (elf_file_path.empty()) {
-            return false; // No path provided
-        }
-        if (!std::filesystem::exists(file_path)) {
-            if (!error_thrown)
-                serial_front::AddLog("%s ERROR: elf file %s does not exist.\n", INFO_CHAR, elf_file_path.c_str());
-            error_thrown = true;
-            //elf_file_path = "";
-            //parsed_map.clear();
-            return false; // File does not exist
-        }
-        error_thrown = false;
-        auto current_write_time = std::filesystem::last_write_time(file_path);
-        if (current_write_time != last_write_time) {
-            last_write_time = current_write_time;
-            return true; // File has changed
-        }
-        return false; // No change detected
-    }
-
     bool ParseElfFile() {
         FileSymbolMap grouped_variables;
-        //FileSymbolMap grouped_variables;
         SerialBack_Settings * settings = serial_back::GetSettings();
 
         if (!CheckSettings(*settings)) {
             return false;
         }
+        if (IsSymbolMapFile(settings->elf_file_path)) {
+            return true;   // Already parsed, e.g. written by the device emulator
+        }
 
-        std::string cmd = settings->nm + " -S " + settings->elf_file_path;
-        std::array<char, 0xFF+1> res_buffer;
+        std::string const key = elf_reader::GetBuildKey(settings->elf_file_path);
+        if (symbol_cache::Exists(key)) {
+            // A build seen before, e.g. switching back to another firmware variant
+            serial_front::AddLog("%s Using cached symbols of %s (%s)\n", INFO_CHAR, settings->elf_file_path.c_str(),
+                                 key.c_str());
+            return true;
+        }
 
-        std::shared_ptr<FILE> pipe(popen(cmd.c_str(), "r"), pclose);
-        if (!pipe) {
-            serial_front::AddLog("%s ERROR: Failed to run command: %s\n", ERROR_CHAR, cmd.c_str());
+        auto const start = std::chrono::steady_clock::now();
+        std::vector<ElfSymbol> symbols;
+        if (!elf_reader::ReadDataSymbols(settings->elf_file_path, symbols)) {
             return false;
         }
 
-        // Go through result of nm
-        while (fgets(res_buffer.data(), res_buffer.size(), pipe.get()) != nullptr) {
-            std::string line(res_buffer.data());
-            std::istringstream iss(line);
-            std::string symbol;
-            std::string size_str;
-            std::string type;
-            std::string address_str;
-
-            // Parse the line
-            if (!(iss >> address_str >> size_str >> type >> symbol)) {
-                continue; // Skip lines that do not match the expected format
-            }
-
-            if (type != "B" && type != "b" && type != "D" && type != "d") {
-                continue;
-            }
-
-            SourceFileInfo file_info;
-            if (!GetSourceFileInfo(address_str, file_info)) {
-                file_info.file = "-- (decared static?)";
-                file_info.type = VariableType::TYPE_UINT32; // Default type if addr2line fails
-            }
-
-            grouped_variables[file_info.file][symbol] = {
-                .address = std::stoul(address_str, nullptr, 16),
-                .size    = std::stoul(size_str, nullptr, 16),
-                .frame   = 0, // Frame is not used in this context
-                .type    = file_info.type
+        for (const auto& symbol : symbols) {
+            std::string const file = symbol.file.empty() ? "-- (no debug info)" : symbol.file;
+            grouped_variables[file][symbol.name] = {
+                .address    = static_cast<uint32_t>(symbol.address),
+                .size       = static_cast<size_t>(symbol.size),
+                .frame      = 0, // Frame is not used in this context
+                // Without debug info keep the old default. Leaves the logger cannot
+                // decode, like 64 bit integers, stay unknown and cannot be selected.
+                .type       = symbol.type == TYPE_UNKNOWN && symbol.file.empty() ? TYPE_UINT32 : symbol.type,
+                .bit_offset = symbol.bit_offset,
+                .bit_size   = symbol.bit_size
             };
         }
 
-        FileSymbolMapToJson(grouped_variables);
+        double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        serial_front::AddLog("%s Parsed %zu symbols from %s in %.3f s\n", INFO_CHAR, symbols.size(),
+                             settings->elf_file_path.c_str(), seconds);
+        if (!symbol_cache::Save(key, grouped_variables)) {
+            serial_front::AddLog("%s ERROR: Could not write the symbol cache of %s\n", ERROR_CHAR,
+                                 settings->elf_file_path.c_str());
+            return false;
+        }
         return true;
     }
 
-    void FileSymbolMapFromJson(FileSymbolMap& grouped_variables) {
-        // Read JSON from file
-        std::ifstream in_file("resources/symbol_map.json");
-        if (!in_file.is_open()) {
-            serial_front::AddLog("%s ERROR: Failed to open JSON file: %s\n", ERROR_CHAR, "resources/symbol_map.json");
-            return;
-        }
-
-        Json json;
-        in_file >> json;
-
-        // Populate grouped_variables from JSON
-        for (const auto& [file, symbol_array] : json.items()) {
-            for (const auto& symbol_info : symbol_array) {
-                std::string name = symbol_info["name"];
-                grouped_variables[file][name] = {
-                    .address = symbol_info["address"],
-                    .size    = symbol_info["size"],
-                    .frame   = symbol_info["frame"],
-                    .type    = static_cast<VariableType>(symbol_info["type"])
-                };
+    /*
+     * Loads the symbols of the configured ELF file from the cache. Fails when
+     * that build has not been parsed yet.
+     */
+    bool LoadSymbolMap(FileSymbolMap& grouped_variables) {
+        SerialBack_Settings * settings = serial_back::GetSettings();
+        if (IsSymbolMapFile(settings->elf_file_path)) {
+            if (!symbol_cache::LoadFile(settings->elf_file_path, grouped_variables)) {
+                serial_front::AddLog("%s ERROR: Could not read symbol map %s\n", ERROR_CHAR,
+                                     settings->elf_file_path.c_str());
+                return false;
             }
+            return true;
         }
+        return symbol_cache::Load(elf_reader::GetBuildKey(settings->elf_file_path), grouped_variables);
     }
 
     std::vector<std::string> GetVariableTypes() {
@@ -0,0 +1,1321 @@
+#include "elf_reader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+#include "mapped_file.h"
+#include "serial_front.h"
+
+namespace {
+    // ELF section types and flags
+    const uint32_t kSectionSymtab = 2;
+    const uint32_t kSectionNote = 7;
+    const uint32_t kSectionNobits = 8;
+    const uint32_t kNoteGnuBuildId = 3;
+    const uint64_t kFlagWrite = 0x1;
+    const uint64_t kFlagAlloc = 0x2;
+    const uint64_t kFlagExec = 0x4;
+    const uint64_t kFlagCompressed = 0x800;
+
+    // ELF symbol types and special section indices
+    const uint8_t  kSymbolNoType = 0;
+    const uint8_t  kSymbolObject = 1;
+    const uint16_t kSectionReserved = 0xFF00;
+
+    // The subset of DWARF 2-5 constants used here
+    enum : uint64_t {
+        DW_TAG_array_type = 0x01,
+        DW_TAG_base_type = 0x24,
+        DW_TAG_class_type = 0x02,
+        DW_TAG_compile_unit = 0x11,
+        DW_TAG_const_type = 0x26,
+        DW_TAG_enumeration_type = 0x04,
+        DW_TAG_member = 0x0D,
+        DW_TAG_partial_unit = 0x3C,
+        DW_TAG_pointer_type = 0x0F,
+        DW_TAG_restrict_type = 0x37,
+        DW_TAG_skeleton_unit = 0x4A,
+        DW_TAG_structure_type = 0x13,
+        DW_TAG_subrange_type = 0x21,
+        DW_TAG_typedef = 0x16,
+        DW_TAG_union_type = 0x17,
+        DW_TAG_variable = 0x34,
+        DW_TAG_volatile_type = 0x35,
+        DW_TAG_atomic_type = 0x47,
+    };
+    enum : uint64_t {
+        DW_AT_location = 0x02,
+        DW_AT_name = 0x03,
+        DW_AT_byte_size = 0x0B,
+        DW_AT_bit_offset = 0x0C,
+        DW_AT_bit_size = 0x0D,
+        DW_AT_stmt_list = 0x10,
+        DW_AT_lower_bound = 0x22,
+        DW_AT_upper_bound = 0x2F,
+        DW_AT_abstract_origin = 0x31,
+        DW_AT_count = 0x37,
+        DW_AT_data_member_location = 0x38,
+        DW_AT_decl_file = 0x3A,
+        DW_AT_encoding = 0x3E,
+        DW_AT_specification = 0x47,
+        DW_AT_type = 0x49,
+        DW_AT_data_bit_offset = 0x6B,
+        DW_AT_str_offsets_base = 0x72,
+        DW_AT_addr_base = 0x73,
+        DW_AT_GNU_addr_base = 0x2133,
+    };
+    enum : uint64_t {
+        DW_FORM_addr = 0x01,
+        DW_FORM_block2 = 0x03,
+        DW_FORM_block4 = 0x04,
+        DW_FORM_data2 = 0x05,
+        DW_FORM_data4 = 0x06,
+        DW_FORM_data8 = 0x07,
+        DW_FORM_string = 0x08,
+        DW_FORM_block = 0x09,
+        DW_FORM_block1 = 0x0A,
+        DW_FORM_data1 = 0x0B,
+        DW_FORM_flag = 0x0C,
+        DW_FORM_sdata = 0x0D,
+        DW_FORM_strp = 0x0E,
+        DW_FORM_udata = 0x0F,
+        DW_FORM_ref_addr = 0x10,
+        DW_FORM_ref1 = 0x11,
+        DW_FORM_ref2 = 0x12,
+        DW_FORM_ref4 = 0x13,
+        DW_FORM_ref8 = 0x14,
+        DW_FORM_ref_udata = 0x15,
+        DW_FORM_indirect = 0x16,
+        DW_FORM_sec_offset = 0x17,
+        DW_FORM_exprloc = 0x18,
+        DW_FORM_flag_present = 0x19,
+        DW_FORM_strx = 0x1A,
+        DW_FORM_addrx = 0x1B,
+        DW_FORM_ref_sup4 = 0x1C,
+        DW_FORM_strp_sup = 0x1D,
+        DW_FORM_data16 = 0x1E,
+        DW_FORM_line_strp = 0x1F,
+        DW_FORM_ref_sig8 = 0x20,
+        DW_FORM_implicit_const = 0x21,
+        DW_FORM_loclistx = 0x22,
+        DW_FORM_rnglistx = 0x23,
+        DW_FORM_ref_sup8 = 0x24,
+        DW_FORM_strx1 = 0x25,
+        DW_FORM_strx2 = 0x26,
+        DW_FORM_strx3 = 0x27,
+        DW_FORM_strx4 = 0x28,
+        DW_FORM_addrx1 = 0x29,
+        DW_FORM_addrx2 = 0x2A,
+        DW_FORM_addrx3 = 0x2B,
+        DW_FORM_addrx4 = 0x2C,
+        DW_FORM_GNU_addr_index = 0x1F01,
+        DW_FORM_GNU_str_index = 0x1F02,
+        DW_FORM_GNU_ref_alt = 0x1F20,
+        DW_FORM_GNU_strp_alt = 0x1F21,
+    };
+    enum : uint8_t {
+        DW_OP_addr = 0x03,
+        DW_OP_plus_uconst = 0x23,
+        DW_OP_addrx = 0xA1,
+        DW_OP_GNU_addr_index = 0xFB,
+    };
+    enum : uint64_t {
+        DW_ATE_boolean = 0x02,
+        DW_ATE_float = 0x04,
+        DW_ATE_signed = 0x05,
+        DW_ATE_signed_char = 0x06,
+        DW_ATE_unsigned = 0x07,
+        DW_ATE_unsigned_char = 0x08,
+        DW_ATE_UTF = 0x10,
+    };
+    const uint64_t DW_LNCT_path = 0x1;
+    const uint8_t  DW_UT_type = 0x02;
+    const uint8_t  DW_UT_skeleton = 0x04;
+    const uint8_t  DW_UT_split_compile = 0x05;
+    const uint8_t  DW_UT_split_type = 0x06;
+
+    typedef struct {
+        const uint8_t* data;
+        size_t         size;
+    } Section;
+
+    // Bounds checked reader. Reading past the end clears ok and yields zeros.
+    typedef struct {
+        const uint8_t* pos;
+        const uint8_t* end;
+        bool           big_endian;
+        bool           ok;
+    } Cursor;
+
+    Cursor MakeCursor(Section section, uint64_t offset, bool big_endian) {
+        bool const ok = section.data != nullptr && offset <= section.size;
+        size_t const start = ok ? static_cast<size_t>(offset) : section.size;
+        return {section.data + start, section.data + section.size, big_endian, ok};
+    }
+
+    bool Skip(Cursor& cursor, uint64_t bytes) {
+        if (!cursor.ok || bytes > static_cast<uint64_t>(cursor.end - cursor.pos)) {
+            cursor.ok = false;
+            cursor.pos = cursor.end;
+            return false;
+        }
+        cursor.pos += bytes;
+        return true;
+    }
+
+    uint64_t ReadUnsigned(Cursor& cursor, size_t bytes) {
+        const uint8_t* start = cursor.pos;
+        if (!Skip(cursor, bytes)) {
+            return 0;
+        }
+        uint64_t value = 0;
+        for (size_t i = 0; i < bytes; i++) {
+            size_t const shift = cursor.big_endian ? (bytes - 1 - i) * 8 : i * 8;
+            value |= static_cast<uint64_t>(start[i]) << shift;
+        }
+        return value;
+    }
+
+    uint64_t ReadUleb(Cursor& cursor) {
+        uint64_t value = 0;
+        unsigned shift = 0;
+        while (cursor.ok) {
+            if (cursor.pos >= cursor.end) {
+                cursor.ok = false;
+                break;
+            }
+            uint8_t const byte = *cursor.pos++;
+            if (shift < 64) {
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            }
+            shift += 7;
+            if ((byte & 0x80) == 0) {
+                break;
+            }
+        }
+        return value;
+    }
+
+    int64_t ReadSleb(Cursor& cursor) {
+        uint64_t value = 0;
+        unsigned shift = 0;
+        uint8_t byte = 0;
+        while (cursor.ok) {
+            if (cursor.pos >= cursor.end) {
+                cursor.ok = false;
+                return 0;
+            }
+            byte = *cursor.pos++;
+            if (shift < 64) {
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            }
+            shift += 7;
+            if ((byte & 0x80) == 0) {
+                break;
+            }
+        }
+        if (shift < 64 && (byte & 0x40) != 0) {
+            value |= ~static_cast<uint64_t>(0) << shift;
+        }
+        return static_cast<int64_t>(value);
+    }
+
+    const char* ReadString(Cursor& cursor) {
+        if (!cursor.ok) {
+            return "";
+        }
+        const void* nul = std::memchr(cursor.pos, 0, static_cast<size_t>(cursor.end - cursor.pos));
+        if (nul == nullptr) {
+            cursor.ok = false;
+            cursor.pos = cursor.end;
+            return "";
+        }
+        const char* text = reinterpret_cast<const char*>(cursor.pos);
+        cursor.pos = static_cast<const uint8_t*>(nul) + 1;
+        return text;
+    }
+
+    const char* StringAt(Section section, uint64_t offset) {
+        if (section.data == nullptr || offset >= section.size ||
+            std::memchr(section.data + offset, 0, section.size - offset) == nullptr) {
+            return "";
+        }
+        return reinterpret_cast<const char*>(section.data + offset);
+    }
+
+    std::string BaseName(const char* path) {
+        std::string const name(path);
+        size_t const slash = name.find_last_of("/\\");
+        return slash == std::string::npos ? name : name.substr(slash + 1);
+    }
+
+/* --------------------------------- ELF ----------------------------------- */
+
+    typedef struct {
+        std::string name;
+        uint32_t    type;
+        uint64_t    flags;
+        uint64_t    offset;
+        uint64_t    size;
+        uint32_t    link;
+        uint64_t    entry_size;
+    } SectionHeader;
+
+    typedef struct {
+        MappedFile                 file;
+        bool                       is_64;
+        bool                       big_endian;
+        std::vector<SectionHeader> sections;
+    } ElfFile;
+
+    bool ReadSectionHeaders(ElfFile& elf) {
+        const MappedFile& file = elf.file;
+        if (file.size < 0x40 || std::memcmp(file.data, "\x7F" "ELF", 4) != 0) {
+            return false;
+        }
+        uint8_t const elf_class = file.data[4];
+        uint8_t const elf_data = file.data[5];
+        if ((elf_class != 1 && elf_class != 2) || (elf_data != 1 && elf_data != 2)) {
+            return false;
+        }
+        elf.is_64 = elf_class == 2;
+        elf.big_endian = elf_data == 2;
+
+        Section const whole = {file.data, file.size};
+        Cursor header = MakeCursor(whole, elf.is_64 ? 0x28 : 0x20, elf.big_endian);
+        uint64_t const section_offset = ReadUnsigned(header, elf.is_64 ? 8 : 4);
+        Skip(header, 4 + 2 + 2 + 2);   // e_flags, e_ehsize, e_phentsize, e_phnum
+        uint64_t const entry_size = ReadUnsigned(header, 2);
+        uint64_t const count = ReadUnsigned(header, 2);
+        uint64_t const names_index = ReadUnsigned(header, 2);
+        if (!header.ok || entry_size < (elf.is_64 ? 64U : 40U) || section_offset >= file.size ||
+            count > (file.size - section_offset) / entry_size) {
+            return false;
+        }
+
+        elf.sections.resize(count);
+        std::vector<uint32_t> name_offsets(count);
+        for (size_t i = 0; i < count; i++) {
+            Cursor entry = MakeCursor(whole, section_offset + i * entry_size, elf.big_endian);
+            SectionHeader& section = elf.sections[i];
+            size_t const word = elf.is_64 ? 8 : 4;
+            name_offsets[i] = static_cast<uint32_t>(ReadUnsigned(entry, 4));
+            section.type = static_cast<uint32_t>(ReadUnsigned(entry, 4));
+            section.flags = ReadUnsigned(entry, word);
+            Skip(entry, word);   // sh_addr
+            section.offset = ReadUnsigned(entry, word);
+            section.size = ReadUnsigned(entry, word);
+            section.link = static_cast<uint32_t>(ReadUnsigned(entry, 4));
+            Skip(entry, 4 + word);   // sh_info, sh_addralign
+            section.entry_size = ReadUnsigned(entry, word);
+            if (section.type != kSectionNobits && (section.offset > file.size || section.size > file.size - section.offset)) {
+                section.size = 0;   // Truncated file, treat the section as empty
+            }
+        }
+
+        if (names_index < count) {
+            const SectionHeader& names = elf.sections[names_index];
+            Section const strings = {file.data + names.offset, static_cast<size_t>(names.size)};
+            for (size_t i = 0; i < count; i++) {
+                elf.sections[i].name = StringAt(strings, name_offsets[i]);
+            }
+        }
+        return true;
+    }
+
+    Section GetSection(const ElfFile& elf, const char* name) {
+        for (const auto& section : elf.sections) {
+            if (section.name == name && section.type != kSectionNobits && (section.flags & kFlagCompressed) == 0) {
+                return {elf.file.data + section.offset, static_cast<size_t>(section.size)};
+            }
+        }
+        return {nullptr, 0};
+    }
+
+    /*
+     * Object symbols with a size in writable, allocated sections, the same set
+     * nm -S reports as B, b, D and d.
+     */
+    void ReadSymbols(const ElfFile& elf, std::vector<ElfSymbol>& symbols) {
+        for (const auto& symtab : elf.sections) {
+            if (symtab.type != kSectionSymtab || symtab.link >= elf.sections.size()) {
+                continue;
+            }
+            size_t const entry_size = elf.is_64 ? 24 : 16;
+            if (symtab.entry_size < entry_size) {
+                continue;
+            }
+            const SectionHeader& strtab = elf.sections[symtab.link];
+            Section const names = {elf.file.data + strtab.offset, static_cast<size_t>(strtab.size)};
+            Section const table = {elf.file.data + symtab.offset, static_cast<size_t>(symtab.size)};
+
+            for (uint64_t offset = 0; offset + entry_size <= table.size; offset += symtab.entry_size) {
+                Cursor entry = MakeCursor(table, offset, elf.big_endian);
+                uint64_t name = 0;
+                uint64_t value = 0;
+                uint64_t size = 0;
+                uint8_t info = 0;
+                uint64_t section_index = 0;
+                name = ReadUnsigned(entry, 4);
+                if (elf.is_64) {
+                    info = static_cast<uint8_t>(ReadUnsigned(entry, 1));
+                    Skip(entry, 1);
+                    section_index = ReadUnsigned(entry, 2);
+                    value = ReadUnsigned(entry, 8);
+                    size = ReadUnsigned(entry, 8);
+                } else {
+                    value = ReadUnsigned(entry, 4);
+                    size = ReadUnsigned(entry, 4);
+                    info = static_cast<uint8_t>(ReadUnsigned(entry, 1));
+                    Skip(entry, 1);
+                    section_index = ReadUnsigned(entry, 2);
+                }
+
+                uint8_t const type = info & 0x0F;
+                if ((type != kSymbolObject && type != kSymbolNoType) || size == 0 || section_index == 0 ||
+                    section_index >= kSectionReserved || section_index >= elf.sections.size()) {
+                    continue;
+                }
+                uint64_t const flags = elf.sections[section_index].flags;
+                if ((flags & (kFlagAlloc | kFlagWrite)) != (kFlagAlloc | kFlagWrite) || (flags & kFlagExec) != 0) {
+                    continue;
+                }
+                const char* symbol_name = StringAt(names, name);
+                if (symbol_name[0] == '\0') {
+                    continue;
+                }
+                symbols.push_back({symbol_name, value, size, 0, 0, "", TYPE_UNKNOWN});
+            }
+        }
+    }
+
+/* -------------------------------- DWARF ---------------------------------- */
+
+    typedef struct {
+        uint64_t name;
+        uint64_t form;
+        int64_t  implicit_const;
+    } AttrSpec;
+
+    typedef struct {
+        uint64_t              tag;
+        bool                  has_children;
+        std::vector<AttrSpec> attributes;
+    } Abbrev;
+
+    typedef struct {
+        Section info;
+        Section abbrev;
+        Section str;
+        Section line_str;
+        Section line;
+        Section str_offsets;
+        Section addr;
+        bool    big_endian;
+    } Dwarf;
+
+    typedef struct {
+        uint64_t offset;             // Of the unit header in .debug_info
+        uint16_t version;
+        uint8_t  offset_size;        // 4 for 32-bit DWARF, 8 for 64-bit DWARF
+        uint8_t  addr_size;
+        uint64_t str_offsets_base;
+        uint64_t addr_base;
+    } Unit;
+
+    typedef struct {
+        uint64_t       form;
+        uint64_t       value;        // Constants, offsets, indices and absolute references
+        const uint8_t* block;        // Blocks, expressions and inline strings
+        uint64_t       block_size;
+    } AttrValue;
+
+    typedef struct {
+        uint64_t tag;
+        uint64_t byte_size;
+        uint64_t encoding;
+        uint64_t type;               // DIE offset of the referenced type, 0 if none
+        const char* name;
+    } TypeDie;
+
+    typedef struct {
+        const char* name;
+        std::string file;
+        uint64_t    type;
+        uint64_t    specification;   // DIE offset of the declaration, 0 if none
+        uint64_t    address;
+        bool        has_address;
+    } VariableDie;
+
+    typedef struct {
+        const char* name;            // Empty for anonymous structs and unions
+        uint64_t    type;
+        uint64_t    location;        // Byte offset in the parent
+        uint64_t    byte_size;       // Storage unit of DWARF 2/3 bitfields
+        uint64_t    bit_size;        // 0 unless a bitfield
+        uint64_t    bit_offset;      // DWARF 4+ from the parent start, DWARF 2/3 from the storage MSB
+        bool        data_bit_offset; // Which of the two bit_offset is
+    } MemberDie;
+
+    typedef struct {
+        std::unordered_map<uint64_t, TypeDie>                types;
+        std::unordered_map<uint64_t, std::vector<MemberDie>> members;          // Struct or union DIE to members
+        std::unordered_map<uint64_t, std::vector<uint64_t>>  dimensions;       // Array DIE to element counts
+        std::unordered_map<uint64_t, size_t>                 variable_index;   // DIE offset to variables
+        std::vector<VariableDie>                             variables;
+    } DwarfIndex;
+
+    bool IsReference(uint64_t form) {
+        return form == DW_FORM_ref1 || form == DW_FORM_ref2 || form == DW_FORM_ref4 || form == DW_FORM_ref8 ||
+               form == DW_FORM_ref_udata || form == DW_FORM_ref_addr;
+    }
+
+    bool ReadAttr(Cursor& cursor, const Unit& unit, uint64_t form, int64_t implicit_const, AttrValue& attr) {
+        attr = {form, 0, nullptr, 0};
+        switch (form) {
+            case DW_FORM_addr:          attr.value = ReadUnsigned(cursor, unit.addr_size); break;
+            case DW_FORM_data1:
+            case DW_FORM_ref1:
+            case DW_FORM_flag:
+            case DW_FORM_strx1:
+            case DW_FORM_addrx1:        attr.value = ReadUnsigned(cursor, 1); break;
+            case DW_FORM_data2:
+            case DW_FORM_ref2:
+            case DW_FORM_strx2:
+            case DW_FORM_addrx2:        attr.value = ReadUnsigned(cursor, 2); break;
+            case DW_FORM_strx3:
+            case DW_FORM_addrx3:        attr.value = ReadUnsigned(cursor, 3); break;
+            case DW_FORM_data4:
+            case DW_FORM_ref4:
+            case DW_FORM_ref_sup4:
+            case DW_FORM_strx4:
+            case DW_FORM_addrx4:        attr.value = ReadUnsigned(cursor, 4); break;
+            case DW_FORM_data8:
+            case DW_FORM_ref8:
+            case DW_FORM_ref_sig8:
+            case DW_FORM_ref_sup8:      attr.value = ReadUnsigned(cursor, 8); break;
+            case DW_FORM_data16:        Skip(cursor, 16); break;
+            case DW_FORM_sdata:         attr.value = static_cast<uint64_t>(ReadSleb(cursor)); break;
+            case DW_FORM_udata:
+            case DW_FORM_ref_udata:
+            case DW_FORM_strx:
+            case DW_FORM_addrx:
+            case DW_FORM_loclistx:
+            case DW_FORM_rnglistx:
+            case DW_FORM_GNU_addr_index:
+            case DW_FORM_GNU_str_index: attr.value = ReadUleb(cursor); break;
+            case DW_FORM_strp:
+            case DW_FORM_line_strp:
+            case DW_FORM_sec_offset:
+            case DW_FORM_strp_sup:
+            case DW_FORM_GNU_ref_alt:
+            case DW_FORM_GNU_strp_alt:  attr.value = ReadUnsigned(cursor, unit.offset_size); break;
+            case DW_FORM_ref_addr:
+                // DWARF 2 sized these like addresses
+                attr.value = ReadUnsigned(cursor, unit.version <= 2 ? unit.addr_size : unit.offset_size);
+                break;
+            case DW_FORM_flag_present:  attr.value = 1; break;
+            case DW_FORM_implicit_const: attr.value = static_cast<uint64_t>(implicit_const); break;
+            case DW_FORM_string:
+                attr.block = cursor.pos;
+                ReadString(cursor);
+                break;
+            case DW_FORM_block1:
+            case DW_FORM_block2:
+            case DW_FORM_block4:
+            case DW_FORM_block:
+            case DW_FORM_exprloc: {
+                uint64_t size = 0;
+                if (form == DW_FORM_block1) {
+                    size = ReadUnsigned(cursor, 1);
+                } else if (form == DW_FORM_block2) {
+                    size = ReadUnsigned(cursor, 2);
+                } else if (form == DW_FORM_block4) {
+                    size = ReadUnsigned(cursor, 4);
+                } else {
+                    size = ReadUleb(cursor);
+                }
+                attr.block = cursor.pos;
+                attr.block_size = size;
+                Skip(cursor, size);
+                break;
+            }
+            case DW_FORM_indirect: {
+                uint64_t const actual = ReadUleb(cursor);
+                if (actual == DW_FORM_indirect || actual == DW_FORM_implicit_const) {
+                    return false;
+                }
+                return ReadAttr(cursor, unit, actual, 0, attr);
+            }
+            default:
+                return false;   // Unknown form, the rest of the unit cannot be parsed
+        }
+        if (form == DW_FORM_ref1 || form == DW_FORM_ref2 || form == DW_FORM_ref4 || form == DW_FORM_ref8 ||
+            form == DW_FORM_ref_udata) {
+            attr.value += unit.offset;   // Unit relative to absolute
+        }
+        return cursor.ok;
+    }
+
+    const char* AttrString(const Dwarf& dwarf, const Unit& unit, const AttrValue& attr) {
+        switch (attr.form) {
+            case DW_FORM_string:
+                return reinterpret_cast<const char*>(attr.block);
+            case DW_FORM_strp:
+                return StringAt(dwarf.str, attr.value);
+            case DW_FORM_line_strp:
+                return StringAt(dwarf.line_str, attr.value);
+            case DW_FORM_strx:
+            case DW_FORM_strx1:
+            case DW_FORM_strx2:
+            case DW_FORM_strx3:
+            case DW_FORM_strx4:
+            case DW_FORM_GNU_str_index: {
+                Cursor offsets = MakeCursor(dwarf.str_offsets, unit.str_offsets_base + attr.value * unit.offset_size,
+                                            dwarf.big_endian);
+                uint64_t const offset = ReadUnsigned(offsets, unit.offset_size);
+                return offsets.ok ? StringAt(dwarf.str, offset) : "";
+            }
+            default:
+                return "";
+        }
+    }
+
+    uint64_t AddressAt(const Dwarf& dwarf, const Unit& unit, uint64_t index, bool& ok) {
+        Cursor addresses = MakeCursor(dwarf.addr, unit.addr_base + index * unit.addr_size, dwarf.big_endian);
+        uint64_t const address = ReadUnsigned(addresses, unit.addr_size);
+        ok = addresses.ok;
+        return address;
+    }
+
+    /*
+     * Static storage addresses are a single DW_OP_addr (or its indexed form),
+     * optionally followed by DW_OP_plus_uconst. Anything else lives on the
+     * stack, in registers or in thread local storage.
+     */
+    bool ReadLocation(const Dwarf& dwarf, const Unit& unit, const AttrValue& attr, uint64_t& address) {
+        if (attr.block == nullptr || attr.form == DW_FORM_string || attr.block_size == 0) {
+            return false;
+        }
+        Cursor expr = {attr.block, attr.block + attr.block_size, dwarf.big_endian, true};
+        uint8_t const op = static_cast<uint8_t>(ReadUnsigned(expr, 1));
+        bool ok = true;
+        if (op == DW_OP_addr) {
+            address = ReadUnsigned(expr, unit.addr_size);
+        } else if (op == DW_OP_addrx || op == DW_OP_GNU_addr_index) {
+            address = AddressAt(dwarf, unit, ReadUleb(expr), ok);
+        } else {
+            return false;
+        }
+        if (expr.ok && expr.pos < expr.end && *expr.pos == DW_OP_plus_uconst) {
+            Skip(expr, 1);
+            address += ReadUleb(expr);
+        }
+        return ok && expr.ok && expr.pos == expr.end;
+    }
+
+    void ParseAbbrevs(const Dwarf& dwarf, uint64_t offset, std::vector<Abbrev>& abbrevs) {
+        Cursor cursor = MakeCursor(dwarf.abbrev, offset, dwarf.big_endian);
+        while (cursor.ok) {
+            uint64_t const code = ReadUleb(cursor);
+            if (code == 0 || code > 1000000) {
+                break;
+            }
+            Abbrev abbrev;
+            abbrev.tag = ReadUleb(cursor);
+            abbrev.has_children = ReadUnsigned(cursor, 1) != 0;
+            while (cursor.ok) {
+                AttrSpec spec = {ReadUleb(cursor), ReadUleb(cursor), 0};
+                if (spec.name == 0 && spec.form == 0) {
+                    break;
+                }
+                if (spec.form == DW_FORM_implicit_const) {
+                    spec.implicit_const = ReadSleb(cursor);
+                }
+                abbrev.attributes.push_back(spec);
+            }
+            if (abbrevs.size() <= code) {
+                abbrevs.resize(code + 1);
+            }
+            abbrevs[code] = std::move(abbrev);
+        }
+    }
+
+    /*
+     * Reads the file table from the header of a line number program. Entries
+     * are stored at the index DW_AT_decl_file uses, which is 1-based before
+     * DWARF 5 and 0-based from it.
+     */
+    std::vector<std::string> ParseLineFiles(const Dwarf& dwarf, const Unit& unit, uint64_t offset) {
+        std::vector<std::string> files;
+        Cursor cursor = MakeCursor(dwarf.line, offset, dwarf.big_endian);
+        Unit line_unit = unit;
+        line_unit.offset_size = 4;
+        uint64_t length = ReadUnsigned(cursor, 4);
+        if (length == 0xFFFFFFFF) {
+            line_unit.offset_size = 8;
+            length = ReadUnsigned(cursor, 8);
+        }
+        if (!cursor.ok || length > static_cast<uint64_t>(cursor.end - cursor.pos)) {
+            return files;
+        }
+        cursor.end = cursor.pos + length;
+        line_unit.version = static_cast<uint16_t>(ReadUnsigned(cursor, 2));
+        if (line_unit.version >= 5) {
+            line_unit.addr_size = static_cast<uint8_t>(ReadUnsigned(cursor, 1));
+            Skip(cursor, 1);   // segment_selector_size
+        }
+        Skip(cursor, line_unit.offset_size);   // header_length
+        Skip(cursor, line_unit.version >= 4 ? 4 : 3);   // Instruction lengths, default_is_stmt, line_base
+        Skip(cursor, 1);   // line_range
+        uint64_t const opcode_base = ReadUnsigned(cursor, 1);
+        Skip(cursor, opcode_base > 0 ? opcode_base - 1 : 0);
+
+        if (line_unit.version < 5) {
+            while (cursor.ok && ReadString(cursor)[0] != '\0') {
+                // include_directories are not needed for the file name
+            }
+            files.emplace_back();
+            while (cursor.ok) {
+                const char* name = ReadString(cursor);
+                if (name[0] == '\0') {
+                    break;
+                }
+                ReadUleb(cursor);   // Directory index
+                ReadUleb(cursor);   // Modification time
+                ReadUleb(cursor);   // File length
+                files.push_back(BaseName(name));
+            }
+            return files;
+        }
+
+        for (int table = 0; table < 2 && cursor.ok; table++) {
+            // Directory table first, then the file table, both self describing
+            uint64_t const format_count = ReadUnsigned(cursor, 1);
+            std::vector<std::pair<uint64_t, uint64_t>> format(format_count);
+            for (auto& [content, form] : format) {
+                content = ReadUleb(cursor);
+                form = ReadUleb(cursor);
+            }
+            uint64_t const count = ReadUleb(cursor);
+            for (uint64_t i = 0; i < count && cursor.ok; i++) {
+                std::string name;
+                for (const auto& [content, form] : format) {
+                    AttrValue attr;
+                    if (!ReadAttr(cursor, line_unit, form, 0, attr)) {
+                        return files;
+                    }
+                    if (content == DW_LNCT_path) {
+                        name = BaseName(AttrString(dwarf, line_unit, attr));
+                    }
+                }
+                if (table == 1) {
+                    files.push_back(name);
+                }
+            }
+        }
+        return files;
+    }
+
+    VariableType BaseType(const TypeDie& type) {
+        switch (type.encoding) {
+            case DW_ATE_boolean:
+                return type.byte_size == 1 ? TYPE_BOOL : TYPE_UNKNOWN;
+            case DW_ATE_float:
+                return type.byte_size == 4 ? TYPE_FLOAT : (type.byte_size == 8 ? TYPE_DOUBLE : TYPE_UNKNOWN);
+            case DW_ATE_signed_char:
+            case DW_ATE_unsigned_char:
+                if (type.byte_size != 1) {
+                    return TYPE_UNKNOWN;
+                }
+                // Plain char is its own type, int8_t and uint8_t are the explicitly signed ones
+                if (std::strcmp(type.name, "char") == 0) {
+                    return TYPE_CHAR;
+                }
+                return type.encoding == DW_ATE_signed_char ? TYPE_INT8 : TYPE_UINT8;
+            case DW_ATE_signed:
+                switch (type.byte_size) {
+                    case 1: return TYPE_INT8;
+                    case 2: return TYPE_INT16;
+                    case 4: return TYPE_INT32;
+                    default: return TYPE_UNKNOWN;
+                }
+            case DW_ATE_unsigned:
+            case DW_ATE_UTF:
+                switch (type.byte_size) {
+                    case 1: return TYPE_UINT8;
+                    case 2: return TYPE_UINT16;
+                    case 4: return TYPE_UINT32;
+                    default: return TYPE_UNKNOWN;
+                }
+            default:
+                return TYPE_UNKNOWN;
+        }
+    }
+
+    /*
+     * Follows typedefs and qualifiers down to something with a loggable value.
+     * Enums without an underlying type and pointers are logged as unsigned
+     * integers of their size.
+     */
+    VariableType ResolveType(const DwarfIndex& index, uint64_t offset) {
+        for (int depth = 0; depth < 32 && offset != 0; depth++) {
+            auto it = index.types.find(offset);
+            if (it == index.types.end()) {
+                return TYPE_UNKNOWN;
+            }
+            const TypeDie& type = it->second;
+            switch (type.tag) {
+                case DW_TAG_typedef:
+                case DW_TAG_const_type:
+                case DW_TAG_volatile_type:
+                case DW_TAG_restrict_type:
+                case DW_TAG_atomic_type:
+                    offset = type.type;
+                    break;
+                case DW_TAG_base_type:
+                    return BaseType(type);
+                case DW_TAG_enumeration_type:
+                    if (type.type != 0) {
+                        offset = type.type;
+                        break;
+                    }
+                    [[fallthrough]];
+                case DW_TAG_pointer_type: {
+                    TypeDie const as_unsigned = {DW_TAG_base_type, type.byte_size, DW_ATE_unsigned, 0, ""};
+                    return BaseType(as_unsigned);
+                }
+                default:
+                    return TYPE_UNKNOWN;
+            }
+        }
+        return TYPE_UNKNOWN;
+    }
+
+    bool IsTypeTag(uint64_t tag) {
+        return tag == DW_TAG_base_type || tag == DW_TAG_typedef || tag == DW_TAG_const_type ||
+               tag == DW_TAG_volatile_type || tag == DW_TAG_restrict_type || tag == DW_TAG_atomic_type ||
+               tag == DW_TAG_enumeration_type || tag == DW_TAG_pointer_type || tag == DW_TAG_structure_type ||
+               tag == DW_TAG_union_type || tag == DW_TAG_class_type || tag == DW_TAG_array_type;
+    }
+
+    bool IsQualifier(uint64_t tag) {
+        return tag == DW_TAG_typedef || tag == DW_TAG_const_type || tag == DW_TAG_volatile_type ||
+               tag == DW_TAG_restrict_type || tag == DW_TAG_atomic_type;
+    }
+
+    // DWARF 2 encoded member offsets as a DW_OP_plus_uconst expression
+    uint64_t ReadMemberLocation(const Dwarf& dwarf, const AttrValue& attr) {
+        if (attr.block == nullptr || attr.form == DW_FORM_string) {
+            return attr.value;
+        }
+        Cursor expr = {attr.block, attr.block + attr.block_size, dwarf.big_endian, true};
+        if (ReadUnsigned(expr, 1) != DW_OP_plus_uconst) {
+            return 0;
+        }
+        return ReadUleb(expr);
+    }
+
+    /*
+     * Walks every unit of .debug_info once, collecting the variables with a
+     * static address and the type DIEs needed to resolve them.
+     */
+    void IndexDwarf(const Dwarf& dwarf, DwarfIndex& index) {
+        std::unordered_map<uint64_t, std::vector<Abbrev>> abbrev_tables;
+        std::unordered_map<uint64_t, std::vector<std::string>> line_files;
+        std::vector<std::pair<uint64_t, AttrValue>> attributes;
+
+        Cursor units = MakeCursor(dwarf.info, 0, dwarf.big_endian);
+        while (units.ok && units.pos < units.end) {
+            Unit unit = {static_cast<uint64_t>(units.pos - dwarf.info.data), 0, 4, 4, 8, 8};
+            uint64_t length = ReadUnsigned(units, 4);
+            if (length == 0xFFFFFFFF) {
+                unit.offset_size = 8;
+                length = ReadUnsigned(units, 8);
+            }
+            if (!units.ok || length > static_cast<uint64_t>(units.end - units.pos)) {
+                break;
+            }
+            Cursor cursor = units;
+            cursor.end = cursor.pos + length;
+            Skip(units, length);
+
+            unit.version = static_cast<uint16_t>(ReadUnsigned(cursor, 2));
+            uint64_t abbrev_offset = 0;
+            if (unit.version >= 5) {
+                uint8_t const unit_type = static_cast<uint8_t>(ReadUnsigned(cursor, 1));
+                unit.addr_size = static_cast<uint8_t>(ReadUnsigned(cursor, 1));
+                abbrev_offset = ReadUnsigned(cursor, unit.offset_size);
+                if (unit_type == DW_UT_skeleton || unit_type == DW_UT_split_compile) {
+                    Skip(cursor, 8);   // dwo_id
+                } else if (unit_type == DW_UT_type || unit_type == DW_UT_split_type) {
+                    Skip(cursor, 8 + unit.offset_size);   // type_signature, type_offset
+                }
+            } else {
+                abbrev_offset = ReadUnsigned(cursor, unit.offset_size);
+                unit.addr_size = static_cast<uint8_t>(ReadUnsigned(cursor, 1));
+            }
+            if (!cursor.ok || unit.version < 2 || unit.version > 5 || unit.addr_size == 0 || unit.addr_size > 8) {
+                continue;
+            }
+            auto [abbrev_it, inserted] = abbrev_tables.try_emplace(abbrev_offset);
+            if (inserted) {
+                ParseAbbrevs(dwarf, abbrev_offset, abbrev_it->second);
+            }
+            const std::vector<Abbrev>& abbrevs = abbrev_it->second;
+
+            const std::vector<std::string>* files = nullptr;
+            std::string unit_file;
+            bool first_die = true;
+            std::vector<uint64_t> parents;
+            while (cursor.ok && cursor.pos < cursor.end) {
+                uint64_t const die_offset = static_cast<uint64_t>(cursor.pos - dwarf.info.data);
+                uint64_t const code = ReadUleb(cursor);
+                if (code == 0) {
+                    // End of a sibling list
+                    if (!parents.empty()) {
+                        parents.pop_back();
+                    }
+                    continue;
+                }
+                if (code >= abbrevs.size() || abbrevs[code].tag == 0) {
+                    break;   // Corrupt or unsupported, skip the rest of this unit
+                }
+                const Abbrev& abbrev = abbrevs[code];
+                attributes.clear();
+                bool ok = true;
+                for (const auto& spec : abbrev.attributes) {
+                    AttrValue attr;
+                    if (!ReadAttr(cursor, unit, spec.form, spec.implicit_const, attr)) {
+                        ok = false;
+                        break;
+                    }
+                    attributes.emplace_back(spec.name, attr);
+                }
+                if (!ok) {
+                    break;
+                }
+                uint64_t const parent = parents.empty() ? 0 : parents.back();
+                if (abbrev.has_children) {
+                    parents.push_back(die_offset);
+                }
+
+                if (first_die) {
+                    first_die = false;
+                    // Bases first, string and address attributes of this DIE may depend on them
+                    for (const auto& [name, attr] : attributes) {
+                        if (name == DW_AT_str_offsets_base) {
+                            unit.str_offsets_base = attr.value;
+                        } else if (name == DW_AT_addr_base || name == DW_AT_GNU_addr_base) {
+                            unit.addr_base = attr.value;
+                        }
+                    }
+                    if (abbrev.tag == DW_TAG_compile_unit || abbrev.tag == DW_TAG_partial_unit ||
+                        abbrev.tag == DW_TAG_skeleton_unit) {
+                        for (const auto& [name, attr] : attributes) {
+                            if (name == DW_AT_name) {
+                                unit_file = BaseName(AttrString(dwarf, unit, attr));
+                            } else if (name == DW_AT_stmt_list) {
+                                auto [files_it, parsed] = line_files.try_emplace(attr.value);
+                                if (parsed) {
+                                    files_it->second = ParseLineFiles(dwarf, unit, attr.value);
+                                }
+                                files = &files_it->second;
+                            }
+                        }
+                    }
+                }
+
+                if (IsTypeTag(abbrev.tag)) {
+                    TypeDie type = {abbrev.tag, 0, 0, 0, ""};
+                    for (const auto& [name, attr] : attributes) {
+                        if (name == DW_AT_byte_size) {
+                            type.byte_size = attr.value;
+                        } else if (name == DW_AT_encoding) {
+                            type.encoding = attr.value;
+                        } else if (name == DW_AT_type && IsReference(attr.form)) {
+                            type.type = attr.value;
+                        } else if (name == DW_AT_name) {
+                            type.name = AttrString(dwarf, unit, attr);
+                        }
+                    }
+                    index.types[die_offset] = type;
+                } else if (abbrev.tag == DW_TAG_member) {
+                    MemberDie member = {"", 0, 0, 0, 0, 0, false};
+                    for (const auto& [name, attr] : attributes) {
+                        if (name == DW_AT_name) {
+                            member.name = AttrString(dwarf, unit, attr);
+                        } else if (name == DW_AT_type && IsReference(attr.form)) {
+                            member.type = attr.value;
+                        } else if (name == DW_AT_data_member_location) {
+                            member.location = ReadMemberLocation(dwarf, attr);
+                        } else if (name == DW_AT_byte_size) {
+                            member.byte_size = attr.value;
+                        } else if (name == DW_AT_bit_size) {
+                            member.bit_size = attr.value;
+                        } else if (name == DW_AT_data_bit_offset) {
+                            member.bit_offset = attr.value;
+                            member.data_bit_offset = true;
+                        } else if (name == DW_AT_bit_offset) {
+                            member.bit_offset = attr.value;
+                        }
+                    }
+                    index.members[parent].push_back(member);
+                } else if (abbrev.tag == DW_TAG_subrange_type) {
+                    uint64_t count = 0;
+                    uint64_t lower_bound = 0;
+                    for (const auto& [name, attr] : attributes) {
+                        // References are runtime bounds, those arrays are left unexpanded
+                        if (IsReference(attr.form) || attr.block != nullptr) {
+                            continue;
+                        }
+                        if (name == DW_AT_count) {
+                            count = attr.value;
+                        } else if (name == DW_AT_lower_bound) {
+                            lower_bound = attr.value;
+                        } else if (name == DW_AT_upper_bound && static_cast<int64_t>(attr.value) >= 0) {
+                            count = attr.value - lower_bound + 1;
+                        }
+                    }
+                    index.dimensions[parent].push_back(count);
+                } else if (abbrev.tag == DW_TAG_variable) {
+                    VariableDie variable = {nullptr, "", 0, 0, 0, false};
+                    for (const auto& [name, attr] : attributes) {
+                        if (name == DW_AT_name) {
+                            variable.name = AttrString(dwarf, unit, attr);
+                        } else if (name == DW_AT_type && IsReference(attr.form)) {
+                            variable.type = attr.value;
+                        } else if ((name == DW_AT_specification || name == DW_AT_abstract_origin) &&
+                                   IsReference(attr.form)) {
+                            variable.specification = attr.value;
+                        } else if (name == DW_AT_location) {
+                            variable.has_address = ReadLocation(dwarf, unit, attr, variable.address);
+                        } else if (name == DW_AT_decl_file) {
+                            if (files != nullptr && attr.value < files->size() && !(*files)[attr.value].empty()) {
+                                variable.file = (*files)[attr.value];
+                            }
+                        }
+                    }
+                    if (variable.file.empty() && variable.specification == 0) {
+                        variable.file = unit_file;
+                    }
+                    index.variable_index[die_offset] = index.variables.size();
+                    index.variables.push_back(std::move(variable));
+                }
+            }
+        }
+    }
+
+    // Fills what a definition leaves to its declaration, e.g. globals declared extern in a header
+    void ResolveSpecifications(DwarfIndex& index) {
+        for (auto& variable : index.variables) {
+            uint64_t specification = variable.specification;
+            for (int depth = 0; depth < 8 && specification != 0; depth++) {
+                auto it = index.variable_index.find(specification);
+                if (it == index.variable_index.end()) {
+                    break;
+                }
+                const VariableDie& declaration = index.variables[it->second];
+                if (variable.name == nullptr) {
+                    variable.name = declaration.name;
+                }
+                if (variable.type == 0) {
+                    variable.type = declaration.type;
+                }
+                if (variable.file.empty()) {
+                    variable.file = declaration.file;
+                }
+                specification = declaration.specification;
+            }
+        }
+    }
+
+    uint64_t SizeOf(const DwarfIndex& index, uint64_t offset) {
+        for (int depth = 0; depth < 32 && offset != 0; depth++) {
+            auto it = index.types.find(offset);
+            if (it == index.types.end()) {
+                return 0;
+            }
+            const TypeDie& type = it->second;
+            if (type.byte_size != 0) {
+                return type.byte_size;
+            }
+            if (type.tag == DW_TAG_array_type) {
+                auto dims = index.dimensions.find(offset);
+                uint64_t elements = 1;
+                if (dims == index.dimensions.end()) {
+                    return 0;
+                }
+                for (uint64_t count : dims->second) {
+                    elements *= count;
+                }
+                return elements * SizeOf(index, type.type);
+            }
+            if (!IsQualifier(type.tag)) {
+                return 0;
+            }
+            offset = type.type;
+        }
+        return 0;
+    }
+
+    uint64_t StripQualifiers(const DwarfIndex& index, uint64_t offset) {
+        for (int depth = 0; depth < 32 && offset != 0; depth++) {
+            auto it = index.types.find(offset);
+            if (it == index.types.end() || !IsQualifier(it->second.tag)) {
+                return offset;
+            }
+            offset = it->second.type;
+        }
+        return offset;
+    }
+
+    // Nesting and leaf limits, a huge buffer should not swamp the variable table
+    const int    kMaxNesting = 16;
+    const size_t kMaxLeavesPerSymbol = 1 << 16;
+
+    typedef struct {
+        const DwarfIndex*       index;
+        std::vector<ElfSymbol>* out;
+        const std::string*      file;
+        size_t                  leaves_left;
+    } Expansion;
+
+    void Expand(Expansion& expansion, uint64_t type_offset, const std::string& name, uint64_t address,
+                uint64_t size, int depth);
+
+    void ExpandBitfield(Expansion& expansion, const MemberDie& member, const std::string& name, uint64_t address) {
+        // Bit position from the start of the parent, numbered from the LSB of its first byte
+        uint64_t bit = member.bit_offset;
+        if (!member.data_bit_offset) {
+            uint64_t const storage = member.byte_size != 0 ? member.byte_size : SizeOf(*expansion.index, member.type);
+            bit = member.location * 8 + storage * 8 - member.bit_offset - member.bit_size;
+        }
+        uint64_t const first_byte = bit / 8;
+        uint64_t const last_byte = (bit + member.bit_size - 1) / 8;
+        uint64_t size = last_byte - first_byte + 1;
+        size = size == 3 ? 4 : size;
+        if (member.bit_size > 32 || size > 4) {
+            return;
+        }
+        expansion.leaves_left--;
+        expansion.out->push_back({name, address + first_byte, size, static_cast<uint8_t>(bit - first_byte * 8),
+                                  static_cast<uint8_t>(member.bit_size), *expansion.file,
+                                  ResolveType(*expansion.index, member.type)});
+    }
+
+    void ExpandArray(Expansion& expansion, uint64_t element_type, const std::vector<uint64_t>& dims, size_t dim,
+                     const std::string& name, uint64_t address, int depth) {
+        uint64_t const element_size = SizeOf(*expansion.index, element_type);
+        uint64_t stride = element_size;
+        for (size_t i = dim + 1; i < dims.size(); i++) {
+            stride *= dims[i];
+        }
+        if (stride == 0) {
+            return;
+        }
+        for (uint64_t i = 0; i < dims[dim] && expansion.leaves_left > 0; i++) {
+            std::string const element = name + "[" + std::to_string(i) + "]";
+            if (dim + 1 < dims.size()) {
+                ExpandArray(expansion, element_type, dims, dim + 1, element, address + i * stride, depth);
+            } else {
+                Expand(expansion, element_type, element, address + i * stride, element_size, depth + 1);
+            }
+        }
+    }
+
+    /*
+     * Emits one leaf per scalar reachable from the type. Members and elements
+     * are named like the C expression accessing them.
+     */
+    void Expand(Expansion& expansion, uint64_t type_offset, const std::string& name, uint64_t address,
+                uint64_t size, int depth) {
+        if (expansion.leaves_left == 0) {
+            return;
+        }
+        const DwarfIndex& index = *expansion.index;
+        uint64_t const offset = StripQualifiers(index, type_offset);
+        auto type = index.types.find(offset);
+        if (type != index.types.end() && depth < kMaxNesting) {
+            uint64_t const tag = type->second.tag;
+            auto members = index.members.find(offset);
+            if ((tag == DW_TAG_structure_type || tag == DW_TAG_union_type || tag == DW_TAG_class_type) &&
+                members != index.members.end()) {
+                for (const auto& member : members->second) {
+                    if (expansion.leaves_left == 0) {
+                        break;
+                    }
+                    // Members of anonymous structs and unions are accessed as members of the parent
+                    std::string const child = member.name[0] == '\0' ? name : name + "." + member.name;
+                    if (member.bit_size != 0) {
+                        ExpandBitfield(expansion, member, child, address);
+                    } else {
+                        Expand(expansion, member.type, child, address + member.location,
+                               SizeOf(index, member.type), depth + 1);
+                    }
+                }
+                return;
+            }
+            auto dims = index.dimensions.find(offset);
+            if (tag == DW_TAG_array_type && dims != index.dimensions.end() && !dims->second.empty()) {
+                ExpandArray(expansion, type->second.type, dims->second, 0, name, address, depth);
+                return;
+            }
+        }
+        if (size == 0) {
+            return;
+        }
+        expansion.leaves_left--;
+        expansion.out->push_back({name, address, size, 0, 0, *expansion.file, ResolveType(index, offset)});
+    }
+
+    void ResolveSymbols(const ElfFile& elf, std::vector<ElfSymbol>& symbols) {
+        Dwarf const dwarf = {
+            .info = GetSection(elf, ".debug_info"),
+            .abbrev = GetSection(elf, ".debug_abbrev"),
+            .str = GetSection(elf, ".debug_str"),
+            .line_str = GetSection(elf, ".debug_line_str"),
+            .line = GetSection(elf, ".debug_line"),
+            .str_offsets = GetSection(elf, ".debug_str_offsets"),
+            .addr = GetSection(elf, ".debug_addr"),
+            .big_endian = elf.big_endian,
+        };
+        if (dwarf.info.data == nullptr || dwarf.abbrev.data == nullptr) {
+            return;
+        }
+
+        DwarfIndex index;
+        IndexDwarf(dwarf, index);
+        ResolveSpecifications(index);
+
+        std::unordered_multimap<uint64_t, const VariableDie*> by_address;
+        for (const auto& variable : index.variables) {
+            if (variable.has_address) {
+                by_address.emplace(variable.address, &variable);
+            }
+        }
+
+        std::vector<ElfSymbol> leaves;
+        leaves.reserve(symbols.size());
+        for (auto& symbol : symbols) {
+            auto [first, last] = by_address.equal_range(symbol.address);
+            const VariableDie* match = nullptr;
+            for (auto it = first; it != last; ++it) {
+                // Aliases share an address, prefer the one with the same name
+                if (match == nullptr || (it->second->name != nullptr && symbol.name == it->second->name)) {
+                    match = it->second;
+                }
+            }
+            if (match == nullptr) {
+                leaves.push_back(symbol);
+                continue;
+            }
+            Expansion expansion = {&index, &leaves, &match->file, kMaxLeavesPerSymbol};
+            size_t const before = leaves.size();
+            Expand(expansion, match->type, symbol.name, symbol.address, symbol.size, 0);
+            if (leaves.size() == before) {
+                // Nothing loggable inside, e.g. a zero length array, keep the symbol as a whole
+                symbol.file = match->file;
+                leaves.push_back(symbol);
+            } else if (expansion.leaves_left == 0) {
+                serial_front::AddLog("%s %s has more than %zu members, only the first are listed\n", INFO_CHAR,
+                                     symbol.name.c_str(), kMaxLeavesPerSymbol);
+            }
+        }
+        symbols.swap(leaves);
+    }
+
+    std::string ToHex(const uint8_t* data, size_t size) {
+        static const char digits[] = "0123456789abcdef";
+        std::string hex;
+        hex.reserve(size * 2);
+        for (size_t i = 0; i < size; i++) {
+            hex += digits[data[i] >> 4];
+            hex += digits[data[i] & 0x0F];
+        }
+        return hex;
+    }
+
+    std::string ReadBuildId(const ElfFile& elf) {
+        for (const auto& section : elf.sections) {
+            if (section.type != kSectionNote) {
+                continue;
+            }
+            Section const notes = {elf.file.data + section.offset, static_cast<size_t>(section.size)};
+            Cursor cursor = MakeCursor(notes, 0, elf.big_endian);
+            while (cursor.ok && cursor.pos < cursor.end) {
+                uint64_t const name_size = ReadUnsigned(cursor, 4);
+                uint64_t const desc_size = ReadUnsigned(cursor, 4);
+                uint64_t const type = ReadUnsigned(cursor, 4);
+                const uint8_t* name = cursor.pos;
+                Skip(cursor, (name_size + 3) & ~static_cast<uint64_t>(3));
+                const uint8_t* desc = cursor.pos;
+                Skip(cursor, (desc_size + 3) & ~static_cast<uint64_t>(3));
+                if (cursor.ok && type == kNoteGnuBuildId && name_size == 4 && std::memcmp(name, "GNU", 4) == 0 &&
+                    desc_size > 0) {
+                    return ToHex(desc, static_cast<size_t>(desc_size));
+                }
+            }
+        }
+        return "";
+    }
+
+    // FNV-1a, only used to tell builds apart
+    uint64_t HashContent(const uint8_t* data, size_t size) {
+        uint64_t hash = 0xCBF29CE484222325ULL;
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ data[i]) * 0x100000001B3ULL;
+        }
+        return hash;
+    }
+} // namespace anonymous
+
+namespace elf_reader {
+    bool ReadDataSymbols(const std::string& path, std::vector<ElfSymbol>& symbols) {
+        symbols.clear();
+        ElfFile elf = {};
+        if (!mapped_file::Open(elf.file, path)) {
+            serial_front::AddLog("%s ERROR: Could not open ELF file %s\n", ERROR_CHAR, path.c_str());
+            return false;
+        }
+        if (!ReadSectionHeaders(elf)) {
+            serial_front::AddLog("%s ERROR: %s is not a valid ELF file\n", ERROR_CHAR, path.c_str());
+            mapped_file::Close(elf.file);
+            return false;
+        }
+
+        ReadSymbols(elf, symbols);
+        ResolveSymbols(elf, symbols);
+        mapped_file::Close(elf.file);
+
+        std::sort(symbols.begin(), symbols.end(),
+                  [](const ElfSymbol& a, const ElfSymbol& b) { return a.address < b.address; });
+        return true;
+    }
+
+    std::string GetBuildKey(const std::string& path) {
+        ElfFile elf = {};
+        if (!mapped_file::Open(elf.file, path)) {
+            return "";
+        }
+        std::string key;
+        if (ReadSectionHeaders(elf)) {
+            std::string const build_id = ReadBuildId(elf);
+            if (!build_id.empty()) {
+                key = "gnu-" + build_id;
+            }
+        }
+        if (key.empty()) {
+            uint64_t hash = HashContent(elf.file.data, elf.file.size);
+            uint8_t bytes[sizeof(hash)];
+            for (uint8_t& byte : bytes) {
+                byte = static_cast<uint8_t>(hash >> 56);
+                hash <<= 8;
+            }
+            key = "fnv-" + ToHex(bytes, sizeof(bytes));
+        }
+        mapped_file::Close(elf.file);
+        return key;
+    }
+} // namespace elf_reader
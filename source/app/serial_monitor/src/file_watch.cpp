@@ -0,0 +1,243 @@
+#include "file_watch.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#endif
+
+namespace {
+    // Polling fallback, a change is reported once the time is the same on two polls
+    const int kPollIntervalMs = 1000;
+    // Windows only, writes closer together than this belong to the same link
+    const int kSettleMs = 100;
+
+    std::filesystem::file_time_type WriteTime(const std::string& path) {
+        std::error_code error;
+        std::filesystem::file_time_type const time = std::filesystem::last_write_time(path, error);
+        return error ? std::filesystem::file_time_type::min() : time;
+    }
+
+    std::string WatchedDirectory(const std::string& path) {
+        std::filesystem::path const parent = std::filesystem::path(path).parent_path();
+        return parent.empty() ? "." : parent.string();
+    }
+
+    // Reports a time not reported before, a missing file is never a change
+    bool TimeChanged(FileWatch& watch) {
+        std::filesystem::file_time_type const time = WriteTime(watch.path);
+        if (time == std::filesystem::file_time_type::min() || time == watch.last_write_time) {
+            return false;
+        }
+        watch.last_write_time = time;
+        return true;
+    }
+
+    bool PollChanged(FileWatch& watch) {
+        std::filesystem::file_time_type const time = WriteTime(watch.path);
+        bool const settled = time == watch.polled_write_time;
+        watch.polled_write_time = time;
+        return settled && TimeChanged(watch);
+    }
+
+#ifdef _WIN32
+    // The linker holds the file open while writing, it cannot be opened without sharing until done
+    bool WriteDone(const std::string& path) {
+        HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, 0, nullptr, OPEN_EXISTING,
+                                    FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (handle == INVALID_HANDLE_VALUE) {
+            return GetLastError() != ERROR_SHARING_VIOLATION;
+        }
+        CloseHandle(handle);
+        return true;
+    }
+#else
+    // True when the watched name was written and closed, or moved in place
+    bool DrainEvents(FileWatch& watch) {
+        bool changed = false;
+#ifdef __linux__
+        alignas(inotify_event) char buffer[4096];
+        while (true) {
+            ssize_t const length = read(watch.notify_fd, buffer, sizeof(buffer));
+            if (length <= 0) {
+                break;
+            }
+            for (ssize_t offset = 0; offset < length;) {
+                const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                if ((event->mask & IN_Q_OVERFLOW) != 0 ||
+                    (event->len > 0 && watch.name == event->name)) {
+                    changed = true;
+                }
+                offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+            }
+        }
+#else
+        (void)watch;
+#endif
+        return changed;
+    }
+#endif
+} // namespace anonymous
+
+namespace file_watch {
+#ifdef _WIN32
+    bool Open(FileWatch& watch) {
+        watch = {};
+        watch.wake_handle = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+        return watch.wake_handle != nullptr;
+    }
+
+    void Close(FileWatch& watch) {
+        if (watch.change_handle != nullptr) {
+            FindCloseChangeNotification(static_cast<HANDLE>(watch.change_handle));
+        }
+        if (watch.wake_handle != nullptr) {
+            CloseHandle(static_cast<HANDLE>(watch.wake_handle));
+        }
+        watch = {};
+    }
+
+    void SetPath(FileWatch& watch, const std::string& path) {
+        if (watch.change_handle != nullptr) {
+            FindCloseChangeNotification(static_cast<HANDLE>(watch.change_handle));
+            watch.change_handle = nullptr;
+        }
+        watch.path              = path;
+        watch.name              = std::filesystem::path(path).filename().string();
+        watch.last_write_time   = WriteTime(path);
+        watch.polled_write_time = watch.last_write_time;
+        watch.polling           = false;
+        if (path.empty()) {
+            return;
+        }
+        HANDLE change = FindFirstChangeNotificationA(WatchedDirectory(path).c_str(), FALSE,
+                                                     FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE);
+        if (change == INVALID_HANDLE_VALUE) {
+            watch.polling = true;
+        } else {
+            watch.change_handle = change;
+        }
+    }
+
+    bool Wait(FileWatch& watch) {
+        while (true) {
+            HANDLE handles[2] = {static_cast<HANDLE>(watch.wake_handle), static_cast<HANDLE>(watch.change_handle)};
+            DWORD const count = watch.change_handle != nullptr ? 2 : 1;
+            DWORD const timeout = watch.polling ? static_cast<DWORD>(kPollIntervalMs) : INFINITE;
+            DWORD const result = WaitForMultipleObjects(count, handles, FALSE, timeout);
+            if (result == WAIT_OBJECT_0) {
+                return false;
+            }
+            if (result == WAIT_OBJECT_0 + 1) {
+                // Notifications do not say which file changed, nor that writing is done
+                do {
+                    FindNextChangeNotification(handles[1]);
+                } while (WaitForSingleObject(handles[1], kSettleMs) == WAIT_OBJECT_0 || !WriteDone(watch.path));
+                if (TimeChanged(watch)) {
+                    return true;
+                }
+            } else if (result == WAIT_TIMEOUT) {
+                if (PollChanged(watch)) {
+                    return true;
+                }
+            } else {
+                return false;
+            }
+        }
+    }
+
+    void Wake(FileWatch& watch) {
+        SetEvent(static_cast<HANDLE>(watch.wake_handle));
+    }
+#else
+    bool Open(FileWatch& watch) {
+        watch = {};
+        watch.notify_fd = -1;
+        if (pipe(watch.wake_fds) != 0) {
+            watch.wake_fds[0] = -1;
+            watch.wake_fds[1] = -1;
+            return false;
+        }
+        fcntl(watch.wake_fds[0], F_SETFL, O_NONBLOCK);
+        fcntl(watch.wake_fds[1], F_SETFL, O_NONBLOCK);
+        return true;
+    }
+
+    void Close(FileWatch& watch) {
+        if (watch.notify_fd >= 0) {
+            close(watch.notify_fd);
+        }
+        if (watch.wake_fds[0] >= 0) {
+            close(watch.wake_fds[0]);
+            close(watch.wake_fds[1]);
+        }
+        watch = {};
+        watch.notify_fd = -1;
+        watch.wake_fds[0] = -1;
+        watch.wake_fds[1] = -1;
+    }
+
+    void SetPath(FileWatch& watch, const std::string& path) {
+        if (watch.notify_fd >= 0) {
+            // Closing drops the watch of the previous directory
+            close(watch.notify_fd);
+            watch.notify_fd = -1;
+        }
+        watch.path              = path;
+        watch.name              = std::filesystem::path(path).filename().string();
+        watch.last_write_time   = WriteTime(path);
+        watch.polled_write_time = watch.last_write_time;
+        watch.polling           = false;
+        if (path.empty()) {
+            return;
+        }
+#ifdef __linux__
+        watch.notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (watch.notify_fd >= 0 &&
+            inotify_add_watch(watch.notify_fd, WatchedDirectory(path).c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            close(watch.notify_fd);
+            watch.notify_fd = -1;
+        }
+#endif
+        watch.polling = watch.notify_fd < 0;
+    }
+
+    bool Wait(FileWatch& watch) {
+        while (true) {
+            pollfd fds[2] = {{watch.wake_fds[0], POLLIN, 0}, {watch.notify_fd, POLLIN, 0}};
+            nfds_t const count = watch.notify_fd >= 0 ? 2 : 1;
+            int const ready = poll(fds, count, watch.polling ? kPollIntervalMs : -1);
+            if (ready < 0 && errno != EINTR) {
+                return false;
+            }
+            if ((fds[0].revents & POLLIN) != 0) {
+                char drain[64];
+                while (read(watch.wake_fds[0], drain, sizeof(drain)) > 0) {
+                }
+                return false;
+            }
+            if (count == 2 && (fds[1].revents & POLLIN) != 0) {
+                if (DrainEvents(watch) && TimeChanged(watch)) {
+                    return true;
+                }
+            } else if (ready == 0 && PollChanged(watch)) {
+                return true;
+            }
+        }
+    }
+
+    void Wake(FileWatch& watch) {
+        char const wake = 1;
+        // A full pipe already wakes the waiter
+        if (watch.wake_fds[1] >= 0) {
+            (void)!write(watch.wake_fds[1], &wake, 1);
+        }
+    }
+#endif
+} // namespace file_watch
@@ -0,0 +1,57 @@
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace {
+    size_t BucketIndex(uint64_t value) {
+        if (value < kHistogramSubBuckets) {
+            return static_cast<size_t>(value);
+        }
+        size_t const exponent = static_cast<size_t>(std::bit_width(value)) - 1;
+        if (exponent > kHistogramMaxBits) {
+            return kHistogramBuckets - 1;
+        }
+        size_t const shift = exponent - kHistogramSubBits;
+        size_t const sub = static_cast<size_t>(value >> shift) & (kHistogramSubBuckets - 1);
+        return kHistogramSubBuckets + shift * kHistogramSubBuckets + sub;
+    }
+
+    uint64_t BucketUpperValue(size_t index) {
+        if (index < kHistogramSubBuckets) {
+            return index;
+        }
+        size_t const shift = (index - kHistogramSubBuckets) / kHistogramSubBuckets;
+        uint64_t const sub = (index - kHistogramSubBuckets) % kHistogramSubBuckets;
+        uint64_t const lower = (kHistogramSubBuckets + sub) << shift;
+        return lower + (uint64_t{1} << shift) - 1;
+    }
+} // namespace anonymous
+
+namespace latency_histogram {
+    void Add(LatencyHistogram& histogram, uint64_t value) {
+        histogram.counts[BucketIndex(value)]++;
+        histogram.total++;
+        histogram.max = std::max(histogram.max, value);
+    }
+
+    void Reset(LatencyHistogram& histogram) {
+        std::memset(&histogram, 0, sizeof(histogram));
+    }
+
+    void Percentiles(const LatencyHistogram& histogram, const double* fractions, uint64_t* values, size_t count) {
+        uint64_t seen = 0;
+        size_t bucket = 0;
+        for (size_t i = 0; i < count; i++) {
+            // Smallest value with at least this many samples at or below it
+            uint64_t const rank = std::max<uint64_t>(1, static_cast<uint64_t>(fractions[i] * histogram.total + 0.5));
+            while (bucket < kHistogramBuckets && seen + histogram.counts[bucket] < rank) {
+                seen += histogram.counts[bucket];
+                bucket++;
+            }
+            values[i] = histogram.total == 0 ? 0 :
+                        std::min(BucketUpperValue(std::min(bucket, kHistogramBuckets - 1)), histogram.max);
+        }
+    }
+} // namespace latency_histogram
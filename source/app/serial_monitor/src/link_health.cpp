@@ -0,0 +1,171 @@
+#include "link_health.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+    typedef std::atomic<uint64_t> Counter;
+
+    typedef struct {
+        Counter frames;
+        Counter first_timestamp;
+        Counter last_timestamp;
+        Counter min_delta;
+        Counter gaps;
+        Counter missed_frames;
+    } FrameCounters;
+
+    // A delta this much larger than the nominal period counts as a gap
+    const double gap_factor = 1.5;
+
+    std::atomic<std::chrono::steady_clock::rep> start_time = 0;
+    Counter rx_bytes;
+    Counter reads;
+    Counter frames;
+    Counter crc_errors;
+    Counter length_errors;
+    Counter unknown_ids;
+    Counter skipped_bytes;
+    Counter buffer_overflows;
+    Counter timestamp_gaps;
+    Counter missed_frames;
+    std::array<FrameCounters, 256> frame_counters;
+
+    // Single writer, no read-modify-write needed
+    inline void Add(Counter& counter, uint64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    inline uint64_t Get(const Counter& counter) {
+        return counter.load(std::memory_order_relaxed);
+    }
+} // namespace anonymous
+
+namespace link_health {
+    void Reset() {
+        for (Counter* counter : {&rx_bytes, &reads, &frames, &crc_errors, &length_errors, &unknown_ids,
+                                 &skipped_bytes, &buffer_overflows, &timestamp_gaps, &missed_frames}) {
+            counter->store(0, std::memory_order_relaxed);
+        }
+        for (auto& frame : frame_counters) {
+            for (Counter* counter : {&frame.frames, &frame.first_timestamp, &frame.last_timestamp,
+                                     &frame.min_delta, &frame.gaps, &frame.missed_frames}) {
+                counter->store(0, std::memory_order_relaxed);
+            }
+        }
+        start_time = std::chrono::steady_clock::now().time_since_epoch().count();
+    }
+
+    void ReceivedBytes(size_t bytes) {
+        Add(rx_bytes, bytes);
+        Add(reads, 1);
+    }
+
+    void BufferOverflow()             { Add(buffer_overflows, 1); }
+    void CrcError()                   { Add(crc_errors, 1); }
+    void LengthError()                { Add(length_errors, 1); }
+    void UnknownId()                  { Add(unknown_ids, 1); }
+    void SkippedBytes(size_t bytes)   { Add(skipped_bytes, bytes); }
+
+    void FrameDecoded(int id, uint64_t timestamp_us) {
+        Add(frames, 1);
+        FrameCounters& frame = frame_counters[static_cast<uint8_t>(id)];
+
+        if (Get(frame.frames) == 0) {
+            frame.first_timestamp.store(timestamp_us, std::memory_order_relaxed);
+        } else {
+            uint64_t const last = Get(frame.last_timestamp);
+            uint64_t const delta = timestamp_us > last ? timestamp_us - last : 0;
+            uint64_t min_delta = Get(frame.min_delta);
+            if (delta > 0 && (min_delta == 0 || delta < min_delta)) {
+                min_delta = delta;
+                frame.min_delta.store(min_delta, std::memory_order_relaxed);
+            }
+            if (min_delta > 0 && static_cast<double>(delta) > gap_factor * static_cast<double>(min_delta)) {
+                uint64_t const missed = static_cast<uint64_t>(
+                    std::llround(static_cast<double>(delta) / static_cast<double>(min_delta))) - 1;
+                Add(frame.gaps, 1);
+                Add(frame.missed_frames, missed);
+                Add(timestamp_gaps, 1);
+                Add(missed_frames, missed);
+            }
+        }
+        frame.last_timestamp.store(timestamp_us, std::memory_order_relaxed);
+        Add(frame.frames, 1);
+    }
+
+    LinkHealthStats GetStats() {
+        LinkHealthStats stats = {
+            .seconds          = 0.0,
+            .rx_bytes         = Get(rx_bytes),
+            .reads            = Get(reads),
+            .frames           = Get(frames),
+            .crc_errors       = Get(crc_errors),
+            .length_errors    = Get(length_errors),
+            .unknown_ids      = Get(unknown_ids),
+            .skipped_bytes    = Get(skipped_bytes),
+            .buffer_overflows = Get(buffer_overflows),
+            .timestamp_gaps   = Get(timestamp_gaps),
+            .missed_frames    = Get(missed_frames),
+            .frame_ids        = {},
+        };
+        auto const now = std::chrono::steady_clock::now().time_since_epoch().count();
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::duration(now - start_time)).count();
+
+        for (size_t id = 0; id < frame_counters.size(); id++) {
+            const FrameCounters& frame = frame_counters[id];
+            uint64_t const count = Get(frame.frames);
+            if (count == 0) {
+                continue;
+            }
+            uint64_t const min_delta = Get(frame.min_delta);
+            uint64_t const span = Get(frame.last_timestamp) - Get(frame.first_timestamp);
+            stats.frame_ids.push_back({
+                .id            = static_cast<int>(id),
+                .frames        = count,
+                .expected_hz   = min_delta > 0 ? 1e6 / static_cast<double>(min_delta) : 0.0,
+                .observed_hz   = span > 0 ? 1e6 * static_cast<double>(count - 1) / static_cast<double>(span) : 0.0,
+                .gaps          = Get(frame.gaps),
+                .missed_frames = Get(frame.missed_frames),
+            });
+        }
+        return stats;
+    }
+
+    /*
+     * Link statistics as comment lines, e.g. for the header of a log file.
+     */
+    std::string FormatHeader(const char* prefix) {
+        LinkHealthStats const stats = GetStats();
+        std::string header;
+        char line[256];
+        auto add = [&](const char* key, uint64_t value) {
+            std::snprintf(line, sizeof(line), "%s %s: %llu\n", prefix, key, static_cast<unsigned long long>(value));
+            header += line;
+        };
+
+        std::snprintf(line, sizeof(line), "%s duration_s: %.3f\n", prefix, stats.seconds);
+        header += line;
+        add("rx_bytes", stats.rx_bytes);
+        add("frames", stats.frames);
+        add("crc_errors", stats.crc_errors);
+        add("length_errors", stats.length_errors);
+        add("unknown_ids", stats.unknown_ids);
+        add("skipped_bytes", stats.skipped_bytes);
+        add("buffer_overflows", stats.buffer_overflows);
+        add("timestamp_gaps", stats.timestamp_gaps);
+        add("missed_frames", stats.missed_frames);
+        for (const auto& frame : stats.frame_ids) {
+            std::snprintf(line, sizeof(line),
+                          "%s frame %d: frames %llu, expected %.1f Hz, observed %.1f Hz, gaps %llu, missed %llu\n",
+                          prefix, frame.id, static_cast<unsigned long long>(frame.frames), frame.expected_hz,
+                          frame.observed_hz, static_cast<unsigned long long>(frame.gaps),
+                          static_cast<unsigned long long>(frame.missed_frames));
+            header += line;
+        }
+        return header;
+    }
+} // namespace link_health
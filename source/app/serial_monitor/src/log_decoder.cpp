@@ -0,0 +1,171 @@
+#include "log_decoder.h"
+
+#include <array>
+#include <cstring>
+#include <vector>
+
+#include "serial_protocol.h"
+#include "data_logger.h"
+#include "link_health.h"
+#include "tracing.h"
+
+namespace {
+    using serial_protocol::kHeaderSize;
+    using serial_protocol::kTimeSize;
+    using serial_protocol::kCrcSize;
+
+    // Indexed with frame id, nullptr if the id is not configured
+    std::array<FrameStruct*, 256> frame_table = {};
+    std::array<size_t, 256>       frame_length = {};
+
+    // Bytes not yet decoded, never more than one partial frame is left between calls.
+    std::vector<uint8_t> pending;
+
+    // Bitfields arrive as the bytes holding them. Signed fields are sign extended
+    // so the cast to the field type sees the right value.
+    uint64_t ExtractBits(uint64_t value, const FrameVarStruct& var) {
+        uint64_t const mask = var.bit_size >= 64 ? ~uint64_t{0} : (uint64_t{1} << var.bit_size) - 1U;
+        value = (value >> var.bit_offset) & mask;
+        bool const is_signed = var.type == TYPE_INT8 || var.type == TYPE_INT16 || var.type == TYPE_INT32;
+        if (is_signed && var.bit_size < 64 && ((value >> (var.bit_size - 1)) & 1U) != 0) {
+            value |= ~mask;
+        }
+        return value;
+    }
+
+    void DecodeFrame(int id, FrameStruct& frame, const uint8_t* payload) {
+        uint32_t time = 0;
+        for (size_t i = 0; i < kTimeSize; i++) {
+            time = (time << 8) | payload[i];
+        }
+        // Device ticks are 10 us
+        frame.latest_timestamp = static_cast<uint64_t>(time) * 10;
+
+        const uint8_t* src = payload + kTimeSize;
+        for (auto& var : frame.variables) {
+            uint64_t value = 0;
+            for (size_t i = 0; i < var.size; i++) {
+                value = (value << 8) | src[i];
+            }
+            if (var.bit_size != 0) {
+                value = ExtractBits(value, var);
+            }
+            var.latest_rx = value;
+            src += var.size;
+        }
+
+        data_logger::LogFrame(frame);
+        link_health::FrameDecoded(id, frame.latest_timestamp);
+    }
+
+    void Skip(const uint8_t* data, size_t len, const log_decoder::SkippedCallback& on_skipped) {
+        if (len == 0) {
+            return;
+        }
+        link_health::SkippedBytes(len);
+        if (on_skipped) {
+            on_skipped(data, len);
+        }
+    }
+
+    /*
+     * Scans pending for valid frames. A header or CRC mismatch only drops the first sync byte,
+     * so the scan resumes at the next candidate and every byte is inspected a bounded number
+     * of times. Returns the number of consumed bytes.
+     */
+    size_t Decode(const uint8_t* data, size_t len, const log_decoder::SkippedCallback& on_skipped) {
+        size_t pos = 0;
+        while (pos < len) {
+            const void* sync = std::memchr(data + pos, serial_protocol::kSync0, len - pos);
+            if (sync == nullptr) {
+                Skip(data + pos, len - pos, on_skipped);
+                return len;
+            }
+            size_t const sync_pos = static_cast<const uint8_t*>(sync) - data;
+            Skip(data + pos, sync_pos - pos, on_skipped);
+            pos = sync_pos;
+
+            if (len - pos < kHeaderSize) {
+                break;
+            }
+
+            const uint8_t* header = data + pos;
+            uint8_t const id      = header[3];
+            size_t const length   = header[4];
+            if (header[1] != serial_protocol::kSync1 ||
+                header[2] != serial_protocol::kVersion ||
+                length < kTimeSize) {
+                Skip(data + pos, 1, on_skipped);
+                pos++;
+                continue;
+            }
+            // Length of configured frames is known, no need to wait for a bad frame to complete
+            if (frame_table[id] != nullptr && length != frame_length[id]) {
+                link_health::LengthError();
+                Skip(data + pos, 1, on_skipped);
+                pos++;
+                continue;
+            }
+
+            size_t const total = kHeaderSize + length + kCrcSize;
+            if (len - pos < total) {
+                break;
+            }
+
+            uint16_t const crc = static_cast<uint16_t>((header[kHeaderSize + length] << 8) |
+                                                        header[kHeaderSize + length + 1]);
+            if (serial_protocol::Crc16(header + 2, kHeaderSize - 2 + length) != crc) {
+                link_health::CrcError();
+                Skip(data + pos, 1, on_skipped);
+                pos++;
+                continue;
+            }
+
+            if (frame_table[id] == nullptr) {
+                link_health::UnknownId();
+            } else {
+                DecodeFrame(id, *frame_table[id], header + kHeaderSize);
+            }
+            pos += total;
+        }
+        return pos;
+    }
+} // namespace anonymous
+
+namespace log_decoder {
+    void Configure(std::unordered_map<std::string, FrameStruct>& frames) {
+        frame_table.fill(nullptr);
+        frame_length.fill(0);
+        for (auto& [name, frame] : frames) {
+            if (frame.id < 0 || frame.id >= static_cast<int>(frame_table.size())) {
+                continue;
+            }
+            size_t length = kTimeSize;
+            for (const auto& var : frame.variables) {
+                length += var.size;
+            }
+            frame_table[frame.id]  = &frame;
+            frame_length[frame.id] = length;
+        }
+        Reset();
+    }
+
+    void Reset() {
+        pending.clear();
+        link_health::Reset();
+    }
+
+    void Feed(const uint8_t* data, size_t len, const SkippedCallback& on_skipped) {
+        TRACE_ZONE("DecodeLog");
+
+        if (pending.empty()) {
+            // Common case, decode straight from the read buffer and keep only the tail.
+            size_t const used = Decode(data, len, on_skipped);
+            pending.assign(data + used, data + len);
+        } else {
+            pending.insert(pending.end(), data, data + len);
+            size_t const used = Decode(pending.data(), pending.size(), on_skipped);
+            pending.erase(pending.begin(), pending.begin() + static_cast<std::ptrdiff_t>(used));
+        }
+    }
+} // namespace log_decoder
@@ -0,0 +1,204 @@
+#include "memory_stats.h"
+
+#include <malloc.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+    std::atomic<uint64_t> allocations     = 0;
+    std::atomic<uint64_t> frees           = 0;
+    std::atomic<uint64_t> allocated_bytes = 0;
+    std::atomic<int64_t>  live_bytes      = 0;
+
+    // Constant initialized, so using it inside operator new never allocates
+    thread_local AllocationCounts thread_counts = {};
+
+    // Alignment 0 is the default alignment of malloc. Windows has no aligned_alloc, and its
+    // aligned blocks must go back through _aligned_free.
+    void* RawAlloc(size_t size, size_t alignment) {
+        if (alignment == 0) {
+            return std::malloc(size);
+        }
+#ifdef _WIN32
+        return _aligned_malloc(size, alignment);
+#else
+        // aligned_alloc wants the size as a multiple of the alignment
+        return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+    }
+
+    void RawFree(void* ptr, size_t alignment) {
+#ifdef _WIN32
+        if (alignment != 0) {
+            _aligned_free(ptr);
+            return;
+        }
+#endif
+        (void)alignment;
+        std::free(ptr);
+    }
+
+    size_t UsableSize(void* ptr, size_t alignment) {
+#ifdef _WIN32
+        return alignment == 0 ? _msize(ptr) : _aligned_msize(ptr, alignment, 0);
+#else
+        (void)alignment;
+        return malloc_usable_size(ptr);
+#endif
+    }
+
+    void* CountedAlloc(size_t size, size_t alignment = 0) {
+        void* const ptr = RawAlloc(size == 0 ? 1 : size, alignment);
+        if (ptr == nullptr) {
+            return nullptr;
+        }
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+        live_bytes.fetch_add(static_cast<int64_t>(UsableSize(ptr, alignment)), std::memory_order_relaxed);
+        thread_counts.allocations++;
+        thread_counts.allocated_bytes += size;
+        return ptr;
+    }
+
+    void* CountedNew(size_t size, size_t alignment = 0) {
+        void* ptr;
+        while ((ptr = CountedAlloc(size, alignment)) == nullptr) {
+            std::new_handler const handler = std::get_new_handler();
+            if (handler == nullptr) {
+                throw std::bad_alloc();
+            }
+            handler();
+        }
+        return ptr;
+    }
+
+    void CountedFree(void* ptr, size_t alignment = 0) {
+        if (ptr == nullptr) {
+            return;
+        }
+        frees.fetch_add(1, std::memory_order_relaxed);
+        live_bytes.fetch_sub(static_cast<int64_t>(UsableSize(ptr, alignment)), std::memory_order_relaxed);
+        thread_counts.frees++;
+        RawFree(ptr, alignment);
+    }
+
+    // Bucket array and one node per element of an unordered_map
+    template <typename Map>
+    size_t HashMapBytes(const Map& map) {
+        // Node: next pointer, cached hash and the value
+        size_t const node_size = 2 * sizeof(void*) + sizeof(typename Map::value_type);
+        return map.bucket_count() * sizeof(void*) + map.size() * node_size;
+    }
+} // namespace anonymous
+
+void* operator new(std::size_t size) {
+    return CountedNew(size);
+}
+
+void* operator new[](std::size_t size) {
+    return CountedNew(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return CountedAlloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return CountedAlloc(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    CountedFree(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    CountedFree(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    CountedFree(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    CountedFree(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    CountedFree(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    CountedFree(ptr);
+}
+
+// Over-aligned types, e.g. alignas(64) buffers
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return CountedNew(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return CountedNew(size, static_cast<size_t>(alignment));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return CountedAlloc(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return CountedAlloc(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* ptr, std::align_val_t alignment) noexcept {
+    CountedFree(ptr, static_cast<size_t>(alignment));
+}
+
+void operator delete[](void* ptr, std::align_val_t alignment) noexcept {
+    CountedFree(ptr, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t alignment) noexcept {
+    CountedFree(ptr, static_cast<size_t>(alignment));
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t alignment) noexcept {
+    CountedFree(ptr, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* ptr, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    CountedFree(ptr, static_cast<size_t>(alignment));
+}
+
+void operator delete[](void* ptr, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    CountedFree(ptr, static_cast<size_t>(alignment));
+}
+
+namespace memory_stats {
+    AllocationCounts GetAllocations() {
+        return {
+            .allocations     = allocations.load(std::memory_order_relaxed),
+            .frees           = frees.load(std::memory_order_relaxed),
+            .allocated_bytes = allocated_bytes.load(std::memory_order_relaxed),
+        };
+    }
+
+    AllocationCounts GetThreadAllocations() {
+        return thread_counts;
+    }
+
+    int64_t GetLiveBytes() {
+        return live_bytes.load(std::memory_order_relaxed);
+    }
+
+    size_t SymbolMapBytes(const FileSymbolMap& map) {
+        size_t bytes = HashMapBytes(map);
+        for (const auto& [file, variables] : map) {
+            bytes += StringBytes(file) + HashMapBytes(variables);
+            for (const auto& [name, var] : variables) {
+                bytes += StringBytes(name);
+            }
+        }
+        return bytes;
+    }
+} // namespace memory_stats
@@ -1,146 +1,383 @@
 #include "performance_analysis.h"
 #include "imgui.h"
 #include "implot.h"
-#include <iostream>
+#include "ImGuiFileDialog.h"
+#include "console_log.h"
+#include "data_logger.h"
+#include "json.hpp"
+#include "latency_histogram.h"
+#include "log_reader.h"
+#include "main_window.h"
+#include "memory_stats.h"
+#include "serial_back.h"
+#include "tracing.h"
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using Json = nlohmann::json;
 
 namespace {
-    using performance_analysis::AnalysisIndex;
-    using performance_analysis::PerformanceData;
+    // Samples kept per zone, older ones are overwritten
+    const int kHistorySize = 10000;
+
+    typedef struct {
+        std::vector<double> values;
+        int                 next;       // Where the next sample goes, the oldest once full
+    } History;
+
+    typedef struct {
+        History          elapsed_us;
+        History          tick_us;       // Time between starts of the zone
+        LatencyHistogram elapsed_ns;    // Since the last reset
+        LatencyHistogram tick_ns;
+        uint64_t         previous_start_ns;
+        bool             is_counter;
+    } ZoneHistory;
 
     typedef struct {
         std::string name;
-        PerformanceData* data;
-    } AnalysisStruct;
+        size_t      bytes;
+    } MemoryItem;
 
-    std::deque<int> recieved_bytes_buffer;
-    
-    PerformanceData SerialMonitoringTaskData;
-    PerformanceData FunLogFrameData;
-    PerformanceData FunDeserializeLogData;
-    PerformanceData TaskMainGui;
+    typedef struct {
+        std::vector<MemoryItem> components;     // Largest first
+        std::vector<MemoryItem> signals;        // Largest first
+    } MemoryUsage;
 
-    uint16_t buffer_size = 10000;
+    // Heap allocations of the GUI thread per frame, since the last reset
+    typedef struct {
+        AllocationCounts previous;              // At the last Collect
+        bool             started;
+        uint64_t         frames;
+        uint64_t         frames_without_allocations;
+        uint64_t         last_allocations;
+        uint64_t         last_bytes;
+        uint64_t         max_allocations;
+    } FrameAllocations;
 
-    AnalysisStruct list[AnalysisIndex::NUM_ANALYSIS] = {
-        {"SerialMonitoringTask",    &SerialMonitoringTaskData},
-        {"FunLogFrame",             &FunLogFrameData},
-        {"FunDeserializeLog",       &FunDeserializeLogData},
-        {"TaskMainGui",             &TaskMainGui},
-    };
+    // Walking the symbol map takes a while with large ELF files, refresh at most this often
+    const double kMemoryRefreshSeconds = 1.0;
 
-    void SaveToBuffer(PerformanceData& data) {
-        data.elapsed_time_deque.push_back(data.elapsed_time);
-        data.tick_time_deque.push_back(data.tick_time);
+    std::vector<ZoneHistory> zone_histories;
+    std::vector<uint64_t>    thread_cursors;
+    std::vector<TraceRecord> records;
+    FrameAllocations         frame_allocations = {};
+    MemoryUsage              memory_usage;
+    double                   memory_usage_time = -kMemoryRefreshSeconds;
 
-        // Only save last 100 samples
-        if (data.elapsed_time_deque.size() > buffer_size) {
-            data.elapsed_time_deque.pop_front();
+    void Push(History& history, double value) {
+        if (history.values.size() < kHistorySize) {
+            history.values.push_back(value);
+        } else {
+            history.values[history.next] = value;
         }
-        if (data.tick_time_deque.size() > buffer_size) {
-            data.tick_time_deque.pop_front();
+        history.next = (history.next + 1) % kHistorySize;
+    }
+
+    void Plot(const std::string& name, const History& history) {
+        if (history.values.empty()) {
+            return;
         }
+        int const offset = history.values.size() < kHistorySize ? 0 : history.next;
+        ImPlot::PlotLine(name.c_str(), history.values.data(), static_cast<int>(history.values.size()),
+                         1.0, 0.0, 0, offset);
     }
 
+    // Timings of all threads for an offline trace viewer
+    void ExportTraceButton() {
+        static std::string status;
+        if (ImGui::Button("Export Trace")) {
+            IGFD::FileDialogConfig config;
+            config.path = "logs";
+            config.fileName = "trace.json";
+            config.flags = ImGuiFileDialogFlags_ConfirmOverwrite;
+            ImGuiFileDialog::Instance()->OpenDialog("SaveTrace", "Save Chrome Trace", ".json", config);
+        }
+        if (ImGuiFileDialog::Instance()->Display("SaveTrace")) {
+            if (ImGuiFileDialog::Instance()->IsOk()) {
+                std::string const path = ImGuiFileDialog::Instance()->GetFilePathName();
+                status = tracing::WriteChromeTrace(path) ? "Saved " + path : "Could not write " + path;
+            }
+            ImGuiFileDialog::Instance()->Close();
+        }
+        if (!status.empty()) {
+            ImGui::SameLine();
+            ImGui::TextUnformatted(status.c_str());
+        }
+    }
 
-} // anonymous namespace
+    void PercentileRow(const std::string& zone, const char* metric, const LatencyHistogram& histogram) {
+        static const double kFractions[] = {0.5, 0.9, 0.99, 0.999};
+        uint64_t values[IM_ARRAYSIZE(kFractions)];
+        latency_histogram::Percentiles(histogram, kFractions, values, IM_ARRAYSIZE(kFractions));
 
-namespace performance_analysis {
-    void RecievedBytes(uint16_t bytes) {
-        recieved_bytes_buffer.push_back(bytes);
-        if (recieved_bytes_buffer.size() > buffer_size) {
-            recieved_bytes_buffer.pop_front();
+        ImGui::TableNextRow();
+        ImGui::TableSetColumnIndex(0);
+        ImGui::TextUnformatted(zone.c_str());
+        ImGui::TableSetColumnIndex(1);
+        ImGui::TextUnformatted(metric);
+        ImGui::TableSetColumnIndex(2);
+        ImGui::Text("%llu", static_cast<unsigned long long>(histogram.total));
+        for (size_t i = 0; i < IM_ARRAYSIZE(kFractions); i++) {
+            ImGui::TableSetColumnIndex(static_cast<int>(3 + i));
+            ImGui::Text("%.1f", values[i] / 1e3);
         }
+        ImGui::TableSetColumnIndex(7);
+        ImGui::Text("%.1f", histogram.max / 1e3);
     }
 
-    void Start(AnalysisIndex index) {
-        if (index < AnalysisIndex::NUM_ANALYSIS) {
-            PerformanceData * data = list[index].data;
-
-            data->start_time = std::chrono::high_resolution_clock::now();
+    // Tail latencies, these are what make the link drop frames
+    void PercentileTable() {
+        if (ImGui::Button("Reset")) {
+            for (ZoneHistory& zone : zone_histories) {
+                latency_histogram::Reset(zone.elapsed_ns);
+                latency_histogram::Reset(zone.tick_ns);
+            }
+        }
+        if (ImGui::BeginTable("Percentiles", 8, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                                                ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_NoSavedSettings)) {
+            ImGui::TableSetupColumn("Zone", ImGuiTableColumnFlags_WidthStretch);
+            ImGui::TableSetupColumn("[us]");
+            ImGui::TableSetupColumn("Count");
+            ImGui::TableSetupColumn("p50");
+            ImGui::TableSetupColumn("p90");
+            ImGui::TableSetupColumn("p99");
+            ImGui::TableSetupColumn("p99.9");
+            ImGui::TableSetupColumn("Max");
+            ImGui::TableHeadersRow();
+            for (uint16_t zone = 0; zone < zone_histories.size(); zone++) {
+                if (zone_histories[zone].is_counter) {
+                    continue;
+                }
+                std::string const name = tracing::GetZoneName(zone);
+                PercentileRow(name, "Elapsed", zone_histories[zone].elapsed_ns);
+                PercentileRow(name, "Tick", zone_histories[zone].tick_ns);
+            }
+            ImGui::EndTable();
+        }
+    }
+    void CountFrameAllocations() {
+        AllocationCounts const now = memory_stats::GetThreadAllocations();
+        if (frame_allocations.started) {
+            uint64_t const count = now.allocations - frame_allocations.previous.allocations;
+            frame_allocations.last_allocations = count;
+            frame_allocations.last_bytes = now.allocated_bytes - frame_allocations.previous.allocated_bytes;
+            frame_allocations.max_allocations = std::max(frame_allocations.max_allocations, count);
+            frame_allocations.frames++;
+            if (count == 0) {
+                frame_allocations.frames_without_allocations++;
+            }
+            TRACE_COUNTER("FrameAllocations", count);
+        }
+        frame_allocations.previous = now;
+        frame_allocations.started = true;
+    }
 
-            auto time_diff = data->start_time - data->previous_start_time;
-            data->tick_time = 
-                std::chrono::duration_cast<std::chrono::microseconds>(time_diff).count();
+    void SortBySize(std::vector<MemoryItem>& items) {
+        std::sort(items.begin(), items.end(), [](const MemoryItem& a, const MemoryItem& b) {
+            return a.bytes > b.bytes;
+        });
+    }
 
-            data->previous_start_time = data->start_time;
+    // Must not be called with the log data locked
+    MemoryUsage GetMemoryUsage() {
+        MemoryUsage usage;
+        {
+            std::unique_lock<std::mutex> log_lock;
+            if (GetLogSource() == LogSource::LOG_SOURCE_SERIAL) {
+                log_lock = data_logger::LockLogData();
+            }
+            const Data* data = GetData();
+            size_t signal_bytes = 0;
+            for (const auto& [name, values] : data->signals) {
+                usage.signals.push_back({name, memory_stats::VectorBytes(values)});
+                signal_bytes += usage.signals.back().bytes;
+            }
+            usage.components.push_back({"Signals", signal_bytes});
+            usage.components.push_back({"Time", memory_stats::VectorBytes(data->time)});
         }
+        std::shared_ptr<const FileSymbolMap> const parsed_map = serial_back::GetParsedMap();
+        usage.components.push_back({"Decimation buffers", GetDecimationBufferBytes()});
+        usage.components.push_back({"Log history", GetHistoryBytes()});
+        usage.components.push_back({"Parsed map", parsed_map ? memory_stats::SymbolMapBytes(*parsed_map) : 0});
+        usage.components.push_back({"Console lines", console_log::GetMemoryBytes()});
+        usage.components.push_back({"Trace buffers", tracing::GetMemoryBytes()});
+        SortBySize(usage.components);
+        SortBySize(usage.signals);
+        return usage;
     }
 
-    void End(AnalysisIndex index) {
-        if (index < AnalysisIndex::NUM_ANALYSIS) {
-            PerformanceData * data = list[index].data;
+    void MemoryRow(const MemoryItem& item) {
+        ImGui::TableNextRow();
+        ImGui::TableSetColumnIndex(0);
+        ImGui::TextUnformatted(item.name.c_str());
+        ImGui::TableSetColumnIndex(1);
+        ImGui::Text("%.1f", item.bytes / 1024.0);
+    }
 
-            data->end_time = std::chrono::high_resolution_clock::now();
-            auto elapsed_time = data->end_time - data->start_time;
-            data->elapsed_time = 
-                std::chrono::duration_cast<std::chrono::microseconds>(elapsed_time).count();
+    // Where the memory goes, and whether an idle frame really allocates nothing
+    void MemoryTable() {
+        if (ImGui::Button("Reset##Allocations")) {
+            frame_allocations = {};
+        }
+        ImGui::SameLine();
+        ImGui::Text("GUI frame: %llu allocations, %.1f KB (max %llu), %llu of %llu frames without allocations",
+                    static_cast<unsigned long long>(frame_allocations.last_allocations),
+                    frame_allocations.last_bytes / 1024.0,
+                    static_cast<unsigned long long>(frame_allocations.max_allocations),
+                    static_cast<unsigned long long>(frame_allocations.frames_without_allocations),
+                    static_cast<unsigned long long>(frame_allocations.frames));
+        AllocationCounts const all = memory_stats::GetAllocations();
+        ImGui::Text("All threads: %llu allocations, %llu frees, %.1f MB held",
+                    static_cast<unsigned long long>(all.allocations), static_cast<unsigned long long>(all.frees),
+                    memory_stats::GetLiveBytes() / (1024.0 * 1024.0));
 
-            SaveToBuffer(*data);
+        if (ImGui::GetTime() - memory_usage_time >= kMemoryRefreshSeconds) {
+            memory_usage = GetMemoryUsage();
+            memory_usage_time = ImGui::GetTime();
+        }
+        if (ImGui::BeginTable("Memory", 2, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                                           ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_NoSavedSettings)) {
+            ImGui::TableSetupColumn("Held by", ImGuiTableColumnFlags_WidthStretch);
+            ImGui::TableSetupColumn("[KB]");
+            ImGui::TableHeadersRow();
+            for (const MemoryItem& item : memory_usage.components) {
+                MemoryRow(item);
+            }
+            ImGui::EndTable();
+        }
+        if (!memory_usage.signals.empty() && ImGui::TreeNode("Signals")) {
+            if (ImGui::BeginTable("SignalMemory", 2, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                                                     ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_ScrollY |
+                                                     ImGuiTableFlags_NoSavedSettings,
+                                  ImVec2(0, ImGui::GetTextLineHeightWithSpacing() * 12))) {
+                ImGui::TableSetupScrollFreeze(0, 1);
+                ImGui::TableSetupColumn("Signal", ImGuiTableColumnFlags_WidthStretch);
+                ImGui::TableSetupColumn("[KB]");
+                ImGui::TableHeadersRow();
+                ImGuiListClipper clipper;
+                clipper.Begin(static_cast<int>(memory_usage.signals.size()));
+                while (clipper.Step()) {
+                    for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                        MemoryRow(memory_usage.signals[row]);
+                    }
+                }
+                ImGui::EndTable();
+            }
+            ImGui::TreePop();
         }
     }
 
-    PerformanceData * GetData(AnalysisIndex index) {
-        if (index < AnalysisIndex::NUM_ANALYSIS) {
-            return list[index].data;
+    Json MemoryItemsJson(const std::vector<MemoryItem>& items) {
+        Json json = Json::array();
+        for (const MemoryItem& item : items) {
+            json.push_back({{"name", item.name}, {"bytes", item.bytes}});
         }
-        return nullptr;
+        return json;
     }
+} // anonymous namespace
 
-    void PrintPerformanceData(AnalysisIndex index) {
-        int largest_name_length = 0;
-        for (const auto& analysis : list) {
-            largest_name_length = std::max(largest_name_length, static_cast<int>(analysis.name.length()));
-        }
-        if (index < AnalysisIndex::NUM_ANALYSIS) {
-            AnalysisStruct AnalysisStr = list[index];
-            std::cout << std::setw(largest_name_length) << AnalysisStr.name
-                      << " | Elapsed Time: " << std::setw(8) << AnalysisStr.data->elapsed_time  << " us"
-                      << " | Tick Time: "    << std::setw(8) << AnalysisStr.data->tick_time     << " us";
+namespace performance_analysis {
+    void Collect() {
+        CountFrameAllocations();
+        thread_cursors.resize(tracing::GetThreadCount(), 0);
+        zone_histories.resize(tracing::GetZoneCount(), ZoneHistory{});
+        for (size_t thread = 0; thread < thread_cursors.size(); thread++) {
+            records.clear();
+            tracing::Read(thread, thread_cursors[thread], records);
+            for (const TraceRecord& record : records) {
+                if (record.zone >= zone_histories.size()) {
+                    continue;
+                }
+                ZoneHistory& zone = zone_histories[record.zone];
+                if (record.kind == TRACE_COUNTER_RECORD) {
+                    zone.is_counter = true;
+                    Push(zone.elapsed_us, record.value);
+                    continue;
+                }
+                Push(zone.elapsed_us, record.value / 1e3);
+                latency_histogram::Add(zone.elapsed_ns, record.value);
+                if (zone.previous_start_ns != 0) {
+                    Push(zone.tick_us, (record.start_ns - zone.previous_start_ns) / 1e3);
+                    latency_histogram::Add(zone.tick_ns, record.start_ns - zone.previous_start_ns);
+                }
+                zone.previous_start_ns = record.start_ns;
+            }
         }
     }
 
     void PerformanceWindow(bool& open) {
         ImGui::SetNextWindowSize(ImVec2(600,400), ImGuiCond_FirstUseEver);
         if (ImGui::Begin("Performance Analysis", &open)) {
+#ifndef TRACING_ENABLED
+            ImGui::TextDisabled("Tracing is compiled out of this build.");
+#endif
+            ExportTraceButton();
+            PercentileTable();
+            if (ImGui::CollapsingHeader("Memory")) {
+                MemoryTable();
+            }
             if (ImPlot::BeginSubplots("##PerformanceSubplots", 3, 1, ImVec2(-1,-1), ImPlotSubplotFlags_LinkAllX)) {
-
-                ImPlot::BeginPlot("Elapsed Time");
-                ImPlot::SetupAxis(ImAxis_X1, nullptr, ImPlotAxisFlags_AutoFit);
-                for (const auto& analysis : list) {
-                    if (!analysis.data->elapsed_time_deque.empty()) {
-                        std::vector<long long> temp(analysis.data->elapsed_time_deque.begin(), analysis.data->elapsed_time_deque.end());
-                        ImPlot::PlotLine(analysis.name.c_str(),
-                            temp.data(),
-                            temp.size());
+                if (ImPlot::BeginPlot("Elapsed Time [us]")) {
+                    ImPlot::SetupAxis(ImAxis_X1, nullptr, ImPlotAxisFlags_AutoFit);
+                    for (uint16_t zone = 0; zone < zone_histories.size(); zone++) {
+                        if (!zone_histories[zone].is_counter) {
+                            Plot(tracing::GetZoneName(zone), zone_histories[zone].elapsed_us);
+                        }
                     }
+                    ImPlot::EndPlot();
                 }
-                ImPlot::EndPlot();
-
-                ImPlot::BeginPlot("Tick Time");
-                for (const auto& analysis : list) {
-                    if (!analysis.data->tick_time_deque.empty()) {
-                        std::vector<long long> temp(analysis.data->tick_time_deque.begin(), analysis.data->tick_time_deque.end());
-                        ImPlot::PlotLine(analysis.name.c_str(),
-                            temp.data(),
-                            temp.size());
+
+                if (ImPlot::BeginPlot("Tick Time [us]")) {
+                    for (uint16_t zone = 0; zone < zone_histories.size(); zone++) {
+                        if (!zone_histories[zone].is_counter) {
+                            Plot(tracing::GetZoneName(zone), zone_histories[zone].tick_us);
+                        }
                     }
+                    ImPlot::EndPlot();
                 }
-                ImPlot::EndPlot();
-
-                ImPlot::BeginPlot("Recieved Bytes");
-                if (!recieved_bytes_buffer.empty()) {
-                    std::vector<int> temp(recieved_bytes_buffer.begin(), recieved_bytes_buffer.end());
-                    ImPlot::PlotLine("Recieved Bytes",
-                        temp.data(),
-                        temp.size());
+
+                if (ImPlot::BeginPlot("Counters")) {
+                    for (uint16_t zone = 0; zone < zone_histories.size(); zone++) {
+                        if (zone_histories[zone].is_counter) {
+                            Plot(tracing::GetZoneName(zone), zone_histories[zone].elapsed_us);
+                        }
+                    }
+                    ImPlot::EndPlot();
                 }
-                ImPlot::EndPlot();
 
                 ImPlot::EndSubplots();
             }
-            
-            ImGui::End();
         }
+        ImGui::End();
+    }
+
+    bool WriteMemoryReport(const std::string& path) {
+        MemoryUsage const usage = GetMemoryUsage();
+        AllocationCounts const all = memory_stats::GetAllocations();
+        Json report;
+        report["live_bytes"] = memory_stats::GetLiveBytes();
+        report["all_threads"] = {
+            {"allocations", all.allocations},
+            {"frees", all.frees},
+            {"allocated_bytes", all.allocated_bytes},
+        };
+        report["gui_frames"] = {
+            {"frames", frame_allocations.frames},
+            {"frames_without_allocations", frame_allocations.frames_without_allocations},
+            {"last_allocations", frame_allocations.last_allocations},
+            {"last_bytes", frame_allocations.last_bytes},
+            {"max_allocations", frame_allocations.max_allocations},
+        };
+        report["components"] = MemoryItemsJson(usage.components);
+        report["signals"] = MemoryItemsJson(usage.signals);
+
+        std::ofstream file(path);
+        file << report.dump(2) << "\n";
+        return static_cast<bool>(file);
     }
 
-} // namespace performance_analysis
\ No newline at end of file
+} // namespace performance_analysis
@@ -0,0 +1,262 @@
+#include "raw_capture.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "serial_front.h"
+
+namespace {
+    // Each buffer holds many serial reads, the writer thread only wakes when one is full.
+    const size_t buffer_size = 4 * 1024 * 1024;
+
+    // host_time_us u64 | len u32
+    const size_t record_header_size = sizeof(uint64_t) + sizeof(uint32_t);
+    // Larger records or configs are never written, a file claiming one is corrupt
+    const size_t max_record_len     = buffer_size - record_header_size;
+    const size_t max_config_len     = buffer_size;
+
+    std::FILE*              file = nullptr;
+    std::string             capture_path;
+    std::thread             writer_thread;
+    std::atomic<bool>       recording = false;
+    std::chrono::steady_clock::time_point start_time;
+
+    // Serial thread fills buffers[active], the writer thread writes buffers[1 - active].
+    std::vector<uint8_t>    buffers[2];
+    int                     active      = 0;
+    size_t                  active_len  = 0;
+    size_t                  flush_len   = 0;
+    bool                    flush_ready = false;
+    bool                    writer_exit = false;
+    bool                    write_failed = false;  // Set by the writer thread, read after it is joined
+    uint64_t                dropped_bytes = 0;
+
+    std::mutex              write_mutex;    // Serial thread vs Start/Stop, never held during I/O
+    std::mutex              flush_mutex;
+    std::condition_variable flush_cv;
+
+    void WriterTask() {
+        while (true) {
+            std::unique_lock<std::mutex> lock(flush_mutex);
+            flush_cv.wait(lock, [] { return flush_ready || writer_exit; });
+            if (!flush_ready) {
+                return;
+            }
+            const uint8_t* data = buffers[1 - active].data();
+            size_t const len = flush_len;
+            lock.unlock();
+
+            if (!write_failed && std::fwrite(data, 1, len, file) != len) {
+                write_failed = true;    // Disk full, later buffers are dropped
+            }
+
+            lock.lock();
+            flush_ready = false;
+            flush_cv.notify_all();
+        }
+    }
+
+    /*
+     * Hands the active buffer to the writer thread. Returns false if the writer
+     * is still busy with the previous one. Called with write_mutex held.
+     */
+    bool SwapBuffers(bool wait) {
+        std::unique_lock<std::mutex> lock(flush_mutex);
+        if (flush_ready) {
+            if (!wait) {
+                return false;
+            }
+            flush_cv.wait(lock, [] { return !flush_ready; });
+        }
+        active      = 1 - active;
+        flush_len   = active_len;
+        flush_ready = true;
+        active_len  = 0;
+        flush_cv.notify_all();
+        return true;
+    }
+} // namespace anonymous
+
+namespace raw_capture {
+    bool Start(const std::string& path, const std::string& config) {
+        Stop();
+
+        std::filesystem::path const file_path(path);
+        if (file_path.has_parent_path() && !std::filesystem::exists(file_path.parent_path())) {
+            std::filesystem::create_directories(file_path.parent_path());
+        }
+
+        file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr) {
+            serial_front::AddLog("%s ERROR: Could not open raw capture file %s\n", ERROR_CHAR, path.c_str());
+            return false;
+        }
+        // Writes are already buffer sized
+        std::setvbuf(file, nullptr, _IONBF, 0);
+
+        uint32_t const config_len = static_cast<uint32_t>(config.size());
+        if (config.size() > max_config_len ||
+            std::fwrite(kMagic, 1, sizeof(kMagic), file) != sizeof(kMagic) ||
+            std::fwrite(&kVersion, sizeof(kVersion), 1, file) != 1 ||
+            std::fwrite(&config_len, sizeof(config_len), 1, file) != 1 ||
+            std::fwrite(config.data(), 1, config.size(), file) != config.size()) {
+            serial_front::AddLog("%s ERROR: Could not write raw capture file %s\n", ERROR_CHAR, path.c_str());
+            std::fclose(file);
+            file = nullptr;
+            return false;
+        }
+
+        for (auto& buf : buffers) {
+            buf.resize(buffer_size);
+        }
+        capture_path  = path;
+        active        = 0;
+        active_len    = 0;
+        flush_ready   = false;
+        writer_exit   = false;
+        write_failed  = false;
+        dropped_bytes = 0;
+        start_time    = std::chrono::steady_clock::now();
+
+        writer_thread = std::thread(WriterTask);
+        recording = true;
+
+        serial_front::AddLog("%s Recording raw capture to %s\n", COMMAND_CHAR, path.c_str());
+        return true;
+    }
+
+    /*
+     * Called from the serial thread with the bytes of one read.
+     * Only copies into the active buffer, data is dropped rather than waiting for the disk.
+     */
+    void Write(const uint8_t* data, size_t len) {
+        if (!recording || len == 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(write_mutex);
+        if (!recording) {
+            return;
+        }
+
+        size_t const record_len = record_header_size + len;
+        if (len > max_record_len) {
+            dropped_bytes += len;
+            return;
+        }
+        if (active_len + record_len > buffer_size && !SwapBuffers(false)) {
+            dropped_bytes += len;
+            return;
+        }
+
+        auto elapsed = std::chrono::steady_clock::now() - start_time;
+        uint64_t const host_time_us = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+        uint32_t const data_len = static_cast<uint32_t>(len);
+        uint8_t* dst = buffers[active].data() + active_len;
+        std::memcpy(dst, &host_time_us, sizeof(host_time_us));
+        std::memcpy(dst + sizeof(host_time_us), &data_len, sizeof(data_len));
+        std::memcpy(dst + record_header_size, data, len);
+        active_len += record_len;
+    }
+
+    void Stop() {
+        {
+            std::lock_guard<std::mutex> lock(write_mutex);
+            if (!recording) {
+                return;
+            }
+            recording = false;
+            if (active_len > 0) {
+                SwapBuffers(true);
+            }
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(flush_mutex);
+            flush_cv.wait(lock, [] { return !flush_ready; });
+            writer_exit = true;
+            flush_cv.notify_all();
+        }
+        writer_thread.join();
+
+        if (std::fclose(file) != 0) {
+            write_failed = true;
+        }
+        file = nullptr;
+        for (auto& buf : buffers) {
+            buf = std::vector<uint8_t>();
+        }
+
+        if (write_failed) {
+            serial_front::AddLog("%s ERROR: Could not write raw capture %s, the capture is incomplete.\n",
+                                 ERROR_CHAR, capture_path.c_str());
+        }
+        if (dropped_bytes > 0) {
+            serial_front::AddLog("%s ERROR: Raw capture dropped %llu bytes, disk too slow.\n", ERROR_CHAR,
+                                 static_cast<unsigned long long>(dropped_bytes));
+        }
+    }
+
+    bool IsRecording() {
+        return recording;
+    }
+
+    bool ReadCapture(const std::string& path, std::string& config, const RecordCallback& on_record) {
+        std::FILE* in = std::fopen(path.c_str(), "rb");
+        if (in == nullptr) {
+            serial_front::AddLog("%s ERROR: Could not open raw capture file %s\n", ERROR_CHAR, path.c_str());
+            return false;
+        }
+        std::vector<char> io_buffer(1024 * 1024);
+        std::setvbuf(in, io_buffer.data(), _IOFBF, io_buffer.size());
+
+        char magic[sizeof(kMagic)];
+        uint32_t version = 0;
+        uint32_t config_len = 0;
+        if (std::fread(magic, 1, sizeof(magic), in) != sizeof(magic) ||
+            std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+            std::fread(&version, sizeof(version), 1, in) != 1 || version != kVersion ||
+            std::fread(&config_len, sizeof(config_len), 1, in) != 1 || config_len > max_config_len) {
+            serial_front::AddLog("%s ERROR: %s is not a raw capture file.\n", ERROR_CHAR, path.c_str());
+            std::fclose(in);
+            return false;
+        }
+        config.resize(config_len);
+        if (std::fread(config.data(), 1, config_len, in) != config_len) {
+            serial_front::AddLog("%s ERROR: Raw capture %s is truncated.\n", ERROR_CHAR, path.c_str());
+            std::fclose(in);
+            return false;
+        }
+
+        std::vector<uint8_t> data;
+        uint64_t host_time_us = 0;
+        uint32_t len = 0;
+        bool ok = true;
+        while (std::fread(&host_time_us, sizeof(host_time_us), 1, in) == 1 &&
+               std::fread(&len, sizeof(len), 1, in) == 1) {
+            if (len > max_record_len) {
+                serial_front::AddLog("%s ERROR: Raw capture %s has a %u byte record, the file is corrupt.\n",
+                                     ERROR_CHAR, path.c_str(), len);
+                ok = false;
+                break;
+            }
+            data.resize(len);
+            if (std::fread(data.data(), 1, len, in) != len) {
+                break; // Capture cut off in the middle of a record
+            }
+            if (!on_record(host_time_us, data.data(), len)) {
+                break;
+            }
+        }
+
+        std::fclose(in);
+        return ok;
+    }
+} // namespace raw_capture
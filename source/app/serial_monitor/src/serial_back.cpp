@@ -1,13 +1,21 @@
 #include "serial_back.h"
 #include "simple_uart.h"
 #include "serial_front.h"
+#include "file_watch.h"
+#include "console_log.h"
 #include <iostream>
+#include <algorithm>
+#ifdef _WIN32
 #include <windows.h>
+#endif
 #include <thread>
 #include <sstream>
 #include <iomanip>
+#include <memory>
 #include <mutex>
 #include <shared_mutex>
+#include <condition_variable>
+#include <atomic>
 #include <vector>
 #include <cstdint>
 #include <iostream>
@@ -20,41 +28,71 @@
 #include <filesystem>
 #include "json.hpp"
 #include "data_logger.h"
-#include "performance_analysis.h"
+#include "tracing.h"
 #include "elf_parser.h"
+#include "log_decoder.h"
+#include "link_health.h"
+#include "serial_protocol.h"
+#include "raw_capture.h"
 
 using Json = nlohmann::json;
 
-typedef enum {
-    CMD_INVALID         = 0x00,
-    CMD_TOGGLE_LED      = 0x01,
-    CMD_SETUP_FRAME     = 0x02,
-    CMD_SET_FRAME_SIZE  = 0x03,
-    CMD_START_LOG       = 0x04,
-    CMD_STOP_LOG        = 0x05,
-    CMD_NR_OF_CMDS      = 0x06,
-} CommandIndex;
 typedef struct {
     std::string name;
     uint8_t cmd;
 }CommandStruct;
 
+
 std::unordered_map<std::string, FrameStruct> frames;
 
 namespace {
-    DWORD WINAPI SerialMonitoringTask(LPVOID lpParam);
+#ifdef _WIN32
     HANDLE serial_monitor_handle = nullptr;
+#endif
 
     struct simple_uart* uart_instance           = nullptr;
-    FileSymbolMap       parsed_map;
+    // Published symbol map, never modified once published. Readers keep their
+    // snapshot alive, a reload swaps in a new map and then bumps the version.
+    std::shared_ptr<const FileSymbolMap> parsed_map = std::make_shared<const FileSymbolMap>();
+    std::atomic<uint64_t>   parsed_map_version      = 0;
+    std::mutex              parsed_map_mutex;
+
+    // The slow task sleeps until the ELF file is rewritten or it is woken for
+    // a new path, changed settings or exit. It owns settings.elf_file_path,
+    // a new path from the UI is handed over through pending_elf_file_path.
+    FileWatch               elf_watch;
+    std::atomic<bool>       slow_task_running       = false;
+    std::atomic<bool>       settings_dirty          = false;
+    std::mutex              pending_elf_mutex;
+    std::string             pending_elf_file_path;
+    bool                    elf_file_path_pending   = false;
     bool                serial_thread_running   = false;
     bool                serial_thread_exit      = false;
-    bool                log_running             = false;
+    std::atomic<bool>   log_running             = false;   // Written by the replay thread too
     bool                parsing_elf_file        = false;
     int                 baud_rate               = 250000;
     uint8_t             buffer[0xFFFF+1];
     std::string         port_name               = "COM5";
-    SerialBack_Settings settings = {.nm = "", .addr2line = "", .elf_file_path = ""};
+    SerialBack_Settings settings = {.elf_file_path = "", .record_raw = false, .binary_log = false, .ram_window_s = 600};
+
+    // Command channel. The serial thread hands ACK/NACK replies over to the
+    // thread waiting in SendCommand().
+    const int               command_timeout_ms      = 100;
+    const int               command_nack_retries    = 3;
+    std::mutex              reply_mutex;
+    std::condition_variable reply_cv;
+    std::atomic<bool>       waiting_for_reply       = false;
+    uint8_t                 command_reply           = REPLY_NONE;
+    float                   command_latency_ms      = 0.0F;
+
+    // Replay of raw captures, fed through HandleRx() like bytes from the port.
+    std::thread             replay_thread;
+    std::atomic<bool>       replay_running          = false;
+    std::atomic<bool>       replay_exit             = false;
+    // Written by the replay thread, read by the GUI every frame
+    std::atomic<uint64_t>   replay_bytes            = 0;
+    std::atomic<uint64_t>   replay_frames           = 0;
+    std::atomic<double>     replay_seconds          = 0.0;
 
     // Indexed with <enum>CommandIndex
     std::vector<CommandStruct> command_list = {
@@ -100,7 +138,8 @@ namespace {
                 continue;
             }
 
-            FrameVarStruct frame_var = {.name=varName, .size=varStruct.size, .latest_rx=0, .type=varStruct.type};
+            FrameVarStruct frame_var = {.name=varName, .size=varStruct.size, .latest_rx=0, .type=varStruct.type,
+                                        .bit_offset=varStruct.bit_offset, .bit_size=varStruct.bit_size};
             frames[std::to_string(frame_id)].variables.push_back(frame_var);
             frames[std::to_string(frame_id)].id = frame_id;
 
@@ -125,136 +164,77 @@ namespace {
         command_buffer.push_back(0xFF);
     }
 
-
-    typedef enum {
-        LOG_WAITING_START,
-        LOG_FRAME_ID,
-        LOG_RECIEVE_TIME,
-        LOG_RECIEVE_VARIABLES,
-    } DeserializeLogState;
-
-    void DeserializeLog(uint8_t rx_byte) {
-        static DeserializeLogState  deserialize_log_state = LOG_WAITING_START;
-        static int                  rx_cnt          = 0;
-        static uint16_t             variable_cnt    = 0;
-        static int                  frame_id        = 0;
-        static FrameStruct*         current_frame   = nullptr;
-
-        const bool log = false;
-        
-        int var_size;
-
-        performance_analysis::Start(performance_analysis::AnalysisIndex::FUNC_DESERIALIZE_LOG);
-
-        if (!log_running) {
-            // Reset state if not logging
-            deserialize_log_state = LOG_WAITING_START;
-            rx_cnt = 0;
-            variable_cnt = 0;
-            return;
-        }
-
-        switch (deserialize_log_state)
-        {
-        case LOG_WAITING_START:
-            if (rx_byte == 0xFF) {
-                if (log) serial_front::AddLog("%s Log Started Recieved.\n", RX_CHAR, rx_byte);
-                deserialize_log_state = LOG_FRAME_ID;
-            }
-            break;
-
-        case LOG_FRAME_ID: {
-            if (log) serial_front::AddLog("%s Frame ID: %d.\n", RX_CHAR, rx_byte);
-            frame_id = rx_byte;
-
-            auto it = frames.find(std::to_string(frame_id));
-
-            if (it == frames.end()) {
-                serial_front::AddLog("%s ERROR: Received frame ID %d, but it was not configured. Stopping log.\n", ERROR_CHAR, frame_id);
-                serial_back::StopLog();
-                deserialize_log_state = LOG_WAITING_START;
-                rx_cnt = 0;
-                variable_cnt = 0;
-                return;
+    /*
+     * Frame configuration stored in raw captures. Variable order within a frame
+     * is the order on the wire, which is not recoverable from log_variables.
+     */
+    std::string FramesToJson(const std::vector<uint8_t>& setup_command,
+                             const std::unordered_map<std::string, VarStruct>& log_variables) {
+        Json config;
+        config["baud_rate"] = baud_rate;
+        config["setup_command"] = setup_command;
+        config["frames"] = Json::array();
+        for (const auto& [id_str, frame] : frames) {
+            Json frame_json;
+            frame_json["id"] = frame.id;
+            frame_json["variables"] = Json::array();
+            for (const auto& var : frame.variables) {
+                auto it = log_variables.find(var.name);
+                frame_json["variables"].push_back({
+                    {"name", var.name},
+                    {"address", it != log_variables.end() ? it->second.address : 0},
+                    {"size", var.size},
+                    {"type", static_cast<int>(var.type)},
+                    {"bit_offset", var.bit_offset},
+                    {"bit_size", var.bit_size},
+                });
             }
+            config["frames"].push_back(frame_json);
+        }
+        return config.dump();
+    }
 
-            current_frame = &it->second;
 
-            deserialize_log_state = LOG_RECIEVE_TIME;
-            current_frame->latest_timestamp = 0;
-            rx_cnt = 0;
-            break;
+    /*
+     * Helper function.
+     * Hands ACK/NACK over to a waiting SendCommand(). Returns true if the byte was a reply.
+     */
+    bool HandleCommandReply(uint8_t rx_byte) {
+        if (!waiting_for_reply || (rx_byte != REPLY_ACK && rx_byte != REPLY_NACK)) {
+            return false;
         }
-        
-        case LOG_RECIEVE_TIME:
-            // next 4 bytes are time, with most significant byte first
-            current_frame->latest_timestamp |= (static_cast<uint64_t>(rx_byte) << (8 * (3 - rx_cnt)));
-            rx_cnt++;
-            if (rx_cnt >= 4) {
-                // After 4 bytes, we expect to receive variables
-                deserialize_log_state = LOG_RECIEVE_VARIABLES;
-                rx_cnt = 0;
-                variable_cnt = 0;
-                current_frame->latest_timestamp *= 10;
-                if (log) serial_front::AddLog("%s     Frame Time: %lu us.\n", RX_CHAR, current_frame->latest_timestamp);
-            }
-            break;
-
-        case LOG_RECIEVE_VARIABLES:
-            var_size = current_frame->variables[variable_cnt].size;
-            if (rx_cnt == 0) {
-                // Mask to 0.
-                current_frame->variables[variable_cnt].latest_rx = 0;
-            }
-            current_frame->variables[variable_cnt].latest_rx |= 
-                (static_cast<uint32_t>(rx_byte) << (8 * (var_size - 1 - rx_cnt)));
-            rx_cnt++;
-            if (rx_cnt >= var_size) {
-                if (log) serial_front::AddLog("%s     Variable %s, Value: 0x%08X\n",
-                    RX_CHAR, current_frame->variables[variable_cnt].name.c_str(),
-                    current_frame->variables[variable_cnt].latest_rx);
-                variable_cnt++;
-                if (variable_cnt < current_frame->variables.size()) {
-                    // More variables to decode
-                    rx_cnt = 0;
-                } else {
-                    // Done
-                    deserialize_log_state = LOG_FRAME_ID;
-                    data_logger::LogFrame(*current_frame);
-                }
-            }
-            break;
-        
-        default:
-            //TODO error, restart log
-            break;
+        {
+            std::lock_guard<std::mutex> lock(reply_mutex);
+            command_reply = rx_byte;
+            waiting_for_reply = false;
         }
-
-        performance_analysis::End(performance_analysis::AnalysisIndex::FUNC_DESERIALIZE_LOG);
+        reply_cv.notify_one();
+        return true;
     }
 
     /*
      * Helper function.
-     * Inserts recieved bytes into buffer and runs log deserialization.
+     * Runs log deserialization on recieved bytes, from the port or from a replay.
      */
-    void HandleRx(const int read_bytes) {
-        std::ostringstream oss;
-        oss << std::hex << std::setfill('0');
-        for (int i = 0; i < read_bytes; i++) {
-            // Always run the state machine, 
-            // mostly so it can reset when log is turned off.
-            DeserializeLog(buffer[i]);
-
-            // When log runs a lot of data will be recieved.
-            // Don't print anything.
-            if (!log_running || true) {
-                oss << std::setw(2) << static_cast<int>(buffer[i]) << " ";
+    void HandleRx(const uint8_t* data, const int read_bytes) {
+        link_health::ReceivedBytes(read_bytes);
+        if (log_running) {
+            // Replies are outside of log frames, only bytes the decoder skipped can be one
+            log_decoder::Feed(data, read_bytes, [](const uint8_t* skipped, size_t len) {
+                for (size_t i = 0; i < len; i++) {
+                    HandleCommandReply(skipped[i]);
+                }
+            });
+        } else {
+            for (int i = 0; i < read_bytes; i++) {
+                HandleCommandReply(data[i]);
             }
         }
 
-        if (!oss.str().empty() && !log_running) {
-            std::lock_guard<std::mutex> lock(serial_front::mtx);
-            serial_front::AddLog("> %s", oss.str().c_str());
+        // When log runs a lot of data will be recieved.
+        // Don't print anything. The console formats hex only for shown lines.
+        if (read_bytes > 0 && !log_running) {
+            console_log::AddRx(data, static_cast<size_t>(read_bytes));
         }
     }
 
@@ -262,7 +242,7 @@ namespace {
      * Fast task to handle reading of the serial port 
      * and deserialization of the log data.
      */
-    DWORD WINAPI SerialMonitoringTask(LPVOID lpParam) {
+    void SerialMonitoringTask() {
         int             available;
         int             read_bytes          = 0;
         uint32_t        sleep_time          = 10;
@@ -273,6 +253,7 @@ namespace {
         std::chrono::time_point<std::chrono::high_resolution_clock> end_time;
 
         serial_front::AddLog("%s Serial backend thread started.\n", COMMAND_CHAR);
+        TRACE_THREAD_NAME("serial");
 
         serial_thread_running = true;
         while(!serial_thread_exit) {
@@ -284,26 +265,26 @@ namespace {
             available = simple_uart_has_data(uart_instance);
 
             if (available >= sizeof(buffer)) {
+                link_health::BufferOverflow();
                 serial_front::AddLog("%s Overflow, %d bytes available to read, but buffer is only %d bytes.\n", ERROR_CHAR, available, sizeof(buffer));
             }
             if (available > 0) {
-                performance_analysis::Start(performance_analysis::TASK_SERIAL_MONITORING);
+                TRACE_ZONE("SerialRead");
 
                 read_bytes = simple_uart_read(uart_instance, buffer, available);
 
-                performance_analysis::RecievedBytes(read_bytes);
+                TRACE_COUNTER("ReceivedBytes", read_bytes);
 
                 if (read_bytes > 0) {
-                    HandleRx(read_bytes);
+                    raw_capture::Write(buffer, read_bytes);
+                    HandleRx(buffer, read_bytes);
                 } else {
                     serial_front::AddLog("%s ERROR: Failed to read from %s.\n", ERROR_CHAR, port_name.c_str());
                 }
-
-                performance_analysis::End(performance_analysis::TASK_SERIAL_MONITORING);
             }
 
-            // Faster update when log running
-            if (log_running) {
+            // Faster update when log running or a command waits for its reply
+            if (log_running || waiting_for_reply) {
                 sleep_time = sleep_time_logging;
             } else {
                 sleep_time = sleep_time_normal;
@@ -320,10 +301,98 @@ namespace {
         }
         serial_thread_running = false;
         std::cout << "\nSerial backend thread exiting.\n";
+    }
 
+#ifdef _WIN32
+    DWORD WINAPI SerialMonitoringThread(LPVOID lpParam) {
+        (void)lpParam;
+        SerialMonitoringTask();
         return 0;
     }
+#endif
+
+
+/* -------------------------------------------------------------------------- */
+/*                                   Replay                                   */
+/* -------------------------------------------------------------------------- */
+    /*
+     * Restores frames and log variables from the config stored in a raw capture.
+     */
+    bool FramesFromJson(const std::string& config_str,
+                        std::unordered_map<std::string, VarStruct>& log_variables) {
+        Json config;
+        try {
+            config = Json::parse(config_str);
+        } catch (const std::exception& e) {
+            serial_front::AddLog("%s ERROR: Invalid frame config in raw capture: %s\n", ERROR_CHAR, e.what());
+            return false;
+        }
+
+        frames.clear();
+        log_variables.clear();
+        for (const auto& frame_json : config.value("frames", Json::array())) {
+            int const frame_id = frame_json.value("id", 0);
+            FrameStruct& frame = frames[std::to_string(frame_id)];
+            frame.id = frame_id;
+            for (const auto& var_json : frame_json.value("variables", Json::array())) {
+                FrameVarStruct const var = {
+                    .name       = var_json.value("name", ""),
+                    .size       = var_json.value("size", static_cast<size_t>(4)),
+                    .latest_rx  = 0,
+                    .type       = static_cast<VariableType>(var_json.value("type", 0)),
+                    .bit_offset = var_json.value("bit_offset", static_cast<uint8_t>(0)),
+                    .bit_size   = var_json.value("bit_size", static_cast<uint8_t>(0)),
+                };
+                frame.variables.push_back(var);
+                log_variables[var.name] = {
+                    .address    = var_json.value("address", static_cast<uint32_t>(0)),
+                    .size       = var.size,
+                    .frame      = frame_id,
+                    .type       = var.type,
+                    .bit_offset = var.bit_offset,
+                    .bit_size   = var.bit_size,
+                };
+            }
+        }
+        return !log_variables.empty();
+    }
+
+    void ReplayTask(std::string path, bool real_time) {
+        TRACE_THREAD_NAME("replay");
+        std::string config;
+        auto start_time = std::chrono::steady_clock::now();
 
+        bool const complete = raw_capture::ReadCapture(path, config,
+            [&](uint64_t host_time_us, const uint8_t* data, size_t len) {
+                if (real_time) {
+                    std::this_thread::sleep_until(start_time + std::chrono::microseconds(host_time_us));
+                }
+                HandleRx(data, static_cast<int>(len));
+                replay_bytes.fetch_add(len, std::memory_order_relaxed);
+                return !replay_exit;
+            });
+
+        log_running = false;
+        auto elapsed = std::chrono::steady_clock::now() - start_time;
+        ReplayStats const stats = {
+            .bytes   = replay_bytes,
+            .frames  = link_health::GetStats().frames,
+            .seconds = std::chrono::duration<double>(elapsed).count(),
+        };
+        replay_seconds = stats.seconds;
+        replay_frames  = stats.frames;
+        data_logger::SaveLog();
+
+        double const seconds = std::max(stats.seconds, 1e-9);
+        serial_front::AddLog("%s Replay %s, %llu bytes, %llu frames in %.3f s (%.2f MB/s, %.0f frames/s).\n",
+                             COMMAND_CHAR, complete ? "done" : "stopped",
+                             static_cast<unsigned long long>(stats.bytes),
+                             static_cast<unsigned long long>(stats.frames),
+                             stats.seconds,
+                             static_cast<double>(stats.bytes) / seconds / 1e6,
+                             static_cast<double>(stats.frames) / seconds);
+        replay_running = false;
+    }
 
 /* -------------------------------------------------------------------------- */
 /*                              Slow update tasks                             */
@@ -337,8 +406,9 @@ namespace {
         settings_out["baud_rate"] = baud_rate;
         settings_out["port_name"] = port_name;
         settings_out["elf_file_path"] = settings.elf_file_path;
-        settings_out["nm"] = settings.nm;
-        settings_out["addr2line"] = settings.addr2line;
+        settings_out["record_raw"] = settings.record_raw;
+        settings_out["binary_log"] = settings.binary_log;
+        settings_out["ram_window_s"] = settings.ram_window_s;
         std::ofstream out(settings_path);
         out << settings_out.dump(4);
         out.close();
@@ -362,13 +432,14 @@ namespace {
             settings_json["baud_rate"] = 250000;
             settings_json["port_name"] = "COM5";
             settings_json["elf_file_path"] = "-";
-            settings_json["nm"] = "-";
-            settings_json["addr2line"] = "-";
         }
 
         settings_file.close();
         baud_rate = settings_json.value("baud_rate", 250000);
         port_name = settings_json.value("port_name", "COM5");
+        settings.record_raw = settings_json.value("record_raw", false);
+        settings.binary_log = settings_json.value("binary_log", false);
+        settings.ram_window_s = settings_json.value("ram_window_s", 600);
 
         if (settings_json.contains("elf_file_path")) {
             settings.elf_file_path = settings_json["elf_file_path"];
@@ -379,46 +450,61 @@ namespace {
         } else {
             settings.elf_file_path = "-";
         }
-        if (settings_json.contains("nm")) {
-            settings.nm = settings_json["nm"];
-            // if empty, set to "-"
-            if (settings.nm.empty()) {
-                settings.nm = "-";
-            }
-        } else {
-            settings.nm = "-";
-        }
-        if (settings_json.contains("addr2line")) {
-            settings.addr2line = settings_json["addr2line"];
-            // if empty, set to "-"
-            if (settings.addr2line.empty()) {
-                settings.addr2line = "-";
-            }
-        } else {
-            settings.addr2line = "-";
+    }
+
+    void PublishParsedMap() {
+        auto map = std::make_shared<FileSymbolMap>();
+        elf_parser::LoadSymbolMap(*map);
+        {
+            std::lock_guard<std::mutex> lock(parsed_map_mutex);
+            parsed_map = std::move(map);
         }
+        parsed_map_version++;
     }
 
     void SlowTask() {
-        static bool elf_file_changed_old = false;
-        bool elf_file_changed;
-
-        while(!serial_thread_exit) {
-            elf_file_changed = elf_parser::ElfFileChanged(settings.elf_file_path);
+        TRACE_THREAD_NAME("slow task");
+        std::string watched_path;
+        bool parse = true;
+
+        while (!serial_thread_exit) {
+            {
+                std::lock_guard<std::mutex> lock(pending_elf_mutex);
+                if (elf_file_path_pending) {
+                    settings.elf_file_path = pending_elf_file_path;
+                    elf_file_path_pending = false;
+                }
+            }
+            if (settings.elf_file_path != watched_path) {
+                watched_path = settings.elf_file_path;
+                bool const no_file = watched_path.empty() || watched_path == "-";
+                file_watch::SetPath(elf_watch, no_file ? "" : watched_path);
+                parse = !no_file;
+            }
 
-            if ( (elf_file_changed_old && !elf_file_changed) ) {
+            if (parse && !std::filesystem::exists(watched_path)) {
+                // Parsed once the file is written
+                serial_front::AddLog("%s ERROR: elf file %s does not exist.\n", INFO_CHAR, watched_path.c_str());
+            } else if (parse) {
+                TRACE_ZONE("ParseElf");
                 parsing_elf_file = true;
-                elf_parser::ParseElfFile();
-                elf_parser::FileSymbolMapFromJson(parsed_map);
+                if (elf_parser::ParseElfFile()) {
+                    PublishParsedMap();
+                }
                 parsing_elf_file = false;
             }
 
-            elf_file_changed_old = elf_file_changed;
+            if (settings_dirty.exchange(false)) {
+                SaveSettings();
+            }
+
+            parse = file_watch::Wait(elf_watch);
+        }
 
+        if (settings_dirty.exchange(false)) {
             SaveSettings();
-
-            std::this_thread::sleep_for(std::chrono::milliseconds(500));
         }
+        slow_task_running = false;
     }
 /* -------------------------------------------------------------------------- */
 /*                            End Slow update tasks                           */
@@ -427,22 +513,30 @@ namespace {
 
 namespace serial_back {
     void SetElfFilePath(const std::string& path) {
-        settings.elf_file_path = path;
+        {
+            std::lock_guard<std::mutex> lock(pending_elf_mutex);
+            pending_elf_file_path = path;
+            elf_file_path_pending = true;
+        }
+        MarkSettingsDirty();
+    }
+
+    void MarkSettingsDirty() {
+        settings_dirty = true;
+        file_watch::Wake(elf_watch);
     }
 
     bool Send(const std::vector<uint8_t>& data) {
-        static uint8_t tx_byte = 0;
-        const int tx_wait_ms = 1;
         if (uart_instance) {
-            ssize_t written;
-            for (size_t i = 0; i < data.size(); i++) {
-                tx_byte = data[i];
-                std::this_thread::sleep_for(std::chrono::milliseconds(tx_wait_ms));
-                written = simple_uart_write(uart_instance, &tx_byte, 1);
+            // Whole buffer in as few writes as possible, the device buffers a complete command.
+            size_t sent = 0;
+            while (sent < data.size()) {
+                ssize_t written = simple_uart_write(uart_instance, data.data() + sent, data.size() - sent);
                 if (written < 0) {
                     serial_front::AddLog("%s ERROR: Failed to write to %s.\n", ERROR_CHAR, port_name.c_str());
                     return false;
                 }
+                sent += static_cast<size_t>(written);
             }
         } else {
             serial_front::AddLog("%s ERROR: Port %s is not opened.\n", ERROR_CHAR, port_name.c_str());
@@ -450,6 +544,56 @@ namespace serial_back {
         }
         return true;
     }
+
+    /*
+     * Sends a complete command and waits for the device to ACK it.
+     * A NACK resends the command, no reply within the timeout is a failure.
+     */
+    bool SendCommand(const std::vector<uint8_t>& command) {
+        if (command.empty()) {
+            return false;
+        }
+
+        for (int attempt = 1; attempt <= command_nack_retries; attempt++) {
+            {
+                std::lock_guard<std::mutex> lock(reply_mutex);
+                command_reply = REPLY_NONE;
+                waiting_for_reply = true;
+            }
+
+            auto start_time = std::chrono::steady_clock::now();
+            if (!Send(command)) {
+                waiting_for_reply = false;
+                return false;
+            }
+
+            std::unique_lock<std::mutex> lock(reply_mutex);
+            bool replied = reply_cv.wait_for(lock, std::chrono::milliseconds(command_timeout_ms),
+                                             [] { return command_reply != REPLY_NONE; });
+            waiting_for_reply = false;
+            auto rtt = std::chrono::steady_clock::now() - start_time;
+            float rtt_ms = std::chrono::duration<float, std::milli>(rtt).count();
+
+            if (!replied) {
+                serial_front::AddLog("%s ERROR: No reply to command 0x%02X within %d ms.\n",
+                                     ERROR_CHAR, command[0], command_timeout_ms);
+                return false;
+            }
+            if (command_reply == REPLY_ACK) {
+                command_latency_ms = rtt_ms;
+                serial_front::AddLog("%s ACK for command 0x%02X, %zu bytes in %.2f ms.\n",
+                                     RX_CHAR, command[0], command.size(), rtt_ms);
+                return true;
+            }
+            serial_front::AddLog("%s NACK for command 0x%02X (attempt %d/%d).\n",
+                                 ERROR_CHAR, command[0], attempt, command_nack_retries);
+        }
+        return false;
+    }
+
+    float GetCommandLatency() {
+        return command_latency_ms;
+    }
     
     void GetPorts(std::vector<std::string>& ports) {
         char **names;
@@ -468,12 +612,13 @@ namespace serial_back {
         // Only if port is not opened
         if (!uart_instance) {
             port_name = port;
+            MarkSettingsDirty();
             return true;
         }
         return false;
     }
     void GetPortName(std::string& port)       {port      = port_name;}
-    void SetBaudRate(int baud)                {baud_rate = baud;}
+    void SetBaudRate(int baud)                {baud_rate = baud; MarkSettingsDirty();}
     int  GetBaudRate()                        {return baud_rate;}
     
     bool OpenSerialPort() {
@@ -504,13 +649,19 @@ namespace serial_back {
     }
 
     void SerialInit() {
+        file_watch::Open(elf_watch);
         LoadSettings();
 
-        serial_monitor_handle = CreateThread(NULL, 0, SerialMonitoringTask, NULL, 0, NULL);
+#ifdef _WIN32
+        serial_monitor_handle = CreateThread(NULL, 0, SerialMonitoringThread, NULL, 0, NULL);
         SetThreadPriority(serial_monitor_handle, THREAD_PRIORITY_TIME_CRITICAL);
+#else
+        std::thread serial_thread(SerialMonitoringTask);
+        serial_thread.detach();
+#endif
 
-        elf_parser::FileSymbolMapFromJson(parsed_map);
-
+        // Loads the configured build right away, from the cache when seen before
+        slow_task_running = true;
         std::thread slow_task_thread(SlowTask);
         slow_task_thread.detach();
     }
@@ -522,15 +673,23 @@ namespace serial_back {
             uart_instance = nullptr;
         }
         
-        if (log_running) {
+        if (replay_running) {
+            StopLog();
+        } else if (log_running) {
             data_logger::SaveLog();
         }
+        if (replay_thread.joinable()) {
+            replay_thread.join();
+        }
+        data_logger::DeInit();
 
         serial_thread_exit = true;
-        // Just to get graceful closing of port
-        while (serial_thread_running) {
+        file_watch::Wake(elf_watch);
+        // Just to get graceful closing of port, the slow task saves changed settings
+        while (serial_thread_running || slow_task_running) {
             std::this_thread::sleep_for(std::chrono::milliseconds(10));
         }
+        file_watch::Close(elf_watch);
     }
 
     void StartLog(std::unordered_map<std::string, VarStruct> log_variables) {
@@ -541,8 +700,6 @@ namespace serial_back {
 
         BuildFramesCommand(command_buffer, log_variables);
 
-        command_buffer.push_back(command_list[CMD_START_LOG].cmd);
-
         // print command to console as hex string
         std::ostringstream oss;
         oss << std::hex << std::setfill('0');
@@ -551,24 +708,111 @@ namespace serial_back {
         }
         serial_front::AddLog("%s %s\n", TX_CHAR, oss.str().c_str());
 
-        if (Send(command_buffer)) {
-            data_logger::init(log_variables);
-            log_running = true;
+        if (!SendCommand(command_buffer)) {
+            serial_front::AddLog("%s ERROR: Frame setup was not acknowledged, log not started.\n", ERROR_CHAR);
+            return;
+        }
+
+        // Log must be running before the start command, the first frame follows the ACK directly.
+        log_decoder::Configure(frames);
+        data_logger::init(log_variables);
+        if (settings.record_raw) {
+            std::filesystem::path raw_path(data_logger::GetLogFilePath());
+            raw_path.replace_extension(".jvraw");
+            raw_capture::Start(raw_path.string(), FramesToJson(command_buffer, log_variables));
         }
+        log_running = true;
+
+        serial_front::AddLog("%s %02x\n", TX_CHAR, command_list[CMD_START_LOG].cmd);
+        if (!SendCommand({command_list[CMD_START_LOG].cmd})) {
+            serial_front::AddLog("%s ERROR: Start log was not acknowledged.\n", ERROR_CHAR);
+            log_running = false;
+            raw_capture::Stop();
+            data_logger::SaveLog();
+        }
+    }
+
+    /*
+     * Plays back a raw capture through the same decode path as the port,
+     * either paced by the recorded host time or as fast as possible.
+     */
+    bool StartReplay(const std::string& path, bool real_time) {
+        if (log_running || uart_instance) {
+            serial_front::AddLog("%s ERROR: Close the port before replaying a capture.\n", ERROR_CHAR);
+            return false;
+        }
+        if (replay_thread.joinable()) {
+            replay_thread.join();
+        }
+
+        // Only the config is needed here, records are read by the replay thread.
+        std::string config;
+        if (!raw_capture::ReadCapture(path, config, [](uint64_t, const uint8_t*, size_t) { return false; })) {
+            return false;
+        }
+        std::unordered_map<std::string, VarStruct> log_variables;
+        if (!FramesFromJson(config, log_variables)) {
+            serial_front::AddLog("%s ERROR: No frames configured in %s\n", ERROR_CHAR, path.c_str());
+            return false;
+        }
+
+        log_decoder::Configure(frames);
+        data_logger::init(log_variables);
+        replay_bytes   = 0;
+        replay_frames  = 0;
+        replay_seconds = 0.0;
+        replay_exit    = false;
+        replay_running = true;
+        log_running    = true;
+
+        serial_front::AddLog("%s Replaying %s (%s)\n", COMMAND_CHAR, path.c_str(),
+                             real_time ? "real time" : "max speed");
+        replay_thread = std::thread(ReplayTask, path, real_time);
+        return true;
+    }
+
+    bool IsReplayRunning() {
+        return replay_running;
+    }
+
+    ReplayStats GetReplayStats() {
+        return {.bytes = replay_bytes, .frames = replay_frames, .seconds = replay_seconds};
     }
 
     void StopLog() {
-        if (log_running) {
+        if (replay_running) {
+            replay_exit = true;
+            replay_thread.join();
+            return;
+        }
+
+        // Frames keep coming until the device has the stop command, so they still go
+        // through the decoder and only skipped bytes can complete the wait for the reply.
+        serial_front::AddLog("%s %02x\n", TX_CHAR, command_list[CommandIndex::CMD_STOP_LOG].cmd);
+        SendCommand({command_list[CommandIndex::CMD_STOP_LOG].cmd});
+        bool const was_running = log_running.exchange(false);
+        raw_capture::Stop();
+
+        if (was_running) {
             data_logger::SaveLog();
+
+            LinkHealthStats const stats = link_health::GetStats();
+            serial_front::AddLog("%s Log stopped, %llu frames decoded.\n", COMMAND_CHAR,
+                                 static_cast<unsigned long long>(stats.frames));
+            if (stats.crc_errors + stats.length_errors + stats.unknown_ids > 0) {
+                serial_front::AddLog("%s   Skipped %llu CRC errors, %llu length errors, %llu unknown frame ids, %llu bytes.\n",
+                                     ERROR_CHAR,
+                                     static_cast<unsigned long long>(stats.crc_errors),
+                                     static_cast<unsigned long long>(stats.length_errors),
+                                     static_cast<unsigned long long>(stats.unknown_ids),
+                                     static_cast<unsigned long long>(stats.skipped_bytes));
+            }
+            if (stats.missed_frames > 0) {
+                serial_front::AddLog("%s   %llu timestamp gaps, about %llu frames missed.\n", ERROR_CHAR,
+                                     static_cast<unsigned long long>(stats.timestamp_gaps),
+                                     static_cast<unsigned long long>(stats.missed_frames));
+            }
         }
-        std::vector<uint8_t> command_buffer;
-        command_buffer.push_back(command_list[CommandIndex::CMD_STOP_LOG].cmd);
-        std::ostringstream oss;
-        oss << std::hex << std::setfill('0');
-        oss << std::setw(2) << static_cast<int>(command_list[CommandIndex::CMD_STOP_LOG].cmd);
-        serial_front::AddLog("%s %s\n", TX_CHAR, oss.str().c_str());
-        Send(command_buffer);
-        log_running = false;
     }
 
     bool IsLogRunning() {
@@ -579,10 +823,15 @@ namespace serial_back {
         return parsing_elf_file;
     }
 
-    FileSymbolMap GetParsedMap() {
+    std::shared_ptr<const FileSymbolMap> GetParsedMap() {
+        std::lock_guard<std::mutex> lock(parsed_map_mutex);
         return parsed_map;
     }
 
+    uint64_t GetParsedMapVersion() {
+        return parsed_map_version;
+    }
+
     SerialBack_Settings* GetSettings() {
         return &settings;
     }
@@ -12,11 +12,15 @@
 #include <chrono>
 #include "ImGuiFileDialog.h"
 #include "data_logger.h"
+#include "link_health.h"
+#include <algorithm>
 #include <regex>
 #include "elf_parser.h"
 #include "performance_analysis.h"
 #include "data_logger.h"
 #include "log_reader.h"
+#include "symbol_search.h"
+#include "console_log.h"
 
 namespace {
     bool show_console = true;
@@ -24,11 +28,14 @@ namespace {
     bool show_port_menu = false;
     bool port_opened = false;
     bool show_performance_window = false;
+    bool show_link_health = false;
 
-    static ImVector<char*> Items;
+    static uint64_t console_start = 0;   // First console line shown, moved by Clear
     static char InputBuf[256];
     static bool AutoScroll = true;
-    static FileSymbolMap parsed_map;
+    std::shared_ptr<const FileSymbolMap> parsed_map = std::make_shared<const FileSymbolMap>();
+    uint64_t parsed_map_version = 0;
+    SymbolIndex symbol_index;
     static std::string elf_file_path;
     std::unordered_map<std::string, VarStruct> log_variables;
     Data* log;
@@ -50,6 +57,9 @@ namespace {
             if (ImGui::MenuItem("Performance")) {
                 show_performance_window = true;
             }
+            if (ImGui::MenuItem("Link Health")) {
+                show_link_health = true;
+            }
             ImGui::EndMenu();
         }
 
@@ -107,6 +117,31 @@ namespace {
                     }
                 }
 
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::Text("Record Raw Capture");
+                ImGui::TableSetColumnIndex(1);
+                if (ImGui::Checkbox("##RecordRaw", &serial_back::GetSettings()->record_raw)) {
+                    serial_back::MarkSettingsDirty();
+                }
+
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::Text("Binary Log (.jvbl)");
+                ImGui::TableSetColumnIndex(1);
+                if (ImGui::Checkbox("##BinaryLog", &serial_back::GetSettings()->binary_log)) {
+                    serial_back::MarkSettingsDirty();
+                }
+
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::Text("RAM Window [s] (0 = all)");
+                ImGui::TableSetColumnIndex(1);
+                if (ImGui::InputInt("##RamWindow", &serial_back::GetSettings()->ram_window_s, 0, 0)) {
+                    serial_back::GetSettings()->ram_window_s = std::max(serial_back::GetSettings()->ram_window_s, 0);
+                    serial_back::MarkSettingsDirty();
+                }
+
                 ImGui::EndTable();
 
                 port_opened = serial_back::IsPortOpen();
@@ -166,16 +201,27 @@ namespace {
         if (show_console) {
             ImGui::Begin("Console", &show_console, ImGuiWindowFlags_NoScrollbar);
             if (ImGui::Button("Clear")) {
-            for (int i = 0; i < Items.Size; i++) free(Items[i]);
-                Items.clear();
+                console_start = console_log::End();
             }
 
             ImGui::Separator();
 
             ImGui::BeginChild("ScrollingRegion", ImVec2(0, -ImGui::GetFrameHeightWithSpacing()-5), false,
                             ImGuiWindowFlags_HorizontalScrollbar);
-            for (int i = 0; i < Items.Size; i++)
-                ImGui::TextUnformatted(Items[i]);
+            // Only the visible lines are read back from the ring and formatted
+            uint64_t const end = console_log::End();
+            uint64_t const first = std::max(console_start, end > kConsoleLines ? end - kConsoleLines : 0);
+            char line[kConsoleLineSize];
+            ImGuiListClipper clipper;
+            clipper.Begin(static_cast<int>(end - first));
+            while (clipper.Step()) {
+                for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                    if (!console_log::ReadLine(first + i, line, sizeof(line))) {
+                        line[0] = '\0';
+                    }
+                    ImGui::TextUnformatted(line);
+                }
+            }
             if (AutoScroll && ImGui::GetScrollY() >= ImGui::GetScrollMaxY())
                 ImGui::SetScrollHereY(1.0f);
             ImGui::EndChild();
@@ -211,8 +257,32 @@ namespace {
         return value_str;
     }
 
+    // Points the selected variables at the new map, a rebuild may have moved them
+    void RefreshLogVariables() {
+        for (auto it = log_variables.begin(); it != log_variables.end();) {
+            const VarStruct* found = nullptr;
+            for (const auto& [file, vars] : *parsed_map) {
+                auto var = vars.find(it->first);
+                if (var != vars.end()) {
+                    found = &var->second;
+                    break;
+                }
+            }
+            if (found == nullptr) {
+                serial_front::AddLog("%s Removed variable %s from log variables, not found in parsed map.", COMMAND_CHAR, it->first.c_str());
+                it = log_variables.erase(it);
+                continue;
+            }
+            int const frame = it->second.frame;
+            it->second = *found;
+            it->second.frame = frame;
+            it++;
+        }
+    }
+
     void VariableTable(char search_buf[]){
         std::vector<const char*> frames = {"frame 0", "frame 1", "frame 2"};
+        std::vector<std::string> const variable_types = elf_parser::GetVariableTypes();
 
         if (ImGui::BeginTable("MapTable", 6, 
                 ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable | ImGuiTableFlags_NoSavedSettings)) {
@@ -226,92 +296,189 @@ namespace {
 
             log = data_logger::GetLogData();
 
-            bool selected = false;
-            std::string check_label;
-            int selected_frame_index = 0;
-            for (const auto& [file, vars] : parsed_map) {
-                for (const auto& [varName, varStruct] : vars) {
-                    // Filter by user search
-                    if (strlen(search_buf) > 0 && 
-                        (file.find(search_buf) == std::string::npos && 
-                            varName.find(search_buf) == std::string::npos)) {
-                        continue;
-                    }
-
-                    // Mark the logging variables as selected
-                    if (log_variables.find(varName) != log_variables.end()) {
-                        selected = true;
-                    } else {
-                        selected = false;
-                    }
+            // Filter by user search, the index keeps the result between frames
+            const std::vector<uint32_t>* rows = &symbol_search::Search(symbol_index, search_buf);
 
-                    // When log is running, only show the selected variables.
-                    if (serial_back::IsLogRunning() && !selected) {
-                        continue;
+            // When log is running, only show the selected variables.
+            std::vector<uint32_t> logged_rows;
+            if (serial_back::IsLogRunning()) {
+                for (uint32_t row : *rows) {
+                    if (log_variables.contains(*symbol_index.entries[row].name)) {
+                        logged_rows.push_back(row);
                     }
+                }
+                rows = &logged_rows;
+            }
 
-                    // Get value from log if it exists
-                    std::string value = "-";
-                    if (log->signals.find(varName) != log->signals.end()) {
-                        auto& values = log->signals[varName];
-                        if (!values.empty()) {
-                            value = GetFormattedValue(values.back());
+            // Only the visible rows are submitted
+            ImGuiListClipper clipper;
+            clipper.Begin(static_cast<int>(rows->size()));
+            while (clipper.Step()) {
+                // Latest values of the visible rows, the serial thread appends to the log meanwhile
+                std::vector<std::string> values(clipper.DisplayEnd - clipper.DisplayStart, "-");
+                {
+                    auto const log_lock = data_logger::LockLogData();
+                    for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                        auto signal = log->signals.find(*symbol_index.entries[(*rows)[row]].name);
+                        if (signal != log->signals.end() && !signal->second.empty()) {
+                            values[row - clipper.DisplayStart] = GetFormattedValue(signal->second.back());
                         }
                     }
+                }
+
+                for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                    const SymbolEntry& entry = symbol_index.entries[(*rows)[row]];
+                    const std::string& varName = *entry.name;
+                    const VarStruct& varStruct = *entry.var;
+                    auto logged = log_variables.find(varName);
+                    bool selected = logged != log_variables.end();
+                    const std::string& value = values[row - clipper.DisplayStart];
 
-                    check_label = "##" + varName + "_" + "selected_label";
+                    ImGui::PushID(row);
                     ImGui::TableNextRow();
                     ImGui::TableSetColumnIndex(0);
 
-                    ImGui::Checkbox(check_label.c_str(), &selected);
                     // Only allowed to add/remove when not loggning.
-                    if (!serial_back::IsLogRunning()) {
+                    ImGui::BeginDisabled(varStruct.type == TYPE_UNKNOWN && !selected);
+                    bool const toggled = ImGui::Checkbox("##selected", &selected);
+                    ImGui::EndDisabled();
+                    if (toggled && !serial_back::IsLogRunning()) {
                         if (selected) {
-                            selected_frame_index = log_variables[varName].frame;
                             log_variables[varName] = varStruct; // Add to log variables
-                            log_variables[varName].frame = selected_frame_index;
                         } else {
-                            selected = false;
                             log_variables.erase(varName); // Remove from log variables
                         }
+                        logged = log_variables.find(varName);
                     }
 
                     ImGui::TableSetColumnIndex(1);
-                    ImGui::Text("%s", file.c_str());
+                    ImGui::TextUnformatted(entry.file->c_str());
                     ImGui::TableSetColumnIndex(2); // Variable Name column
-                    ImGui::Text("%s", varName.c_str());
+                    ImGui::TextUnformatted(varName.c_str());
 
                     ImGui::TableSetColumnIndex(3); // Frame column
-                    std::string tag = "##PortCombo" + varName;
                     ImGui::SetNextItemWidth(120.0F);
-                    if (log_variables.contains(varName)) {
-                        selected_frame_index = log_variables[varName].frame;
-                    } else {
-                        selected_frame_index = 0;
-                    }
-                    if(ImGui::Combo(tag.c_str(), &selected_frame_index, frames.data(), frames.size()))
-                    if (log_variables.contains(varName)) {
-                        log_variables[varName].frame = selected_frame_index;
+                    int selected_frame_index = logged != log_variables.end() ? logged->second.frame : 0;
+                    if (ImGui::Combo("##frame", &selected_frame_index, frames.data(), frames.size()) &&
+                        logged != log_variables.end()) {
+                        logged->second.frame = selected_frame_index;
                     }
-                    
-                    
+
                     ImGui::TableSetColumnIndex(4); // Type column
                     VariableType type = varStruct.type;
-                    std::string type_str;
-                    if (type < VariableType::TYPE_NUM_OF_TYPES) {
-                        type_str = elf_parser::GetVariableTypes()[type];
+                    std::string const type_str = type < VariableType::TYPE_NUM_OF_TYPES ?
+                                                 variable_types[type] : "Unknown";
+                    if (varStruct.bit_size != 0) {
+                        ImGui::Text("%s : %u", type_str.c_str(), varStruct.bit_size);
                     } else {
-                        type_str = "Unknown";
+                        ImGui::TextUnformatted(type_str.c_str());
                     }
-                    ImGui::Text("%s", type_str.c_str());
                     ImGui::TableSetColumnIndex(5);
-                    ImGui::Text("%s", value.c_str());
+                    ImGui::TextUnformatted(value.c_str());
+                    ImGui::PopID();
                 }
             }
             ImGui::EndTable();
         }
     }
 
+    void ReplayButton() {
+        static bool replay_real_time = false;
+
+        ImGui::BeginDisabled(serial_back::IsLogRunning());
+        if (ImGui::Button("Replay")) {
+            IGFD::FileDialogConfig config;
+            config.path = "logs";
+            ImGuiFileDialog::Instance()->OpenDialog("ChooseFileReplay", "Choose Raw Capture", ".jvraw", config);
+        }
+        ImGui::SameLine();
+        ImGui::Checkbox("Real Time", &replay_real_time);
+        ImGui::EndDisabled();
+
+        if (ImGuiFileDialog::Instance()->Display("ChooseFileReplay")) {
+            if (ImGuiFileDialog::Instance()->IsOk()) {
+                serial_back::StartReplay(ImGuiFileDialog::Instance()->GetFilePathName(), replay_real_time);
+            }
+            ImGuiFileDialog::Instance()->Close();
+        }
+    }
+
+    /*
+     * Live link statistics. Rates are taken from the change in counters
+     * over the last second, the per frame id rates from device timestamps.
+     */
+    void LinkHealth() {
+        static LinkHealthStats previous = {};
+        static double rx_rate = 0.0;
+        static double frame_rate = 0.0;
+
+        LinkHealthStats const stats = link_health::GetStats();
+        if (stats.seconds < previous.seconds || stats.rx_bytes < previous.rx_bytes) {
+            previous = {};
+        }
+        double const dt = stats.seconds - previous.seconds;
+        if (dt >= 1.0) {
+            rx_rate    = static_cast<double>(stats.rx_bytes - previous.rx_bytes) / dt;
+            frame_rate = static_cast<double>(stats.frames - previous.frames) / dt;
+            previous   = stats;
+        }
+
+        ImGui::Begin("Link Health", &show_link_health);
+
+        if (ImGui::BeginTable("LinkTable", 2, ImGuiTableFlags_RowBg)) {
+            ImGui::TableSetupColumn("Counter", ImGuiTableColumnFlags_WidthStretch, 1.0f);
+            ImGui::TableSetupColumn("Value", ImGuiTableColumnFlags_WidthFixed, 120.0f);
+            auto row = [](const char* name, const char* fmt, auto value) {
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::TextUnformatted(name);
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text(fmt, value);
+            };
+            row("RX bytes/s", "%.0f", rx_rate);
+            row("Frames/s", "%.0f", frame_rate);
+            row("RX bytes", "%llu", static_cast<unsigned long long>(stats.rx_bytes));
+            row("Frames", "%llu", static_cast<unsigned long long>(stats.frames));
+            row("CRC errors", "%llu", static_cast<unsigned long long>(stats.crc_errors));
+            row("Length errors", "%llu", static_cast<unsigned long long>(stats.length_errors));
+            row("Unknown ids", "%llu", static_cast<unsigned long long>(stats.unknown_ids));
+            row("Skipped bytes", "%llu", static_cast<unsigned long long>(stats.skipped_bytes));
+            row("Buffer overflows", "%llu", static_cast<unsigned long long>(stats.buffer_overflows));
+            row("Timestamp gaps", "%llu", static_cast<unsigned long long>(stats.timestamp_gaps));
+            row("Missed frames", "%llu", static_cast<unsigned long long>(stats.missed_frames));
+            ImGui::EndTable();
+        }
+
+        ImGui::SeparatorText("Frame ids");
+        if (ImGui::BeginTable("FrameHealthTable", 6, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders)) {
+            ImGui::TableSetupColumn("Id");
+            ImGui::TableSetupColumn("Frames");
+            ImGui::TableSetupColumn("Expected Hz");
+            ImGui::TableSetupColumn("Observed Hz");
+            ImGui::TableSetupColumn("Gaps");
+            ImGui::TableSetupColumn("Missed");
+            ImGui::TableHeadersRow();
+            for (const auto& frame : stats.frame_ids) {
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::Text("%d", frame.id);
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("%llu", static_cast<unsigned long long>(frame.frames));
+                ImGui::TableSetColumnIndex(2);
+                ImGui::Text("%.1f", frame.expected_hz);
+                ImGui::TableSetColumnIndex(3);
+                ImGui::Text("%.1f", frame.observed_hz);
+                ImGui::TableSetColumnIndex(4);
+                ImGui::Text("%llu", static_cast<unsigned long long>(frame.gaps));
+                ImGui::TableSetColumnIndex(5);
+                ImGui::Text("%llu", static_cast<unsigned long long>(frame.missed_frames));
+            }
+            ImGui::EndTable();
+        }
+
+        ImGui::End();
+    }
+
     void MapParser() {
         static bool file_dialog = false;
         static uint32_t cnt = 0;
@@ -325,7 +492,7 @@ namespace {
                 file_dialog = true;
             }
             if (file_dialog) {
-                ImGuiFileDialog::Instance()->OpenDialog("ChooseFileMap", "Choose File", ".elf");
+                ImGuiFileDialog::Instance()->OpenDialog("ChooseFileMap", "Choose File", ".elf,.jvsym");
                 file_dialog = false;
             }
             if (ImGuiFileDialog::Instance()->Display("ChooseFileMap")) {
@@ -362,6 +529,8 @@ namespace {
                     serial_back::StopLog();
                 }
             }
+            ImGui::SameLine();
+            ReplayButton();
             /* ------------------------- END TOP BAR ------------------------ */
 
             if (ImGui::BeginChild("MapContent", ImVec2(0, 0), false,
@@ -382,7 +551,7 @@ namespace {
                     } else {
                         cnt = 0; // Reset counter after a few seconds
                     }  
-                } else if (!parsed_map.empty()) {
+                } else if (!parsed_map->empty()) {
                     cnt = 0;
                     VariableTable(search_buf);
                 } else {
@@ -399,8 +568,6 @@ namespace {
 } // namespace anonymous
 
 namespace serial_front {
-    std::mutex mtx;
-
     void SerialWindow() {
         MenuBar();
         Console();
@@ -408,21 +575,15 @@ namespace serial_front {
         if (show_performance_window) {
             performance_analysis::PerformanceWindow(show_performance_window);
         }
-        parsed_map = serial_back::GetParsedMap();
-        // remove entries in log_variables that are not in parsed_map
-        for (auto it = log_variables.begin(); it != log_variables.end(); it++) {
-            // check in each file in parsed_map
-            bool found = false;
-            for (const auto& [file, vars] : parsed_map) {
-                if (vars.find(it->first) != vars.end()) {
-                    found = true;
-                    break;
-                }
-            }
-            if (!found) {
-                log_variables.erase(it); // Remove if not found
-                AddLog("%s Removed variable %s from log variables, not found in parsed map.", COMMAND_CHAR, it->first.c_str());
-            }
+        if (show_link_health) {
+            LinkHealth();
+        }
+        uint64_t const version = serial_back::GetParsedMapVersion();
+        if (version != parsed_map_version) {
+            parsed_map_version = version;
+            parsed_map = serial_back::GetParsedMap();
+            symbol_search::Build(symbol_index, *parsed_map);
+            RefreshLogVariables();
         }
     }
 
@@ -432,7 +593,7 @@ namespace serial_front {
         va_start(args, fmt);
         vsnprintf(buf, IM_ARRAYSIZE(buf), fmt, args);
         va_end(args);
-        Items.push_back(strdup(buf));
+        console_log::AddText(buf);
     }
 
 } // namespace serial_front
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include "serial_protocol.h"
+
+#include <array>
+
+namespace {
+    /*
+     * CRC-16/CCITT-FALSE, polynomial 0x1021, sliced by four: table[k][i] is the
+     * CRC of byte i followed by k zero bytes, so four bytes take four independent
+     * lookups instead of a chain of four.
+     */
+    constexpr std::array<std::array<uint16_t, 256>, 4> MakeCrcTable() {
+        std::array<std::array<uint16_t, 256>, 4> table = {};
+        for (uint32_t i = 0; i < 256; i++) {
+            uint16_t crc = static_cast<uint16_t>(i << 8);
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021)
+                                     : static_cast<uint16_t>(crc << 1);
+            }
+            table[0][i] = crc;
+        }
+        for (size_t k = 1; k < table.size(); k++) {
+            for (uint32_t i = 0; i < 256; i++) {
+                uint16_t const prev = table[k - 1][i];
+                table[k][i] = static_cast<uint16_t>((prev << 8) ^ table[0][prev >> 8]);
+            }
+        }
+        return table;
+    }
+
+    constexpr std::array<std::array<uint16_t, 256>, 4> crc_table = MakeCrcTable();
+} // namespace anonymous
+
+namespace serial_protocol {
+    uint16_t Crc16(const uint8_t* data, size_t len) {
+        uint16_t crc = 0xFFFF;
+        size_t i = 0;
+        for (; i + 4 <= len; i += 4) {
+            crc = static_cast<uint16_t>(crc_table[3][(crc >> 8) ^ data[i]] ^
+                                        crc_table[2][(crc & 0xFF) ^ data[i + 1]] ^
+                                        crc_table[1][data[i + 2]] ^
+                                        crc_table[0][data[i + 3]]);
+        }
+        for (; i < len; i++) {
+            crc = static_cast<uint16_t>((crc << 8) ^ crc_table[0][((crc >> 8) ^ data[i]) & 0xFF]);
+        }
+        return crc;
+    }
+} // namespace serial_protocol
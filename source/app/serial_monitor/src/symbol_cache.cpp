@@ -0,0 +1,223 @@
+#include "symbol_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+#include "mapped_file.h"
+
+/*
+ * File layout, integers in host byte order since the cache never leaves the machine:
+ *   header   magic[8], version u32, file count u32, symbol count u32, string bytes u32
+ *   files    name offset u32, name size u32, first symbol u32, symbol count u32
+ *   symbols  name offset u32, name size u32, address u32, size u32,
+ *            type u8, bit offset u8, bit size u8, reserved u8
+ *   strings  names of files and symbols, not terminated
+ */
+namespace {
+    const char     kMagic[8] = {'J', 'V', 'S', 'Y', 'M', 'A', 'P', '\0'};
+    // Bump when the layout or the symbol expansion changes, old caches are then re-parsed
+    const uint32_t kVersion = 1;
+    const size_t   kHeaderSize = sizeof(kMagic) + 4 * sizeof(uint32_t);
+    const size_t   kFileRecordSize = 4 * sizeof(uint32_t);
+    const size_t   kSymbolRecordSize = 4 * sizeof(uint32_t) + 4;
+    const size_t   kMaxCachedBuilds = 16;
+    const char*    kCacheDir = "resources/symbol_cache";
+
+    template <typename T>
+    void Put(std::vector<uint8_t>& out, T value) {
+        uint8_t bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+
+    template <typename T>
+    T Get(const uint8_t* data) {
+        T value;
+        std::memcpy(&value, data, sizeof(T));
+        return value;
+    }
+
+    std::filesystem::path CachePath(const std::string& key) {
+        return std::filesystem::path(kCacheDir) / (key + ".jvsym");
+    }
+
+    // Keeps the most recently used builds, Load refreshes the time of a cache it reads
+    void Prune() {
+        std::error_code error;
+        std::vector<std::filesystem::directory_entry> caches;
+        for (const auto& entry : std::filesystem::directory_iterator(kCacheDir, error)) {
+            if (entry.path().extension() == ".jvsym") {
+                caches.push_back(entry);
+            }
+        }
+        if (caches.size() <= kMaxCachedBuilds) {
+            return;
+        }
+        std::sort(caches.begin(), caches.end(), [](const auto& a, const auto& b) {
+            std::error_code ignored;
+            return a.last_write_time(ignored) > b.last_write_time(ignored);
+        });
+        for (size_t i = kMaxCachedBuilds; i < caches.size(); i++) {
+            std::filesystem::remove(caches[i].path(), error);
+        }
+    }
+} // namespace anonymous
+
+namespace symbol_cache {
+    bool Exists(const std::string& key) {
+        std::error_code error;
+        return !key.empty() && std::filesystem::exists(CachePath(key), error);
+    }
+
+    bool Load(const std::string& key, FileSymbolMap& map) {
+        map.clear();
+        std::filesystem::path const path = CachePath(key);
+        std::error_code error;
+        if (key.empty() || !std::filesystem::exists(path, error)) {
+            return false;
+        }
+        if (!LoadFile(path.string(), map)) {
+            // Corrupt or from an older version, the caller parses the ELF file again
+            std::filesystem::remove(path, error);
+            return false;
+        }
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+        return true;
+    }
+
+    bool Save(const std::string& key, const FileSymbolMap& map) {
+        if (key.empty()) {
+            return false;
+        }
+        std::error_code error;
+        std::filesystem::create_directories(kCacheDir, error);
+        if (!SaveFile(CachePath(key).string(), map)) {
+            return false;
+        }
+        Prune();
+        return true;
+    }
+
+    bool LoadFile(const std::string& path, FileSymbolMap& map) {
+        map.clear();
+        MappedFile file = {};
+        if (!mapped_file::Open(file, path)) {
+            return false;
+        }
+
+        bool ok = file.size >= kHeaderSize && std::memcmp(file.data, kMagic, sizeof(kMagic)) == 0 &&
+                  Get<uint32_t>(file.data + 8) == kVersion;
+        uint32_t const file_count = ok ? Get<uint32_t>(file.data + 12) : 0;
+        uint32_t const symbol_count = ok ? Get<uint32_t>(file.data + 16) : 0;
+        uint32_t const strings_size = ok ? Get<uint32_t>(file.data + 20) : 0;
+        size_t const files_offset = kHeaderSize;
+        size_t const symbols_offset = files_offset + static_cast<size_t>(file_count) * kFileRecordSize;
+        size_t const strings_offset = symbols_offset + static_cast<size_t>(symbol_count) * kSymbolRecordSize;
+        ok = ok && strings_offset + strings_size == file.size;
+
+        const char* strings = reinterpret_cast<const char*>(file.data + strings_offset);
+        auto string_at = [&](const uint8_t* record, std::string& out) {
+            uint32_t const offset = Get<uint32_t>(record);
+            uint32_t const size = Get<uint32_t>(record + 4);
+            if (offset > strings_size || size > strings_size - offset) {
+                return false;
+            }
+            out.assign(strings + offset, size);
+            return true;
+        };
+
+        std::string file_name;
+        std::string symbol_name;
+        map.reserve(file_count);
+        for (uint32_t f = 0; ok && f < file_count; f++) {
+            const uint8_t* record = file.data + files_offset + static_cast<size_t>(f) * kFileRecordSize;
+            uint32_t const first = Get<uint32_t>(record + 8);
+            uint32_t const count = Get<uint32_t>(record + 12);
+            if (!string_at(record, file_name) || first > symbol_count || count > symbol_count - first) {
+                ok = false;
+                break;
+            }
+            auto& symbols = map[file_name];
+            symbols.reserve(count);
+            for (uint32_t s = first; s < first + count; s++) {
+                const uint8_t* symbol = file.data + symbols_offset + static_cast<size_t>(s) * kSymbolRecordSize;
+                if (!string_at(symbol, symbol_name)) {
+                    ok = false;
+                    break;
+                }
+                symbols[symbol_name] = {
+                    .address    = Get<uint32_t>(symbol + 8),
+                    .size       = Get<uint32_t>(symbol + 12),
+                    .frame      = 0,
+                    .type       = static_cast<VariableType>(symbol[16]),
+                    .bit_offset = symbol[17],
+                    .bit_size   = symbol[18],
+                };
+            }
+        }
+        mapped_file::Close(file);
+
+        if (!ok) {
+            map.clear();
+        }
+        return ok;
+    }
+
+    bool SaveFile(const std::string& path, const FileSymbolMap& map) {
+        std::vector<uint8_t> files;
+        std::vector<uint8_t> symbols;
+        std::vector<uint8_t> strings;
+        uint32_t symbol_count = 0;
+        auto put_string = [&strings](std::vector<uint8_t>& out, const std::string& text) {
+            Put<uint32_t>(out, static_cast<uint32_t>(strings.size()));
+            Put<uint32_t>(out, static_cast<uint32_t>(text.size()));
+            strings.insert(strings.end(), text.begin(), text.end());
+        };
+
+        for (const auto& [file_name, file_symbols] : map) {
+            put_string(files, file_name);
+            Put<uint32_t>(files, symbol_count);
+            Put<uint32_t>(files, static_cast<uint32_t>(file_symbols.size()));
+            for (const auto& [name, info] : file_symbols) {
+                put_string(symbols, name);
+                Put<uint32_t>(symbols, info.address);
+                Put<uint32_t>(symbols, static_cast<uint32_t>(info.size));
+                Put<uint8_t>(symbols, static_cast<uint8_t>(info.type));
+                Put<uint8_t>(symbols, info.bit_offset);
+                Put<uint8_t>(symbols, info.bit_size);
+                Put<uint8_t>(symbols, 0);
+            }
+            symbol_count += static_cast<uint32_t>(file_symbols.size());
+        }
+
+        std::vector<uint8_t> header(kMagic, kMagic + sizeof(kMagic));
+        Put<uint32_t>(header, kVersion);
+        Put<uint32_t>(header, static_cast<uint32_t>(map.size()));
+        Put<uint32_t>(header, symbol_count);
+        Put<uint32_t>(header, static_cast<uint32_t>(strings.size()));
+
+        // Written aside and renamed, so a crash never leaves a half written file behind
+        std::string const temp_path = path + ".tmp";
+        std::FILE* out = std::fopen(temp_path.c_str(), "wb");
+        if (out == nullptr) {
+            return false;
+        }
+        bool ok = true;
+        for (const auto* part : {&header, &files, &symbols, &strings}) {
+            ok = ok && std::fwrite(part->data(), 1, part->size(), out) == part->size();
+        }
+        ok = std::fclose(out) == 0 && ok;
+        std::error_code error;
+        if (ok) {
+            std::filesystem::rename(temp_path, path, error);
+            ok = !error;
+        }
+        if (!ok) {
+            std::filesystem::remove(temp_path, error);
+        }
+        return ok;
+    }
+} // namespace symbol_cache
@@ -0,0 +1,122 @@
+#include "symbol_search.h"
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+
+namespace {
+    std::string ToLower(const std::string& text) {
+        std::string lower(text);
+        for (char& c : lower) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        return lower;
+    }
+
+    uint32_t Trigram(const char* text) {
+        return (static_cast<uint32_t>(static_cast<uint8_t>(text[0])) << 16) |
+               (static_cast<uint32_t>(static_cast<uint8_t>(text[1])) << 8) |
+               static_cast<uint32_t>(static_cast<uint8_t>(text[2]));
+    }
+
+    void AddTrigrams(SymbolIndex& index, const std::string& text, uint32_t entry) {
+        for (size_t i = 0; i + 3 <= text.size(); i++) {
+            std::vector<uint32_t>& postings = index.trigrams[Trigram(text.data() + i)];
+            // Entries are added in order, so a repeat can only be the last one
+            if (postings.empty() || postings.back() != entry) {
+                postings.push_back(entry);
+            }
+        }
+    }
+
+    bool Matches(const SymbolIndex& index, uint32_t entry, const std::string& query) {
+        return index.lower_names[entry].find(query) != std::string::npos ||
+               index.lower_files[index.entry_file[entry]].find(query) != std::string::npos;
+    }
+
+    // Entries holding every trigram of the query, the smallest posting list first
+    std::vector<uint32_t> Candidates(const SymbolIndex& index, const std::string& query) {
+        std::vector<const std::vector<uint32_t>*> lists;
+        for (size_t i = 0; i + 3 <= query.size(); i++) {
+            auto it = index.trigrams.find(Trigram(query.data() + i));
+            if (it == index.trigrams.end()) {
+                return {};
+            }
+            lists.push_back(&it->second);
+        }
+        std::sort(lists.begin(), lists.end(), [](const auto* a, const auto* b) { return a->size() < b->size(); });
+
+        std::vector<uint32_t> candidates = *lists.front();
+        std::vector<uint32_t> intersection;
+        for (size_t i = 1; i < lists.size() && !candidates.empty(); i++) {
+            intersection.clear();
+            std::set_intersection(candidates.begin(), candidates.end(), lists[i]->begin(), lists[i]->end(),
+                                  std::back_inserter(intersection));
+            candidates.swap(intersection);
+        }
+        return candidates;
+    }
+} // namespace anonymous
+
+namespace symbol_search {
+    void Build(SymbolIndex& index, const FileSymbolMap& map) {
+        index = SymbolIndex();
+        for (const auto& [file, symbols] : map) {
+            for (const auto& [name, var] : symbols) {
+                index.entries.push_back({&file, &name, &var});
+            }
+        }
+        std::sort(index.entries.begin(), index.entries.end(), [](const SymbolEntry& a, const SymbolEntry& b) {
+            return *a.file != *b.file ? *a.file < *b.file : *a.name < *b.name;
+        });
+
+        index.lower_names.reserve(index.entries.size());
+        index.entry_file.reserve(index.entries.size());
+        const std::string* current_file = nullptr;
+        for (uint32_t i = 0; i < index.entries.size(); i++) {
+            const SymbolEntry& entry = index.entries[i];
+            if (entry.file != current_file) {
+                current_file = entry.file;
+                index.lower_files.push_back(ToLower(*entry.file));
+            }
+            index.entry_file.push_back(static_cast<uint32_t>(index.lower_files.size() - 1));
+            index.lower_names.push_back(ToLower(*entry.name));
+            AddTrigrams(index, index.lower_names.back(), i);
+            AddTrigrams(index, index.lower_files.back(), i);
+        }
+
+        index.results.resize(index.entries.size());
+        for (uint32_t i = 0; i < index.results.size(); i++) {
+            index.results[i] = i;
+        }
+    }
+
+    const std::vector<uint32_t>& Search(SymbolIndex& index, const char* query) {
+        std::string const lower = ToLower(query);
+        if (lower == index.query) {
+            return index.results;
+        }
+
+        std::vector<uint32_t> candidates;
+        if (!index.query.empty() && lower.find(index.query) != std::string::npos) {
+            // Typing refines, anything matching the new query matched the old one
+            candidates.swap(index.results);
+        } else if (lower.size() >= 3) {
+            candidates = Candidates(index, lower);
+        } else {
+            candidates.resize(index.entries.size());
+            for (uint32_t i = 0; i < candidates.size(); i++) {
+                candidates[i] = i;
+            }
+        }
+
+        index.results.clear();
+        for (uint32_t entry : candidates) {
+            if (lower.empty() || Matches(index, entry, lower)) {
+                index.results.push_back(entry);
+            }
+        }
+        index.query = lower;
+        return index.results;
+    }
+} // namespace symbol_search
@@ -0,0 +1,230 @@
+#include "tracing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace {
+    /*
+     * Written only by its own thread. head is published after each record, a
+     * reader copies up to head and then drops whatever the writer may have
+     * overwritten meanwhile. Buffers outlive their thread, so records of a
+     * finished thread can still be read until the next new thread takes the
+     * buffer over. head keeps counting then, so cursors of readers stay valid.
+     */
+    typedef struct {
+        std::string           name;
+        size_t                index;    // In thread_buffers
+        std::atomic<uint64_t> head;     // Records written, the newest is head - 1
+        TraceRecord           records[kTraceRecords];
+    } ThreadBuffer;
+
+    std::mutex                                 registry_mutex;
+    std::deque<std::string>                    zone_names;
+    std::vector<std::unique_ptr<ThreadBuffer>> thread_buffers;
+    std::vector<ThreadBuffer*>                 free_buffers;    // Of threads that have exited
+
+    // Hands the buffer back when its thread exits, e.g. a log writer per log session
+    struct BufferRelease {
+        ThreadBuffer* buffer = nullptr;
+        ~BufferRelease() {
+            if (buffer != nullptr) {
+                std::lock_guard<std::mutex> lock(registry_mutex);
+                free_buffers.push_back(buffer);
+            }
+        }
+    };
+
+    std::chrono::steady_clock::time_point const epoch = std::chrono::steady_clock::now();
+    thread_local ThreadBuffer* thread_buffer = nullptr;
+    thread_local uint8_t       thread_depth  = 0;
+    thread_local BufferRelease buffer_release;
+
+    uint64_t Now() {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+    }
+
+    ThreadBuffer& LocalBuffer() {
+        if (thread_buffer == nullptr) {
+            std::lock_guard<std::mutex> lock(registry_mutex);
+            if (!free_buffers.empty()) {
+                thread_buffer = free_buffers.back();
+                free_buffers.pop_back();
+            } else {
+                thread_buffers.push_back(std::make_unique<ThreadBuffer>());
+                thread_buffer = thread_buffers.back().get();
+                thread_buffer->index = thread_buffers.size() - 1;
+            }
+            thread_buffer->name = "thread " + std::to_string(thread_buffer->index);
+            buffer_release.buffer = thread_buffer;
+        }
+        return *thread_buffer;
+    }
+
+    void WriteJsonString(std::FILE* out, const std::string& text) {
+        std::fputc('"', out);
+        for (char const c : text) {
+            if (c == '"' || c == '\\') {
+                std::fputc('\\', out);
+                std::fputc(c, out);
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                std::fprintf(out, "\\u%04x", static_cast<unsigned>(c));
+            } else {
+                std::fputc(c, out);
+            }
+        }
+        std::fputc('"', out);
+    }
+
+    void Record(const TraceRecord& record) {
+        ThreadBuffer& buffer = LocalBuffer();
+        uint64_t const head = buffer.head.load(std::memory_order_relaxed);
+        buffer.records[head % kTraceRecords] = record;
+        buffer.head.store(head + 1, std::memory_order_release);
+    }
+} // namespace anonymous
+
+namespace tracing {
+    uint16_t RegisterZone(const char* name) {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        for (size_t i = 0; i < zone_names.size(); i++) {
+            if (zone_names[i] == name) {
+                return static_cast<uint16_t>(i);
+            }
+        }
+        zone_names.emplace_back(name);
+        return static_cast<uint16_t>(zone_names.size() - 1);
+    }
+
+    std::string GetZoneName(uint16_t zone) {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        return zone < zone_names.size() ? zone_names[zone] : "?";
+    }
+
+    size_t GetZoneCount() {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        return zone_names.size();
+    }
+
+    void SetThreadName(const char* name) {
+        ThreadBuffer& buffer = LocalBuffer();
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        buffer.name = name;
+    }
+
+    size_t GetThreadCount() {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        return thread_buffers.size();
+    }
+
+    std::string GetThreadName(size_t thread) {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        return thread < thread_buffers.size() ? thread_buffers[thread]->name : "?";
+    }
+
+    size_t GetMemoryBytes() {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        return thread_buffers.size() * sizeof(ThreadBuffer);
+    }
+
+    uint64_t BeginZone() {
+        thread_depth++;
+        return Now();
+    }
+
+    void EndZone(uint16_t zone, uint64_t start_ns) {
+        uint64_t const duration = Now() - start_ns;
+        thread_depth--;
+        Record({
+            .start_ns = start_ns,
+            .value    = static_cast<uint32_t>(std::min<uint64_t>(duration, UINT32_MAX)),
+            .zone     = zone,
+            .depth    = thread_depth,
+            .kind     = TRACE_ZONE_RECORD,
+        });
+    }
+
+    void Counter(uint16_t zone, uint32_t value) {
+        Record({
+            .start_ns = Now(),
+            .value    = value,
+            .zone     = zone,
+            .depth    = thread_depth,
+            .kind     = TRACE_COUNTER_RECORD,
+        });
+    }
+
+    void Read(size_t thread, uint64_t& cursor, std::vector<TraceRecord>& out) {
+        const ThreadBuffer* buffer = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(registry_mutex);
+            if (thread >= thread_buffers.size()) {
+                return;
+            }
+            buffer = thread_buffers[thread].get();
+        }
+
+        uint64_t const head = buffer->head.load(std::memory_order_acquire);
+        if (head - cursor > kTraceRecords) {
+            cursor = head - kTraceRecords;
+        }
+        size_t const first = out.size();
+        for (uint64_t i = cursor; i < head; i++) {
+            out.push_back(buffer->records[i % kTraceRecords]);
+        }
+
+        // The slot of head_after is being written, older slots up to it were rewritten
+        uint64_t const head_after = buffer->head.load(std::memory_order_acquire);
+        if (head_after + 1 > cursor + kTraceRecords) {
+            uint64_t const lost = std::min(head_after + 1 - kTraceRecords - cursor, head - cursor);
+            out.erase(out.begin() + static_cast<std::ptrdiff_t>(first),
+                      out.begin() + static_cast<std::ptrdiff_t>(first + lost));
+        }
+        cursor = head;
+    }
+
+    bool WriteChromeTrace(const std::string& path) {
+        std::FILE* out = std::fopen(path.c_str(), "wb");
+        if (out == nullptr) {
+            return false;
+        }
+        std::vector<std::string> names;
+        for (size_t zone = 0; zone < GetZoneCount(); zone++) {
+            names.push_back(GetZoneName(static_cast<uint16_t>(zone)));
+        }
+
+        // Times in the format are microseconds, fractions keep the ns
+        std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", out);
+        std::fputs("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"jelkiview\"}}", out);
+        std::vector<TraceRecord> records;
+        for (size_t thread = 0; thread < GetThreadCount(); thread++) {
+            std::fprintf(out, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":",
+                         thread);
+            WriteJsonString(out, GetThreadName(thread));
+            std::fputs("}}", out);
+
+            uint64_t cursor = 0;
+            records.clear();
+            Read(thread, cursor, records);
+            for (const TraceRecord& record : records) {
+                std::fputs(",\n{\"name\":", out);
+                WriteJsonString(out, record.zone < names.size() ? names[record.zone] : "?");
+                if (record.kind == TRACE_COUNTER_RECORD) {
+                    std::fprintf(out, ",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%zu,\"args\":{\"value\":%u}}",
+                                 record.start_ns / 1e3, thread, record.value);
+                } else {
+                    std::fprintf(out, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%zu}",
+                                 record.start_ns / 1e3, record.value / 1e3, thread);
+                }
+            }
+        }
+        std::fputs("\n]}\n", out);
+        bool const ok = std::ferror(out) == 0;
+        return std::fclose(out) == 0 && ok;
+    }
+} // namespace tracing
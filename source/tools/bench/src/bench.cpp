@@ -0,0 +1,440 @@
+/*
+ * Headless benchmarks of the log loading, plotting and logging paths, on synthetic data.
+ * Each benchmark runs --repeat times, results and the heap allocations of a run are written as JSON.
+ *
+ *   bench [--rows 1000000] [--signals 16] [--repeat 5] [--filter name] [--out bench.json]
+ *
+ * Logs are written to a temporary directory that is removed at exit.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "csv_reader.h"
+#include "csv_writer.h"
+#include "data_logger.h"
+#include "decimation.h"
+#include "log_decoder.h"
+#include "memory_stats.h"
+#include "serial_back.h"
+#include "serial_front.h"
+#include "serial_protocol.h"
+#include "settings.h"
+
+using Clock = std::chrono::steady_clock;
+
+/*
+ * The logging path calls back into the GUI side of the app, these stand in
+ * for it so that only the code under test is linked.
+ */
+void InitSerialStream(std::unordered_map<std::string, VarStruct> /*log_variables*/) {}
+
+namespace {
+    SerialBack_Settings bench_settings = {
+        .elf_file_path = "",
+        .record_raw    = false,
+        .binary_log    = false,
+        .ram_window_s  = 0,
+    };
+} // namespace anonymous
+
+namespace serial_back {
+    SerialBack_Settings* GetSettings() {
+        return &bench_settings;
+    }
+
+    void MarkSettingsDirty() {}
+} // namespace serial_back
+
+namespace serial_front {
+    void AddLog(const char* fmt, ...) {
+        va_list args;
+        va_start(args, fmt);
+        std::vfprintf(stderr, fmt, args);
+        va_end(args);
+    }
+} // namespace serial_front
+
+namespace settings {
+    CsvFormat GetCsvFormat() {
+        return csv_writer::kDefaultFormat;
+    }
+} // namespace settings
+
+namespace {
+    typedef struct {
+        size_t      rows    = 1000000;
+        size_t      signals = 16;
+        size_t      repeat  = 5;
+        std::string filter;
+        std::string out;    // stdout if empty
+    } BenchOptions;
+
+    typedef struct {
+        std::string name;
+        size_t      repeat;
+        double      min_s;
+        double      median_s;
+        uint64_t    items;      // Rows, values or frames handled by one run
+        uint64_t    bytes;      // Bytes read or written by one run, 0 if not meaningful
+        AllocationCounts allocations;   // Heap allocations of one run, all threads
+    } BenchResult;
+
+    // Frames of the synthetic log, as StartLog() sets up frame ids 0-2
+    const int    kFrames        = 3;
+    const size_t kReadChunk     = 4096;    // Bytes per Feed(), as read from the port
+    const size_t kPlotFrames    = 100;     // Redraws per decimation run
+    const uint32_t kTickUs      = 10;
+
+    BenchOptions options;
+    std::vector<BenchResult> results;
+    volatile double sink = 0.0;    // Keeps results of pure work alive
+
+    bool ParseArgs(int argc, char** argv) {
+        for (int i = 1; i < argc; i++) {
+            std::string const arg = argv[i];
+            bool const has_value = i + 1 < argc;
+            if (arg == "--rows" && has_value) {
+                options.rows = std::strtoull(argv[++i], nullptr, 10);
+            } else if (arg == "--signals" && has_value) {
+                options.signals = std::strtoull(argv[++i], nullptr, 10);
+            } else if (arg == "--repeat" && has_value) {
+                options.repeat = std::max<size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+            } else if (arg == "--filter" && has_value) {
+                options.filter = argv[++i];
+            } else if (arg == "--out" && has_value) {
+                options.out = argv[++i];
+            } else {
+                std::fprintf(stderr, "Usage: %s [--rows N] [--signals N] [--repeat N] [--filter name] [--out path]\n",
+                    argv[0]);
+                return false;
+            }
+        }
+        options.rows = std::max<size_t>(options.rows, 2);
+        options.signals = std::max<size_t>(options.signals, 1);
+        return true;
+    }
+
+    bool Selected(const char* name) {
+        return options.filter.empty() || std::string(name).find(options.filter) != std::string::npos;
+    }
+
+    /*
+     * Runs setup and then the timed part options.repeat times. run returns the
+     * number of bytes it handled.
+     */
+    void Run(const char* name, uint64_t items, const std::function<void()>& setup,
+             const std::function<uint64_t()>& run) {
+        if (!Selected(name)) {
+            return;
+        }
+        std::vector<double> seconds;
+        uint64_t bytes = 0;
+        AllocationCounts allocations = {};
+        for (size_t i = 0; i < options.repeat; i++) {
+            if (setup) {
+                setup();
+            }
+            AllocationCounts const before = memory_stats::GetAllocations();
+            auto const start = Clock::now();
+            bytes = run();
+            auto const end = Clock::now();
+            AllocationCounts const after = memory_stats::GetAllocations();
+            seconds.push_back(std::chrono::duration<double>(end - start).count());
+            allocations = {
+                .allocations     = after.allocations - before.allocations,
+                .frees           = after.frees - before.frees,
+                .allocated_bytes = after.allocated_bytes - before.allocated_bytes,
+            };
+        }
+        std::sort(seconds.begin(), seconds.end());
+        BenchResult const result = {
+            .name     = name,
+            .repeat   = options.repeat,
+            .min_s    = seconds.front(),
+            .median_s = seconds[seconds.size() / 2],
+            .items    = items,
+            .bytes    = bytes,
+            .allocations = allocations,
+        };
+        std::fprintf(stderr, "%-22s %10.3f ms %14.0f items/s %10.1f MB/s %10llu allocations\n", name,
+                     result.min_s * 1e3, static_cast<double>(items) / result.min_s,
+                     static_cast<double>(bytes) / result.min_s / 1e6,
+                     static_cast<unsigned long long>(allocations.allocations));
+        results.push_back(result);
+    }
+
+    std::string SignalName(size_t sig) {
+        return "signal_" + std::to_string(sig);
+    }
+
+    // Counters, small integers and sensor like values, so numbers have varying lengths
+    double SignalValue(size_t sig, size_t row) {
+        switch (sig % 3) {
+            case 0:  return static_cast<double>(row & 0xFFFF);
+            case 1:  return static_cast<double>((row * 7 + sig) % 16);
+            default: return 20.0 + static_cast<double>((row * 2654435761U) % 1000) / 997.0;
+        }
+    }
+
+    Data MakeData() {
+        Data data;
+        data.time.resize(options.rows);
+        for (size_t row = 0; row < options.rows; row++) {
+            data.time[row] = static_cast<double>(row) * 1e-4;
+        }
+        for (size_t sig = 0; sig < options.signals; sig++) {
+            std::vector<double>& values = data.signals[SignalName(sig)];
+            values.resize(options.rows);
+            for (size_t row = 0; row < options.rows; row++) {
+                values[row] = SignalValue(sig, row);
+            }
+        }
+        return data;
+    }
+
+    void BenchParseCommaDecimal() {
+        const size_t count = options.rows;
+        std::vector<std::string> strings;
+        strings.reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            std::string value = std::to_string(SignalValue(i % 3 + 2, i));
+            if (i % 2 == 0) {
+                std::replace(value.begin(), value.end(), '.', ',');
+            }
+            strings.push_back(value);
+        }
+        uint64_t bytes = 0;
+        for (const auto& str : strings) {
+            bytes += str.size();
+        }
+        Run("parse_comma_decimal", count, nullptr, [&] {
+            double sum = 0.0;
+            for (const auto& str : strings) {
+                sum += csv_reader::ParseCommaDecimal(str);
+            }
+            sink = sum;
+            return bytes;
+        });
+    }
+
+    void BenchReadCsv(const Data& data) {
+        if (!Selected("read_csv")) {
+            return;
+        }
+        std::vector<std::string> columns;
+        for (const auto& var : data.signals) {
+            columns.push_back(var.first);
+        }
+        // The format the logger writes with decimal comma enabled
+        const CsvFormat format = {';', ','};
+        std::string const path = "read_csv.csv";
+        if (!csv_writer::WriteCsv(path, data, columns, format)) {
+            std::fprintf(stderr, "Could not write %s\n", path.c_str());
+            return;
+        }
+        uint64_t const bytes = std::filesystem::file_size(path);
+        Data read;
+        Run("read_csv", options.rows, nullptr, [&] {
+            csv_reader::ReadCsv(path, format.separator, 0, "Time", read);
+            return bytes;
+        });
+        std::filesystem::remove(path);
+    }
+
+    /*
+     * What the plot does per redraw: decimation data for the x range, then time and
+     * every signal decimated. Zoomed fully out, to half and to 1 % of the log.
+     */
+    void BenchDecimate(const Data& data) {
+        double const duration = data.time.back() - data.time.front();
+        const double zooms[] = {1.0, 0.5, 0.01};
+        std::vector<double> time_decimated;
+        std::vector<std::vector<double>> signals_decimated(data.signals.size());
+        Run("decimate", kPlotFrames, nullptr, [&] {
+            uint64_t values = 0;
+            for (size_t frame = 0; frame < kPlotFrames; frame++) {
+                double const span = duration * zooms[frame % std::size(zooms)];
+                DecimationData decimation_data;
+                decimation::CalculateDecimationData(data.time, data.time.back() - span, data.time.back(),
+                                                    decimation_data);
+                int const m = static_cast<int>(decimation_data.decimation_factor + 0.5);
+                decimation::Decimate(data.time, decimation_data.visible_min_idx, decimation_data.visible_max_idx,
+                                     m, true, time_decimated);
+                values += time_decimated.size();
+                size_t sig = 0;
+                for (const auto& [name, signal] : data.signals) {
+                    std::vector<double>& decimated = signals_decimated[sig++];
+                    decimation::Decimate(signal, decimation_data.visible_min_idx, decimation_data.visible_max_idx,
+                                         m, true, decimated);
+                    values += decimated.size();
+                }
+            }
+            sink = static_cast<double>(values);
+            return values * sizeof(double);
+        });
+    }
+
+    // Signals spread over the frames, with the types and sizes the ELF parser reports
+    std::unordered_map<std::string, VarStruct> MakeLogVariables() {
+        const VariableType types[] = {TYPE_UINT16, TYPE_INT32, TYPE_FLOAT, TYPE_UINT8};
+        const size_t sizes[]       = {2, 4, 4, 1};
+        std::unordered_map<std::string, VarStruct> variables;
+        for (size_t sig = 0; sig < options.signals; sig++) {
+            size_t const kind = sig % std::size(types);
+            variables[SignalName(sig)] = {
+                .address    = static_cast<uint32_t>(0x20000000 + sig * 4),
+                .size       = sizes[kind],
+                .frame      = static_cast<int>(sig % kFrames),
+                .type       = types[kind],
+                .bit_offset = 0,
+                .bit_size   = 0,
+            };
+        }
+        return variables;
+    }
+
+    // Same frames as BuildFramesCommand() sets up
+    std::unordered_map<std::string, FrameStruct> MakeFrames(const std::unordered_map<std::string, VarStruct>& variables) {
+        std::unordered_map<std::string, FrameStruct> frames;
+        for (const auto& [name, var] : variables) {
+            FrameStruct& frame = frames[std::to_string(var.frame)];
+            frame.id = var.frame;
+            frame.variables.push_back({.name = name, .size = var.size, .latest_rx = 0, .type = var.type,
+                                       .bit_offset = var.bit_offset, .bit_size = var.bit_size});
+        }
+        return frames;
+    }
+
+    // Every frame once per row, as the device sends them, with valid CRCs
+    std::vector<uint8_t> MakeStream(const std::unordered_map<std::string, FrameStruct>& frames, uint64_t& frame_count) {
+        std::vector<uint8_t> stream;
+        frame_count = 0;
+        for (size_t row = 0; row < options.rows; row++) {
+            uint32_t const time = static_cast<uint32_t>(row * kTickUs);
+            for (const auto& [key, frame] : frames) {
+                size_t const start = stream.size();
+                stream.push_back(serial_protocol::kSync0);
+                stream.push_back(serial_protocol::kSync1);
+                stream.push_back(serial_protocol::kVersion);
+                stream.push_back(static_cast<uint8_t>(frame.id));
+                stream.push_back(0);
+                for (int shift = 24; shift >= 0; shift -= 8) {
+                    stream.push_back(static_cast<uint8_t>(time >> shift));
+                }
+                for (size_t i = 0; i < frame.variables.size(); i++) {
+                    uint32_t const value = static_cast<uint32_t>(row * (i + 1));
+                    for (size_t byte = frame.variables[i].size; byte > 0; byte--) {
+                        stream.push_back(static_cast<uint8_t>(value >> (8 * (byte - 1))));
+                    }
+                }
+                stream[start + 4] = static_cast<uint8_t>(stream.size() - start - serial_protocol::kHeaderSize);
+                uint16_t const crc = serial_protocol::Crc16(&stream[start + 2], stream.size() - start - 2);
+                stream.push_back(static_cast<uint8_t>(crc >> 8));
+                stream.push_back(static_cast<uint8_t>(crc));
+                frame_count++;
+            }
+        }
+        return stream;
+    }
+
+    void Feed(const std::vector<uint8_t>& stream) {
+        for (size_t offset = 0; offset < stream.size(); offset += kReadChunk) {
+            log_decoder::Feed(stream.data() + offset, std::min(kReadChunk, stream.size() - offset));
+        }
+    }
+
+    /*
+     * decode_log feeds the stream through the decoder into LogFrame() while the
+     * writer thread runs, as during a live log. save_log_* time a whole log
+     * session, from init to SaveLog() returning with the file closed.
+     */
+    void BenchLogging() {
+        std::unordered_map<std::string, VarStruct> const variables = MakeLogVariables();
+        std::unordered_map<std::string, FrameStruct> frames = MakeFrames(variables);
+        uint64_t frame_count = 0;
+        std::vector<uint8_t> const stream = MakeStream(frames, frame_count);
+
+        bench_settings.binary_log = false;
+        Run("decode_log", frame_count, [&] {
+            log_decoder::Configure(frames);
+            data_logger::init(variables);
+        }, [&] {
+            Feed(stream);
+            return stream.size();
+        });
+        data_logger::SaveLog();
+
+        for (bool const binary : {false, true}) {
+            bench_settings.binary_log = binary;
+            Run(binary ? "save_log_binary" : "save_log_csv", options.rows, nullptr, [&] {
+                log_decoder::Configure(frames);
+                data_logger::init(variables);
+                Feed(stream);
+                data_logger::SaveLog();
+                return std::filesystem::file_size(data_logger::GetLogFilePath());
+            });
+        }
+        data_logger::DeInit();
+    }
+
+    bool WriteJson() {
+        std::FILE* out = options.out.empty() ? stdout : std::fopen(options.out.c_str(), "wb");
+        if (out == nullptr) {
+            std::fprintf(stderr, "Could not open %s\n", options.out.c_str());
+            return false;
+        }
+        std::fprintf(out, "{\n  \"rows\": %zu,\n  \"signals\": %zu,\n  \"benchmarks\": [", options.rows,
+                     options.signals);
+        for (size_t i = 0; i < results.size(); i++) {
+            const BenchResult& result = results[i];
+            std::fprintf(out,
+                "%s\n    {\"name\": \"%s\", \"repeat\": %zu, \"min_s\": %.9f, \"median_s\": %.9f, "
+                "\"items\": %llu, \"items_per_s\": %.1f, \"bytes\": %llu, \"bytes_per_s\": %.1f, "
+                "\"allocations\": %llu, \"allocated_bytes\": %llu}",
+                i == 0 ? "" : ",", result.name.c_str(), result.repeat, result.min_s, result.median_s,
+                static_cast<unsigned long long>(result.items), static_cast<double>(result.items) / result.min_s,
+                static_cast<unsigned long long>(result.bytes), static_cast<double>(result.bytes) / result.min_s,
+                static_cast<unsigned long long>(result.allocations.allocations),
+                static_cast<unsigned long long>(result.allocations.allocated_bytes));
+        }
+        std::fputs("\n  ]\n}\n", out);
+        bool const ok = std::ferror(out) == 0;
+        return (out == stdout || std::fclose(out) == 0) && ok;
+    }
+} // namespace anonymous
+
+int main(int argc, char** argv) {
+    if (!ParseArgs(argc, argv)) {
+        return 1;
+    }
+    if (!options.out.empty()) {
+        options.out = std::filesystem::absolute(options.out).string();
+    }
+
+    // The logger writes to logs/ in the working directory
+    std::filesystem::path const work_dir = std::filesystem::temp_directory_path() / "jelkiview_bench";
+    std::filesystem::path const start_dir = std::filesystem::current_path();
+    std::filesystem::create_directories(work_dir);
+    std::filesystem::current_path(work_dir);
+
+    std::fprintf(stderr, "%zu rows x %zu signals, best of %zu\n", options.rows, options.signals, options.repeat);
+    BenchParseCommaDecimal();
+    {
+        Data const data = MakeData();
+        BenchReadCsv(data);
+        BenchDecimate(data);
+    }
+    BenchLogging();
+
+    std::filesystem::current_path(start_dir);
+    std::filesystem::remove_all(work_dir);
+    return WriteJson() ? 0 : 1;
+}
@@ -0,0 +1,123 @@
+/*
+ * Compares CSV export throughput of the ostream path that SaveLog() used with csv_writer.
+ *
+ *   csv_bench [--rows 1000000] [--signals 32] [--threads 0] [--out csv_bench.csv]
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "csv_writer.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    typedef struct {
+        size_t      rows    = 1000000;
+        size_t      signals = 32;
+        unsigned    threads = 0;
+        std::string out     = "csv_bench.csv";
+    } BenchOptions;
+
+    BenchOptions options;
+
+    bool ParseArgs(int argc, char** argv) {
+        for (int i = 1; i < argc; i++) {
+            std::string const arg = argv[i];
+            bool const has_value = i + 1 < argc;
+            if (arg == "--rows" && has_value) {
+                options.rows = std::strtoull(argv[++i], nullptr, 10);
+            } else if (arg == "--signals" && has_value) {
+                options.signals = std::strtoull(argv[++i], nullptr, 10);
+            } else if (arg == "--threads" && has_value) {
+                options.threads = static_cast<unsigned>(std::atoi(argv[++i]));
+            } else if (arg == "--out" && has_value) {
+                options.out = argv[++i];
+            } else {
+                std::fprintf(stderr, "Usage: %s [--rows N] [--signals N] [--threads N] [--out path]\n",
+                    argv[0]);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Mix of what a serial log holds: counters, small integers and sensor like floats
+    Data MakeData() {
+        Data data;
+        std::mt19937_64 rng(1);
+        std::normal_distribution<double> noise(0.0, 1.0);
+        data.time.resize(options.rows);
+        for (size_t row = 0; row < options.rows; row++) {
+            data.time[row] = static_cast<double>(row) * 1e-4;
+        }
+        for (size_t sig = 0; sig < options.signals; sig++) {
+            std::vector<double>& values = data.signals["signal_" + std::to_string(sig)];
+            values.resize(options.rows);
+            for (size_t row = 0; row < options.rows; row++) {
+                switch (sig % 3) {
+                    case 0:  values[row] = static_cast<double>(row & 0xFFFF); break;
+                    case 1:  values[row] = static_cast<double>(rng() % 16); break;
+                    default: values[row] = 20.0 + noise(rng); break;
+                }
+            }
+        }
+        return data;
+    }
+
+    // The pre csv_writer SaveLog() loop
+    void WriteOstream(const Data& data) {
+        std::ofstream log_file(options.out);
+        log_file << "Time,";
+        for (const auto& var : data.signals) {
+            log_file << var.first << ",";
+        }
+        log_file << "\n";
+        for (size_t i = 0; i < data.time.size(); ++i) {
+            log_file << data.time[i] << ",";
+            for (const auto& var : data.signals) {
+                log_file << var.second[i] << ",";
+            }
+            log_file << "\n";
+        }
+    }
+
+    void Report(const char* name, Clock::duration elapsed) {
+        double const seconds = std::chrono::duration<double>(elapsed).count();
+        double const bytes   = static_cast<double>(std::filesystem::file_size(options.out));
+        std::printf("%-22s %8.3f s %10.1f MB %8.3f GB/s %12.0f rows/s\n", name, seconds, bytes / 1e6,
+                    bytes / seconds / 1e9, static_cast<double>(options.rows) / seconds);
+    }
+} // namespace anonymous
+
+int main(int argc, char** argv) {
+    if (!ParseArgs(argc, argv)) {
+        return 1;
+    }
+    std::printf("%zu rows x %zu signals\n", options.rows, options.signals);
+    Data const data = MakeData();
+    std::vector<std::string> columns;
+    for (const auto& var : data.signals) {
+        columns.push_back(var.first);
+    }
+
+    auto start = Clock::now();
+    WriteOstream(data);
+    Report("ostream", Clock::now() - start);
+
+    start = Clock::now();
+    csv_writer::WriteCsv(options.out, data, columns, csv_writer::kDefaultFormat, 1);
+    Report("csv_writer 1 thread", Clock::now() - start);
+
+    start = Clock::now();
+    csv_writer::WriteCsv(options.out, data, columns, csv_writer::kDefaultFormat, options.threads);
+    Report("csv_writer", Clock::now() - start);
+
+    std::filesystem::remove(options.out);
+    return 0;
+}
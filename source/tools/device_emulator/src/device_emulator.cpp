@@ -0,0 +1,444 @@
+/*
+ * Host side emulator of embedded_logger/serial_log.c on a Linux pseudo-terminal.
+ *
+ * Speaks the same command protocol (setup_frame, start_log, stop_log, ACK/NACK)
+ * and transmits log frames from an emulated RAM, paced as a UART at the given baud
+ * rate. Open the printed /dev/pts/N in the Serial Monitor to run the real host path.
+ *
+ *   device_emulator [--baud 3000000] [--rate 1000] [--vars 64]
+ *                   [--symbol-map resources/device_emulator.jvsym] [--sweep 2:5]
+ */
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "serial_back.h"
+#include "serial_protocol.h"
+#include "symbol_cache.h"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    const uint32_t ram_base         = 0x20000000;
+    const size_t   max_nr_of_frames = 4;     // MAX_NR_OF_FRAMES in serial_log.c
+    const size_t   max_frame_size   = 0x1F;  // MAX_FRAME_SIZE in serial_log.c
+    const uint32_t tick_us          = 10;    // Device timestamps are in 10 us ticks
+
+    typedef struct {
+        uint32_t address;
+        uint32_t size;
+    } EmuFrameVariable;
+
+    typedef struct {
+        std::vector<EmuFrameVariable> variables;
+        Clock::time_point next_tx;
+    } EmuFrame;
+
+    typedef struct {
+        std::string  name;
+        uint32_t     address;
+        size_t       size;
+        VariableType type;
+    } EmuSymbol;
+
+    typedef struct {
+        uint64_t frames;
+        uint64_t bytes;
+        uint64_t uart_drops;    // Frame due while the UART was still busy, as frame_pending on the device
+        uint64_t host_drops;    // pty full, the host does not read fast enough
+    } EmuStats;
+
+    typedef struct {
+        int         baud        = 3000000;
+        double      rate_hz     = 1000.0;
+        int         vars        = 64;
+        std::string symbol_map;
+        double      sweep_factor = 0.0;
+        double      sweep_step_s = 5.0;
+    } EmuOptions;
+
+    volatile std::sig_atomic_t exit_requested = 0;
+
+    EmuOptions             options;
+    std::vector<uint8_t>   ram;
+    std::vector<EmuSymbol> symbols;
+    EmuFrame               frames[max_nr_of_frames];
+    bool                   log_started = false;
+    Clock::time_point      log_start_time;
+    Clock::time_point      uart_free_at;
+    EmuStats               stats = {};
+
+    void OnSignal(int) {
+        exit_requested = 1;
+    }
+
+    size_t TypeSize(VariableType type) {
+        switch (type) {
+            case TYPE_UINT8:  case TYPE_INT8:  case TYPE_CHAR: case TYPE_BOOL: return 1;
+            case TYPE_UINT16: case TYPE_INT16: return 2;
+            default: return 4;
+        }
+    }
+
+    /*
+     * Lays out the emulated variables in RAM and optionally writes them as a
+     * symbol map, so they can be selected in the Map Parser without an ELF file.
+     */
+    void CreateSymbols() {
+        const VariableType types[] = {TYPE_UINT8, TYPE_UINT16, TYPE_UINT32, TYPE_INT16, TYPE_INT32, TYPE_FLOAT};
+        uint32_t address = ram_base;
+        for (int i = 0; i < options.vars; i++) {
+            VariableType const type = types[i % (sizeof(types) / sizeof(types[0]))];
+            size_t const size = TypeSize(type);
+            address = (address + static_cast<uint32_t>(size) - 1) & ~static_cast<uint32_t>(size - 1);
+            symbols.push_back({.name = "emu_var_" + std::to_string(i), .address = address, .size = size, .type = type});
+            address += static_cast<uint32_t>(size);
+        }
+        ram.assign(address - ram_base + 4, 0);
+
+        if (options.symbol_map.empty()) {
+            return;
+        }
+        FileSymbolMap map;
+        for (const auto& sym : symbols) {
+            map["device_emulator.c"][sym.name] = {
+                .address    = sym.address,
+                .size       = sym.size,
+                .frame      = 0,
+                .type       = sym.type,
+                .bit_offset = 0,
+                .bit_size   = 0,
+            };
+        }
+        if (!symbol_cache::SaveFile(options.symbol_map, map)) {
+            std::fprintf(stderr, "Could not write %s\n", options.symbol_map.c_str());
+            return;
+        }
+        std::printf("Wrote %zu symbols to %s, select it as ELF file in the Map Parser\n", symbols.size(),
+                    options.symbol_map.c_str());
+    }
+
+    /*
+     * Moves all emulated variables one step, each with its own signal shape.
+     */
+    void UpdateRam(double t) {
+        for (size_t i = 0; i < symbols.size(); i++) {
+            const EmuSymbol& sym = symbols[i];
+            uint8_t* dst = &ram[sym.address - ram_base];
+            double const phase = t * (1.0 + static_cast<double>(i % 7));
+            if (sym.type == TYPE_FLOAT) {
+                float const value = static_cast<float>(std::sin(phase));
+                std::memcpy(dst, &value, sizeof(value));
+            } else {
+                uint32_t const value = (i % 2 == 0) ? static_cast<uint32_t>(stats.frames + i)
+                                                     : static_cast<uint32_t>(1000.0 * std::sin(phase));
+                std::memcpy(dst, &value, sym.size);  // Little endian, like the STM32
+            }
+        }
+    }
+
+    const uint8_t* RamAt(uint32_t address, uint32_t size) {
+        static const uint8_t zero[0x100] = {};
+        if (address < ram_base || address + size > ram_base + ram.size() || size > sizeof(zero)) {
+            return zero;
+        }
+        return &ram[address - ram_base];
+    }
+
+    /*
+     * Same wire format as SerialLog_TransmittFrame().
+     */
+    void TransmitFrame(int fd, size_t frame_idx, Clock::time_point tx_time) {
+        if (tx_time < uart_free_at) {
+            stats.uart_drops++;
+            return;
+        }
+
+        uint8_t tx_buffer[serial_protocol::kHeaderSize + serial_protocol::kMaxLength + serial_protocol::kCrcSize];
+        size_t idx = 0;
+        uint32_t const log_time = static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(tx_time - log_start_time).count() / tick_us);
+
+        tx_buffer[idx++] = serial_protocol::kSync0;
+        tx_buffer[idx++] = serial_protocol::kSync1;
+        tx_buffer[idx++] = serial_protocol::kVersion;
+        tx_buffer[idx++] = static_cast<uint8_t>(frame_idx);
+        tx_buffer[idx++] = 0;
+        tx_buffer[idx++] = (log_time >> 24) & 0xFF;
+        tx_buffer[idx++] = (log_time >> 16) & 0xFF;
+        tx_buffer[idx++] = (log_time >> 8)  & 0xFF;
+        tx_buffer[idx++] =  log_time        & 0xFF;
+        for (const auto& var : frames[frame_idx].variables) {
+            if (idx + var.size > serial_protocol::kHeaderSize + serial_protocol::kMaxLength) {
+                break;
+            }
+            const uint8_t* src = RamAt(var.address, var.size);
+            for (uint32_t j = 0; j < var.size; j++) {
+                tx_buffer[idx++] = src[var.size - 1 - j];
+            }
+        }
+        tx_buffer[4] = static_cast<uint8_t>(idx - serial_protocol::kHeaderSize);
+        uint16_t const crc = serial_protocol::Crc16(&tx_buffer[2], idx - 2);
+        tx_buffer[idx++] = (crc >> 8) & 0xFF;
+        tx_buffer[idx++] =  crc       & 0xFF;
+
+        ssize_t const written = write(fd, tx_buffer, idx);
+        if (written != static_cast<ssize_t>(idx)) {
+            stats.host_drops++;
+            return;
+        }
+        stats.frames++;
+        stats.bytes += idx;
+        // 8N1, 10 bit times per byte
+        uart_free_at = tx_time + std::chrono::nanoseconds(static_cast<int64_t>(idx * 10 * 1e9 / options.baud));
+    }
+
+    void Reply(int fd, uint8_t reply) {
+        if (write(fd, &reply, 1) != 1) {
+            stats.host_drops++;
+        }
+    }
+
+    /*
+     * Mirrors RunCommandHandler() and the CH_* handlers, one byte at a time.
+     */
+    void HandleCommandByte(int fd, uint8_t byte) {
+        static int handler = -1;
+        static std::vector<uint8_t> setup;
+
+        if (handler == -1) {
+            handler = byte;
+            if (handler == CMD_SETUP_FRAME) {
+                setup.clear();
+                return;
+            }
+        }
+
+        switch (handler) {
+            case CMD_START_LOG:
+                log_started = true;
+                log_start_time = Clock::now();
+                for (auto& frame : frames) {
+                    frame.next_tx = log_start_time;
+                }
+                Reply(fd, REPLY_ACK);
+                break;
+            case CMD_STOP_LOG:
+                log_started = false;
+                Reply(fd, REPLY_ACK);
+                break;
+            case CMD_SETUP_FRAME: {
+                // | id u32 | variables u32 | (address u32 | size u32) * variables | ... | 0xFF
+                size_t const frame_start = [&] {
+                    size_t pos = 0;
+                    while (pos + 8 <= setup.size()) {
+                        uint32_t vars;
+                        std::memcpy(&vars, &setup[pos + 4], sizeof(vars));
+                        pos += 8 + 8 * static_cast<size_t>(vars);
+                    }
+                    return pos;
+                }();
+                if (frame_start == setup.size() && byte == 0xFF) {
+                    size_t pos = 0;
+                    size_t frame_idx = 0;
+                    for (auto& frame : frames) {
+                        frame.variables.clear();
+                    }
+                    bool valid = true;
+                    while (pos < setup.size()) {
+                        uint32_t vars;
+                        std::memcpy(&vars, &setup[pos + 4], sizeof(vars));
+                        if (frame_idx >= max_nr_of_frames || vars > max_frame_size) {
+                            valid = false;
+                            break;
+                        }
+                        for (uint32_t v = 0; v < vars; v++) {
+                            EmuFrameVariable var;
+                            std::memcpy(&var.address, &setup[pos + 8 + 8 * v], sizeof(var.address));
+                            std::memcpy(&var.size, &setup[pos + 12 + 8 * v], sizeof(var.size));
+                            frames[frame_idx].variables.push_back(var);
+                        }
+                        pos += 8 + 8 * static_cast<size_t>(vars);
+                        frame_idx++;
+                    }
+                    Reply(fd, valid ? REPLY_ACK : REPLY_NACK);
+                    break;
+                }
+                setup.push_back(byte);
+                return;
+            }
+            default:
+                Reply(fd, REPLY_NACK);
+                break;
+        }
+        handler = -1;
+    }
+
+    int OpenPty(std::string& slave_name, int& slave_fd) {
+        int const master_fd = posix_openpt(O_RDWR | O_NOCTTY);
+        if (master_fd < 0 || grantpt(master_fd) != 0 || unlockpt(master_fd) != 0) {
+            std::perror("posix_openpt");
+            return -1;
+        }
+        slave_name = ptsname(master_fd);
+
+        // Keep the slave open so the master does not see EIO while no host is connected.
+        slave_fd = open(slave_name.c_str(), O_RDWR | O_NOCTTY);
+        termios tio;
+        tcgetattr(slave_fd, &tio);
+        cfmakeraw(&tio);
+        tcsetattr(slave_fd, TCSANOW, &tio);
+
+        fcntl(master_fd, F_SETFL, fcntl(master_fd, F_GETFL) | O_NONBLOCK);
+        return master_fd;
+    }
+
+    void PrintStats(const char* label, const EmuStats& delta, double seconds) {
+        std::printf("%-12s %10.0f frames/s %9.1f kB/s  uart drops %8llu  host drops %8llu\n", label,
+                    static_cast<double>(delta.frames) / seconds,
+                    static_cast<double>(delta.bytes) / seconds / 1e3,
+                    static_cast<unsigned long long>(delta.uart_drops),
+                    static_cast<unsigned long long>(delta.host_drops));
+        std::fflush(stdout);
+    }
+
+    bool ParseArgs(int argc, char** argv) {
+        for (int i = 1; i < argc; i++) {
+            std::string const arg = argv[i];
+            bool const has_value = i + 1 < argc;
+            if (arg == "--baud" && has_value) {
+                options.baud = std::atoi(argv[++i]);
+            } else if (arg == "--rate" && has_value) {
+                options.rate_hz = std::atof(argv[++i]);
+            } else if (arg == "--vars" && has_value) {
+                options.vars = std::atoi(argv[++i]);
+            } else if (arg == "--symbol-map" && has_value) {
+                options.symbol_map = argv[++i];
+            } else if (arg == "--sweep" && has_value) {
+                // factor:seconds, multiply the rate by factor every step
+                std::string const value = argv[++i];
+                options.sweep_factor = std::atof(value.c_str());
+                size_t const colon = value.find(':');
+                if (colon != std::string::npos) {
+                    options.sweep_step_s = std::atof(value.c_str() + colon + 1);
+                }
+            } else {
+                std::fprintf(stderr,
+                    "usage: %s [--baud N] [--rate HZ] [--vars N] [--symbol-map FILE] [--sweep FACTOR:SECONDS]\n",
+                    argv[0]);
+                return false;
+            }
+        }
+        return options.baud > 0 && options.rate_hz > 0.0 && options.vars > 0;
+    }
+} // namespace anonymous
+
+int main(int argc, char** argv) {
+    if (!ParseArgs(argc, argv)) {
+        return 1;
+    }
+    std::signal(SIGINT, OnSignal);
+    std::signal(SIGTERM, OnSignal);
+
+    CreateSymbols();
+
+    std::string slave_name;
+    int slave_fd = -1;
+    int const fd = OpenPty(slave_name, slave_fd);
+    if (fd < 0) {
+        return 1;
+    }
+    std::printf("Device emulator on %s, %d baud, %.0f Hz per frame, %d variables\n",
+                slave_name.c_str(), options.baud, options.rate_hz, options.vars);
+    std::fflush(stdout);
+
+    double rate_hz = options.rate_hz;
+    double max_sustained_hz = 0.0;
+    EmuStats step_start = stats;
+    auto step_time = Clock::now();
+
+    while (!exit_requested) {
+        auto now = Clock::now();
+
+        // Earliest frame due, or poll for commands for a while when idle.
+        auto wake = now + std::chrono::milliseconds(10);
+        if (log_started) {
+            for (const auto& frame : frames) {
+                if (!frame.variables.empty() && frame.next_tx < wake) {
+                    wake = frame.next_tx;
+                }
+            }
+        }
+        int const timeout_ms = static_cast<int>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(wake - now).count());
+        pollfd pfd = {.fd = fd, .events = POLLIN, .revents = 0};
+        if (poll(&pfd, 1, std::max(timeout_ms, 0)) > 0 && (pfd.revents & POLLIN)) {
+            uint8_t rx[4096];
+            ssize_t const n = read(fd, rx, sizeof(rx));
+            for (ssize_t i = 0; i < n; i++) {
+                HandleCommandByte(fd, rx[i]);
+            }
+        }
+
+        now = Clock::now();
+        if (log_started) {
+            auto const period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate_hz));
+            UpdateRam(std::chrono::duration<double>(now - log_start_time).count());
+            for (size_t i = 0; i < max_nr_of_frames; i++) {
+                // Catch up with a bounded number of frames if sleeping overshot
+                for (int burst = 0; burst < 16 && !frames[i].variables.empty() && frames[i].next_tx <= now; burst++) {
+                    TransmitFrame(fd, i, frames[i].next_tx);
+                    frames[i].next_tx += period;
+                }
+                if (frames[i].next_tx <= now) {
+                    frames[i].next_tx = now + period;
+                }
+            }
+        }
+
+        double const step_s = std::chrono::duration<double>(now - step_time).count();
+        if (step_s >= options.sweep_step_s) {
+            EmuStats const delta = {
+                .frames     = stats.frames - step_start.frames,
+                .bytes      = stats.bytes - step_start.bytes,
+                .uart_drops = stats.uart_drops - step_start.uart_drops,
+                .host_drops = stats.host_drops - step_start.host_drops,
+            };
+            char label[32];
+            std::snprintf(label, sizeof(label), "%.0f Hz", rate_hz);
+            if (log_started) {
+                PrintStats(label, delta, step_s);
+                if (delta.host_drops == 0 && delta.uart_drops == 0 && delta.frames > 0) {
+                    max_sustained_hz = std::max(max_sustained_hz, static_cast<double>(delta.frames) / step_s);
+                }
+                if (options.sweep_factor > 1.0) {
+                    rate_hz *= options.sweep_factor;
+                    if (delta.host_drops > 0) {
+                        std::printf("Host dropped frames, stopping sweep.\n");
+                        exit_requested = 1;
+                    }
+                }
+            }
+            step_start = stats;
+            step_time = now;
+        }
+    }
+
+    std::printf("\nSent %llu frames, %llu bytes. Max frame rate without drops: %.0f frames/s\n",
+                static_cast<unsigned long long>(stats.frames),
+                static_cast<unsigned long long>(stats.bytes), max_sustained_hz);
+    close(slave_fd);
+    close(fd);
+    return 0;
+}
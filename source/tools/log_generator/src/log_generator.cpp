@@ -0,0 +1,683 @@
+/*
+ * Deterministic synthetic inputs for benchmarks and for reproducing scaling problems.
+ *
+ * Writes CSV logs in the example.csv layout, and raw serial streams in the
+ * SerialLog_TransmittFrame() wire format, either as plain bytes or as a .jvraw
+ * capture that Replay in the Serial Monitor plays back. Every value is a
+ * function of seed, column and row, so the same options give the same bytes
+ * whatever the number of threads.
+ *
+ *   log_generator --csv out.csv [--columns 8] [--separator ,] [--decimal .]
+ *                 [--precision 4] [--trailing-separator]
+ *   log_generator --stream out.bin | --capture out.jvraw [--frames u16,i32,float;u8,bool]
+ *
+ *   common: [--rows 1000000] [--rate 1000] [--seed 1] [--threads 0]
+ *           [--shapes sine,noise,step,bool,counter]
+ *
+ * --frames lists the variable types of each frame, frames separated by ';' get ids 0, 1, ...
+ * Signal k of a stream has the same values as column k of a CSV with the same seed.
+ */
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <numbers>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "json.hpp"
+#include "raw_capture.h"
+#include "serial_back.h"
+#include "serial_protocol.h"
+
+using Clock = std::chrono::steady_clock;
+using Json = nlohmann::json;
+
+namespace {
+    const size_t   block_rows      = 16384;     // Rows generated per thread and round
+    const size_t   max_value_chars = 32;
+    const size_t   record_bytes    = 4096;      // About one serial read per capture record
+    const uint32_t tick_us         = 10;        // Device timestamps are in 10 us ticks
+    const uint32_t ram_base        = 0x20000000;
+    const int      max_precision   = 9;
+
+    typedef enum {
+        SHAPE_SINE,
+        SHAPE_NOISE,
+        SHAPE_STEP,
+        SHAPE_BOOL,
+        SHAPE_COUNTER,
+    } SignalShape;
+
+    typedef struct {
+        const char* name;
+        SignalShape shape;
+    } ShapeName;
+
+    const ShapeName shape_names[] = {
+        {"sine",    SHAPE_SINE},
+        {"noise",   SHAPE_NOISE},
+        {"step",    SHAPE_STEP},
+        {"bool",    SHAPE_BOOL},
+        {"counter", SHAPE_COUNTER},
+    };
+
+    typedef struct {
+        const char*  name;
+        VariableType type;
+        size_t       size;
+        double       full_scale;    // Largest magnitude used for -1..1 shapes
+        bool         is_signed;
+    } TypeName;
+
+    const TypeName type_names[] = {
+        {"u8",    TYPE_UINT8,  1, 255.0,        false},
+        {"u16",   TYPE_UINT16, 2, 65535.0,      false},
+        {"u32",   TYPE_UINT32, 4, 4294967295.0, false},
+        {"i8",    TYPE_INT8,   1, 127.0,        true},
+        {"i16",   TYPE_INT16,  2, 32767.0,      true},
+        {"i32",   TYPE_INT32,  4, 2147483647.0, true},
+        {"float", TYPE_FLOAT,  4, 1.0,          true},
+        {"bool",  TYPE_BOOL,   1, 1.0,          false},
+    };
+
+    typedef struct {
+        SignalShape shape;
+        uint64_t    key;        // Hash key of the column
+        double      omega;      // Sine, radians per row
+        double      phase;
+        uint64_t    run_rows;   // Step and bool, rows per level
+    } ColumnParams;
+
+    typedef struct {
+        std::string     name;
+        const TypeName* type;
+        size_t          column;
+    } GenVariable;
+
+    typedef struct {
+        int                      id;
+        std::vector<GenVariable> variables;
+        size_t                   length;    // Time and variables, the length byte of the frame
+    } GenFrame;
+
+    typedef struct {
+        size_t                   rows      = 1000000;
+        size_t                   columns   = 8;
+        double                   rate_hz   = 1000.0;
+        uint64_t                 seed      = 1;
+        unsigned                 threads   = 0;
+        char                     separator = ',';
+        char                     decimal   = '.';
+        int                      precision = 4;
+        bool                     trailing_separator = false;
+        std::vector<SignalShape> shapes = {SHAPE_SINE, SHAPE_NOISE, SHAPE_STEP, SHAPE_BOOL, SHAPE_COUNTER};
+        std::string              frame_spec = "u16,i32,float,u8;u16,i32,float,u8;u16,i32,float,u8";
+        std::string              csv_path;
+        std::string              stream_path;
+        std::string              capture_path;
+    } GenOptions;
+
+    // Formatted bytes of one block. bytes only grows, so it is zero filled once and not per block
+    typedef struct {
+        std::vector<char> bytes;
+        size_t            size;
+    } BlockBuffer;
+
+    GenOptions                options;
+    std::vector<ColumnParams> column_params;
+    std::vector<GenFrame>     frames;
+
+    constexpr std::array<char, 200> MakeDigitPairs() {
+        std::array<char, 200> pairs = {};
+        for (size_t i = 0; i < 100; i++) {
+            pairs[2 * i]     = static_cast<char>('0' + i / 10);
+            pairs[2 * i + 1] = static_cast<char>('0' + i % 10);
+        }
+        return pairs;
+    }
+
+    constexpr std::array<char, 200> digit_pairs = MakeDigitPairs();
+
+    uint64_t SplitMix(uint64_t x) {
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    // Uniform in [0, 1) from a key and a counter
+    double Unit(uint64_t key, uint64_t n) {
+        return static_cast<double>(SplitMix(key ^ (n * 0xD1B54A32D192ED03ULL)) >> 11) * 0x1.0p-53;
+    }
+
+    bool ParseShapes(const std::string& list) {
+        options.shapes.clear();
+        size_t start = 0;
+        while (start <= list.size()) {
+            size_t const end = std::min(list.find(',', start), list.size());
+            std::string const name = list.substr(start, end - start);
+            auto it = std::find_if(std::begin(shape_names), std::end(shape_names),
+                                   [&](const ShapeName& shape) { return name == shape.name; });
+            if (it == std::end(shape_names)) {
+                std::fprintf(stderr, "Unknown shape '%s'\n", name.c_str());
+                return false;
+            }
+            options.shapes.push_back(it->shape);
+            start = end + 1;
+        }
+        return !options.shapes.empty();
+    }
+
+    // Whole text must be a number, "abc", "12x" and negative counts are rejected
+    bool ParseUnsigned(const char* text, uint64_t max, uint64_t& value) {
+        char* end = nullptr;
+        errno = 0;
+        unsigned long long const parsed = std::strtoull(text, &end, 10);
+        if (end == text || *end != '\0' || errno == ERANGE || std::strchr(text, '-') != nullptr || parsed > max) {
+            return false;
+        }
+        value = parsed;
+        return true;
+    }
+
+    template <typename T>
+    bool ParseUnsigned(const char* text, T& value) {
+        uint64_t parsed = 0;
+        if (!ParseUnsigned(text, std::numeric_limits<T>::max(), parsed)) {
+            return false;
+        }
+        value = static_cast<T>(parsed);
+        return true;
+    }
+
+    bool ParseDouble(const char* text, double& value) {
+        char* end = nullptr;
+        errno = 0;
+        double const parsed = std::strtod(text, &end);
+        if (end == text || *end != '\0' || errno == ERANGE || !std::isfinite(parsed)) {
+            return false;
+        }
+        value = parsed;
+        return true;
+    }
+
+    bool ParseChar(const char* text, char& value) {
+        if (text[0] == '\0' || text[1] != '\0') {
+            return false;
+        }
+        value = text[0];
+        return true;
+    }
+
+    void PrintUsage(const char* program) {
+        std::fprintf(stderr,
+            "Usage: %s --csv path | --stream path | --capture path [--rows N] [--columns N]\n"
+            "       [--rate Hz] [--seed N] [--threads N] [--separator c] [--decimal c] [--precision N]\n"
+            "       [--trailing-separator] [--shapes sine,noise,step,bool,counter] [--frames u16,i32;float]\n",
+            program);
+    }
+
+    bool ParseArgs(int argc, char** argv) {
+        for (int i = 1; i < argc; i++) {
+            std::string const arg = argv[i];
+            bool const has_value = i + 1 < argc;
+            bool valid = true;
+            if (arg == "--csv" && has_value) {
+                options.csv_path = argv[++i];
+            } else if (arg == "--stream" && has_value) {
+                options.stream_path = argv[++i];
+            } else if (arg == "--capture" && has_value) {
+                options.capture_path = argv[++i];
+            } else if (arg == "--rows" && has_value) {
+                valid = ParseUnsigned(argv[++i], options.rows);
+            } else if (arg == "--columns" && has_value) {
+                valid = ParseUnsigned(argv[++i], options.columns);
+            } else if (arg == "--rate" && has_value) {
+                valid = ParseDouble(argv[++i], options.rate_hz);
+            } else if (arg == "--seed" && has_value) {
+                valid = ParseUnsigned(argv[++i], options.seed);
+            } else if (arg == "--threads" && has_value) {
+                valid = ParseUnsigned(argv[++i], options.threads);
+            } else if (arg == "--separator" && has_value) {
+                valid = ParseChar(argv[++i], options.separator);
+            } else if (arg == "--decimal" && has_value) {
+                valid = ParseChar(argv[++i], options.decimal);
+            } else if (arg == "--precision" && has_value) {
+                uint64_t precision = 0;
+                valid = ParseUnsigned(argv[++i], max_precision, precision);
+                options.precision = static_cast<int>(precision);
+            } else if (arg == "--trailing-separator") {
+                options.trailing_separator = true;
+            } else if (arg == "--shapes" && has_value) {
+                if (!ParseShapes(argv[++i])) {
+                    return false;
+                }
+            } else if (arg == "--frames" && has_value) {
+                options.frame_spec = argv[++i];
+            } else {
+                PrintUsage(argv[0]);
+                return false;
+            }
+            if (!valid) {
+                std::fprintf(stderr, "Invalid value '%s' for %s\n", argv[i], arg.c_str());
+                PrintUsage(argv[0]);
+                return false;
+            }
+        }
+        if (options.csv_path.empty() && options.stream_path.empty() && options.capture_path.empty()) {
+            std::fprintf(stderr, "Nothing to generate, give --csv, --stream or --capture\n");
+            return false;
+        }
+        if (options.rate_hz <= 0.0 || options.separator == options.decimal) {
+            std::fprintf(stderr, "Rate must be positive and separator and decimal must differ\n");
+            return false;
+        }
+        if (options.threads == 0) {
+            options.threads = std::max(std::thread::hardware_concurrency(), 1U);
+        }
+        return true;
+    }
+
+    // Frames of --frames, variables are numbered across frames and use the column with their number
+    bool ParseFrames() {
+        frames.clear();
+        size_t column = 0;
+        size_t start = 0;
+        while (start <= options.frame_spec.size()) {
+            size_t const end = std::min(options.frame_spec.find(';', start), options.frame_spec.size());
+            GenFrame frame = {.id = static_cast<int>(frames.size()), .variables = {},
+                              .length = serial_protocol::kTimeSize};
+            size_t var_start = start;
+            while (var_start <= end) {
+                size_t const var_end = std::min(options.frame_spec.find(',', var_start), end);
+                std::string const name = options.frame_spec.substr(var_start, var_end - var_start);
+                auto it = std::find_if(std::begin(type_names), std::end(type_names),
+                                       [&](const TypeName& type) { return name == type.name; });
+                if (it == std::end(type_names)) {
+                    std::fprintf(stderr, "Unknown variable type '%s' in frame %d\n", name.c_str(), frame.id);
+                    return false;
+                }
+                frame.variables.push_back({.name = "signal_" + std::to_string(column), .type = it, .column = column});
+                frame.length += it->size;
+                column++;
+                var_start = var_end + 1;
+            }
+            if (frame.length > serial_protocol::kMaxLength || frames.size() > 0xFF) {
+                std::fprintf(stderr, "Frame %d does not fit the wire format\n", frame.id);
+                return false;
+            }
+            frames.push_back(frame);
+            start = end + 1;
+        }
+        return true;
+    }
+
+    void SetupColumns(size_t columns) {
+        column_params.clear();
+        for (size_t col = 0; col < columns; col++) {
+            uint64_t const key = SplitMix(options.seed * 0x9E3779B97F4A7C15ULL + col);
+            double const frequency_hz = 0.1 + 4.9 * Unit(key, 1);
+            double const run_s = 0.05 + 1.95 * Unit(key, 2);
+            column_params.push_back({
+                .shape    = options.shapes[col % options.shapes.size()],
+                .key      = key,
+                .omega    = 2.0 * std::numbers::pi * frequency_hz / options.rate_hz,
+                .phase    = 2.0 * std::numbers::pi * Unit(key, 3),
+                .run_rows = std::max<uint64_t>(1, static_cast<uint64_t>(run_s * options.rate_hz)),
+            });
+        }
+    }
+
+    /*
+     * Values of rows [first, first + count) for every column, column major. Sines are
+     * evaluated at the start of the block and rotated from there.
+     */
+    void GenerateBlock(std::vector<double>& values, size_t first, size_t count) {
+        values.resize(column_params.size() * block_rows);
+        for (size_t col = 0; col < column_params.size(); col++) {
+            const ColumnParams& params = column_params[col];
+            double* out = &values[col * block_rows];
+            switch (params.shape) {
+                case SHAPE_SINE: {
+                    double const angle = params.omega * static_cast<double>(first) + params.phase;
+                    double sin_value = std::sin(angle);
+                    double cos_value = std::cos(angle);
+                    double const sin_step = std::sin(params.omega);
+                    double const cos_step = std::cos(params.omega);
+                    for (size_t i = 0; i < count; i++) {
+                        out[i] = sin_value;
+                        double const next_sin = sin_value * cos_step + cos_value * sin_step;
+                        cos_value = cos_value * cos_step - sin_value * sin_step;
+                        sin_value = next_sin;
+                    }
+                    break;
+                }
+                case SHAPE_NOISE:
+                    for (size_t i = 0; i < count; i++) {
+                        out[i] = 2.0 * Unit(params.key, first + i) - 1.0;
+                    }
+                    break;
+                case SHAPE_STEP:
+                    // Levels in quarters of -1..1
+                    for (size_t i = 0; i < count; i++) {
+                        double const level = Unit(params.key, (first + i) / params.run_rows);
+                        out[i] = std::round(level * 8.0) / 4.0 - 1.0;
+                    }
+                    break;
+                case SHAPE_BOOL:
+                    for (size_t i = 0; i < count; i++) {
+                        out[i] = Unit(params.key, (first + i) / params.run_rows) < 0.5 ? 0.0 : 1.0;
+                    }
+                    break;
+                case SHAPE_COUNTER:
+                    for (size_t i = 0; i < count; i++) {
+                        out[i] = static_cast<double>(first + i);
+                    }
+                    break;
+            }
+        }
+    }
+
+    // Fixed point with the given number of decimals, digits are cut from an integer, no printf
+    char* FormatFixed(char* out, double value, int precision, char decimal) {
+        static const double pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+        double const scaled_value = value * pow10[precision];
+        uint64_t scaled = static_cast<uint64_t>(std::fabs(scaled_value) + 0.5);
+        if (scaled_value < 0.0 && scaled != 0) {
+            *out++ = '-';
+        }
+        char digits[max_value_chars];
+        char* const end = digits + sizeof(digits);
+        char* first = end;
+        while (scaled >= 100) {
+            first -= 2;
+            std::memcpy(first, &digit_pairs[2 * (scaled % 100)], 2);
+            scaled /= 100;
+        }
+        if (scaled >= 10) {
+            first -= 2;
+            std::memcpy(first, &digit_pairs[2 * scaled], 2);
+        } else {
+            *--first = static_cast<char>('0' + scaled);
+        }
+        // At least one integer digit before the decimals
+        while (end - first <= precision) {
+            *--first = '0';
+        }
+
+        size_t const integer_digits = static_cast<size_t>(end - first) - static_cast<size_t>(precision);
+        std::memcpy(out, first, integer_digits);
+        out += integer_digits;
+        if (precision > 0) {
+            *out++ = decimal;
+            std::memcpy(out, first + integer_digits, static_cast<size_t>(precision));
+            out += precision;
+        }
+        return out;
+    }
+
+    void Reserve(BlockBuffer& buffer, size_t size) {
+        if (buffer.bytes.size() < size) {
+            buffer.bytes.resize(size);
+        }
+    }
+
+    void FormatCsvBlock(BlockBuffer& buffer, std::vector<double>& values, size_t first, size_t count) {
+        GenerateBlock(values, first, count);
+        Reserve(buffer, count * (column_params.size() + 2) * (max_value_chars + 1));
+        char* out = buffer.bytes.data();
+        for (size_t i = 0; i < count; i++) {
+            out = FormatFixed(out, static_cast<double>(first + i) / options.rate_hz, options.precision,
+                              options.decimal);
+            for (size_t col = 0; col < column_params.size(); col++) {
+                SignalShape const shape = column_params[col].shape;
+                // Integer shapes are written without decimals
+                int const precision = shape == SHAPE_BOOL || shape == SHAPE_COUNTER ? 0 : options.precision;
+                *out++ = options.separator;
+                out = FormatFixed(out, values[col * block_rows + i], precision, options.decimal);
+            }
+            if (options.trailing_separator) {
+                *out++ = options.separator;
+            }
+            *out++ = '\n';
+        }
+        buffer.size = static_cast<size_t>(out - buffer.bytes.data());
+    }
+
+    // The raw variable as the device sends it, -1..1 shapes scaled to most of the type range
+    uint32_t EncodeValue(double value, SignalShape shape, const TypeName& type) {
+        if (type.type == TYPE_FLOAT) {
+            float const f = static_cast<float>(value);
+            uint32_t bits;
+            std::memcpy(&bits, &f, sizeof(bits));
+            return bits;
+        }
+        if (shape == SHAPE_BOOL || shape == SHAPE_COUNTER) {
+            return static_cast<uint32_t>(static_cast<uint64_t>(value));
+        }
+        if (type.type == TYPE_BOOL) {
+            return value > 0.0 ? 1 : 0;
+        }
+        if (type.is_signed) {
+            return static_cast<uint32_t>(static_cast<int32_t>(value * 0.9 * type.full_scale));
+        }
+        return static_cast<uint32_t>((value + 1.0) * 0.45 * type.full_scale);
+    }
+
+    size_t RowBytes() {
+        size_t bytes = 0;
+        for (const auto& frame : frames) {
+            bytes += serial_protocol::kHeaderSize + frame.length + serial_protocol::kCrcSize;
+        }
+        return bytes;
+    }
+
+    size_t RecordRows() {
+        return std::max<size_t>(1, record_bytes / RowBytes());
+    }
+
+    /*
+     * Every frame once per row, as the device sends them. For a capture a record header
+     * goes before every RecordRows() rows, stamped with the time of its last row.
+     */
+    void FormatStreamBlock(BlockBuffer& buffer, std::vector<double>& values, size_t first, size_t count,
+                           bool capture) {
+        using serial_protocol::kHeaderSize;
+        const size_t record_header_size = sizeof(uint64_t) + sizeof(uint32_t);
+        GenerateBlock(values, first, count);
+        size_t const row_bytes = RowBytes();
+        size_t const record_rows = RecordRows();
+        Reserve(buffer, count * row_bytes + (capture ? (count / record_rows + 1) * record_header_size : 0));
+        uint8_t* out = reinterpret_cast<uint8_t*>(buffer.bytes.data());
+        double const ticks_per_row = 1e6 / (options.rate_hz * tick_us);
+
+        for (size_t i = 0; i < count; i++) {
+            size_t const row = first + i;
+            if (capture && row % record_rows == 0) {
+                size_t const last = std::min(row + record_rows, options.rows) - 1;
+                uint64_t const host_time_us = static_cast<uint64_t>(std::llround(static_cast<double>(last) * 1e6 /
+                                                                                options.rate_hz));
+                uint32_t const len = static_cast<uint32_t>((last + 1 - row) * row_bytes);
+                std::memcpy(out, &host_time_us, sizeof(host_time_us));
+                std::memcpy(out + sizeof(host_time_us), &len, sizeof(len));
+                out += record_header_size;
+            }
+            uint32_t const time = static_cast<uint32_t>(std::llround(static_cast<double>(row) * ticks_per_row));
+            for (const auto& frame : frames) {
+                uint8_t* const start = out;
+                *out++ = serial_protocol::kSync0;
+                *out++ = serial_protocol::kSync1;
+                *out++ = serial_protocol::kVersion;
+                *out++ = static_cast<uint8_t>(frame.id);
+                *out++ = static_cast<uint8_t>(frame.length);
+                *out++ = static_cast<uint8_t>(time >> 24);
+                *out++ = static_cast<uint8_t>(time >> 16);
+                *out++ = static_cast<uint8_t>(time >> 8);
+                *out++ = static_cast<uint8_t>(time);
+                for (const auto& var : frame.variables) {
+                    uint32_t const raw = EncodeValue(values[var.column * block_rows + i],
+                                                     column_params[var.column].shape, *var.type);
+                    for (size_t byte = var.type->size; byte > 0; byte--) {
+                        *out++ = static_cast<uint8_t>(raw >> (8 * (byte - 1)));
+                    }
+                }
+                uint16_t const crc = serial_protocol::Crc16(start + 2, kHeaderSize - 2 + frame.length);
+                *out++ = static_cast<uint8_t>(crc >> 8);
+                *out++ = static_cast<uint8_t>(crc);
+            }
+        }
+        buffer.size = static_cast<size_t>(out - reinterpret_cast<uint8_t*>(buffer.bytes.data()));
+    }
+
+    typedef std::function<void(BlockBuffer& buffer, std::vector<double>& values, size_t first, size_t count)>
+        BlockFormatter;
+
+    /*
+     * One round formats one block per thread, then the blocks are written in
+     * order, as csv_writer does. Returns the number of bytes written.
+     */
+    bool WriteBlocks(std::FILE* file, const BlockFormatter& format_block, uint64_t& bytes) {
+        size_t const blocks = (options.rows + block_rows - 1) / block_rows;
+        size_t const threads = std::min<size_t>(options.threads, std::max<size_t>(blocks, 1));
+        std::vector<BlockBuffer> buffers(threads);
+        std::vector<std::vector<double>> values(threads);
+        for (size_t round = 0; round < blocks; round += threads) {
+            size_t const round_blocks = std::min(threads, blocks - round);
+            std::vector<std::thread> workers;
+            for (size_t t = 0; t < round_blocks; t++) {
+                size_t const first = (round + t) * block_rows;
+                size_t const count = std::min(block_rows, options.rows - first);
+                if (t + 1 == round_blocks) {
+                    format_block(buffers[t], values[t], first, count);
+                } else {
+                    workers.emplace_back(format_block, std::ref(buffers[t]), std::ref(values[t]), first, count);
+                }
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+            for (size_t t = 0; t < round_blocks; t++) {
+                if (std::fwrite(buffers[t].bytes.data(), 1, buffers[t].size, file) != buffers[t].size) {
+                    return false;
+                }
+                bytes += buffers[t].size;
+            }
+        }
+        return true;
+    }
+
+    bool GenerateCsv(const std::string& path, uint64_t& bytes) {
+        SetupColumns(options.columns);
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr) {
+            return false;
+        }
+        std::string header = "Time";
+        for (size_t col = 0; col < options.columns; col++) {
+            header += options.separator;
+            header += "signal_" + std::to_string(col);
+        }
+        if (options.trailing_separator) {
+            header += options.separator;
+        }
+        header += '\n';
+        bool ok = std::fwrite(header.data(), 1, header.size(), file) == header.size();
+        bytes += header.size();
+        ok = ok && WriteBlocks(file, FormatCsvBlock, bytes);
+        return (std::fclose(file) == 0) && ok;
+    }
+
+    // The frame config raw_capture stores, as FramesToJson() in serial_back.cpp writes it
+    std::string CaptureConfig() {
+        Json config;
+        config["baud_rate"] = 0;
+        config["setup_command"] = Json::array();
+        config["frames"] = Json::array();
+        uint32_t address = ram_base;
+        for (const auto& frame : frames) {
+            Json frame_json;
+            frame_json["id"] = frame.id;
+            frame_json["variables"] = Json::array();
+            for (const auto& var : frame.variables) {
+                frame_json["variables"].push_back({
+                    {"name", var.name},
+                    {"address", address},
+                    {"size", var.type->size},
+                    {"type", static_cast<int>(var.type->type)},
+                    {"bit_offset", 0},
+                    {"bit_size", 0},
+                });
+                address += 4;
+            }
+            config["frames"].push_back(frame_json);
+        }
+        return config.dump();
+    }
+
+    bool GenerateStream(const std::string& path, bool capture, uint64_t& bytes) {
+        size_t columns = 0;
+        for (const auto& frame : frames) {
+            columns += frame.variables.size();
+        }
+        SetupColumns(columns);
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr) {
+            return false;
+        }
+        bool ok = true;
+        if (capture) {
+            std::string const config = CaptureConfig();
+            uint32_t const config_len = static_cast<uint32_t>(config.size());
+            ok = std::fwrite(raw_capture::kMagic, 1, sizeof(raw_capture::kMagic), file) == sizeof(raw_capture::kMagic);
+            ok = ok && std::fwrite(&raw_capture::kVersion, sizeof(raw_capture::kVersion), 1, file) == 1;
+            ok = ok && std::fwrite(&config_len, sizeof(config_len), 1, file) == 1;
+            ok = ok && std::fwrite(config.data(), 1, config.size(), file) == config.size();
+            bytes += sizeof(raw_capture::kMagic) + sizeof(raw_capture::kVersion) + sizeof(config_len) + config.size();
+        }
+        ok = ok && WriteBlocks(file, [capture](BlockBuffer& buffer, std::vector<double>& values, size_t first,
+                                               size_t count) {
+            FormatStreamBlock(buffer, values, first, count, capture);
+        }, bytes);
+        return (std::fclose(file) == 0) && ok;
+    }
+
+    bool Generate(const char* kind, const std::string& path, const std::function<bool(uint64_t&)>& generate) {
+        if (path.empty()) {
+            return true;
+        }
+        uint64_t bytes = 0;
+        auto const start = Clock::now();
+        if (!generate(bytes)) {
+            std::fprintf(stderr, "Could not write %s\n", path.c_str());
+            return false;
+        }
+        double const seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::printf("%-8s %s: %zu rows, %.1f MB in %.3f s, %.2f GB/s\n", kind, path.c_str(), options.rows,
+                    static_cast<double>(bytes) / 1e6, seconds, static_cast<double>(bytes) / seconds / 1e9);
+        return true;
+    }
+} // namespace anonymous
+
+int main(int argc, char** argv) {
+    if (!ParseArgs(argc, argv) || !ParseFrames()) {
+        return 1;
+    }
+    bool ok = Generate("csv", options.csv_path, [](uint64_t& bytes) {
+        return GenerateCsv(options.csv_path, bytes);
+    });
+    ok = Generate("stream", options.stream_path, [](uint64_t& bytes) {
+        return GenerateStream(options.stream_path, false, bytes);
+    }) && ok;
+    ok = Generate("capture", options.capture_path, [](uint64_t& bytes) {
+        return GenerateStream(options.capture_path, true, bytes);
+    }) && ok;
+    return ok ? 0 : 1;
+}